@@ -0,0 +1,222 @@
+// Микробенчмарки ядра симуляции и сериализации на мирах разного размера.
+// Размер мира - число собак; трофеев столько же, дороги - сетка со стороной около sqrt(размера).
+// Для сравнения между версиями результаты пишутся в XML:
+//
+//   ./game_benchmarks --reporter xml --out benchmarks.xml
+//
+// Только нужные ядра отбираются тегами: ./game_benchmarks "[collect]"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/json_utils.h"
+#include "../src/model_serialization.h"
+#include "../src/objects_collector.h"
+#include "../src/snapshot_file.h"
+#include "../src/view_grid.h"
+#include "../tests/test_world.h"
+
+using namespace model;
+using namespace std::literals;
+namespace {
+
+constexpr int TICK_DELTA = 100;
+constexpr double DOG_SPEED = 4.0;
+constexpr int ROAD_STEP = 10;
+constexpr double VIEW_RADIUS = 20.0;
+
+// Квадратная сетка дорог с офисами на перекрестках главной диагонали.
+// Рюкзак нулевой вместимости: сбор ничего не меняет, и каждый прогон делает одну и ту же работу
+Game MakeGame(size_t world_size) {
+    const int side = static_cast<int>(std::sqrt(static_cast<double>(world_size))) + 1;
+    const int length = side * ROAD_STEP;
+
+    Map map{Map::Id{"map"s}, "Map"s, DOG_SPEED, 0};
+    for (int i = 0; i <= side; ++i) {
+        map.AddRoad(Road{Road::HORIZONTAL, Point{0, i * ROAD_STEP}, length});
+        map.AddRoad(Road{Road::VERTICAL, Point{i * ROAD_STEP, 0}, length});
+        map.AddOffice(Office{Office::Id{"o"s + std::to_string(i)}, Point{i * ROAD_STEP, i * ROAD_STEP}, Offset{0, 0}});
+    }
+
+    Game game;
+    game.AddMap(std::move(map));
+    game.SetRandomGenerate(true);
+    game.SetRandomSeed(42);
+    return game;
+}
+
+extra_data::PossibleLootOnMapsToGenerate MakePossibleLoot() {
+    return test_world::MakePossibleLoot(5s, {{"map"s, 2}});
+}
+
+// Мир из world_size собак, идущих в случайных направлениях, и world_size трофеев
+struct World {
+    explicit World(size_t world_size)
+        : game(MakeGame(world_size)) {
+        random_gen::Pcg32 random{7};
+        session = game.AddGameSession("map"s);
+        for (size_t i = 0; i < world_size; ++i) {
+            players.AddPlayer("dog "s + std::to_string(i), session);
+        }
+
+        constexpr DirectionGeo DIRECTIONS[] = {DirectionGeo::NORTH, DirectionGeo::SOUTH, DirectionGeo::WEST, DirectionGeo::EAST};
+        constexpr Speed SPEEDS[] = {{0, -DOG_SPEED}, {0, DOG_SPEED}, {-DOG_SPEED, 0}, {DOG_SPEED, 0}};
+        for (auto& dog : session->GetDogs()) {
+            const auto direction = random.UniformInt(4);
+            dog.SetDir(DIRECTIONS[direction]);
+            dog.SetSpeed(SPEEDS[direction]);
+        }
+
+        std::vector<extra_data::LostObject> loot;
+        for (unsigned i = 0; i < world_size; ++i) {
+            loot.push_back({i, i % 2, generate_coords::GenerateRandomPointOnMap(*session->GetMap(), random)});
+        }
+        lost_objects.SetLostObjects("map"s, std::move(loot));
+    }
+
+    Game game;
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = MakePossibleLoot();
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+    GameSession* session = nullptr;
+};
+
+// Пустой мир с той же картой, куда восстанавливается снимок
+struct RestoredWorld {
+    explicit RestoredWorld(size_t world_size)
+        : game(MakeGame(world_size)) {
+    }
+
+    Game game;
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = MakePossibleLoot();
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+};
+
+size_t GenerateWorldSize() {
+    return GENERATE(as<size_t>{}, 16, 128, 1024);
+}
+
+}  // namespace
+
+TEST_CASE("Movement along roads", "[benchmark][move]") {
+    const size_t world_size = GenerateWorldSize();
+    World world{world_size};
+    const Map& map = *world.session->GetMap();
+
+    BENCHMARK("CanGoToPoint, world " + std::to_string(world_size)) {
+        double sum = 0;
+        for (const auto& dog : world.session->GetDogs()) {
+            const Coordinates from = dog.GetCoords();
+            const Coordinates to{from.x + dog.GetSpeed().horizontal * TICK_DELTA / 1000.0, from.y + dog.GetSpeed().vertical * TICK_DELTA / 1000.0};
+            const Coordinates result = map.CanGoToPoint(from, to, dog.GetDir());
+            sum += result.x + result.y;
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("Loot collection", "[benchmark][collect]") {
+    const size_t world_size = GenerateWorldSize();
+    World world{world_size};
+    // пути собак за один тик, дальше они не меняются
+    const SessionsMovesInfo moves_info = world.game.MakeActionsAtTime(TICK_DELTA);
+    objects_collector::CollectorBuffers buffers;
+
+    std::vector<collision_detector::Gatherer> gatherers;
+    for (const auto& move : moves_info.front().moves) {
+        gatherers.push_back({geom::Point2D(move.start.x, move.start.y), geom::Point2D(move.end.x, move.end.y), 0.6});
+    }
+    const auto& loot_index = world.lost_objects.GetLostObjectsIndex("map"s);
+    std::vector<collision_detector::GatheringEvent> events;
+
+    BENCHMARK("FindGatherEvents, world " + std::to_string(world_size)) {
+        collision_detector::FindGatherEvents(loot_index, gatherers, events);
+        return events.size();
+    };
+
+    BENCHMARK("CollectObjects, world " + std::to_string(world_size)) {
+        objects_collector::CollectObjects(world.game, world.lost_objects, moves_info, buffers);
+        return buffers.items_events.size();
+    };
+}
+
+TEST_CASE("State response", "[benchmark][json]") {
+    const size_t world_size = GenerateWorldSize();
+    World world{world_size};
+
+    BENCHMARK("FormJsonMapInfo, world " + std::to_string(world_size)) {
+        return json_utils::FormJsonMapInfo(world.session->GetDogs(), world.lost_objects.GetLostObjects("map"s));
+    };
+
+    // ответ с радиусом обзора: сетка перестраивается раз за тик, а запросов за тик много
+    view_grid::ViewGrid grid{VIEW_RADIUS};
+    grid.Rebuild(world.session->GetDogs(), world.lost_objects.GetLostObjects("map"s));
+    view_grid::Visible visible;
+    const Coordinates center = world.session->GetDogs()[0].GetCoords();
+
+    BENCHMARK("FormJsonMapInfo in view radius, world " + std::to_string(world_size)) {
+        grid.FindVisible(center, visible);
+        return json_utils::FormJsonMapInfo(world.session->GetDogs(), world.lost_objects.GetLostObjects("map"s), visible.dogs, visible.loot);
+    };
+
+    BENCHMARK("ViewGrid::Rebuild, world " + std::to_string(world_size)) {
+        grid.Rebuild(world.session->GetDogs(), world.lost_objects.GetLostObjects("map"s));
+        return grid.GetViewRadius();
+    };
+}
+
+TEST_CASE("Token generation", "[benchmark][token]") {
+    players::details::TokenGenerator generator;
+
+    BENCHMARK("GenerateToken") {
+        return generator.GenerateToken();
+    };
+}
+
+TEST_CASE("State snapshot", "[benchmark][snapshot]") {
+    const size_t world_size = GenerateWorldSize();
+    World world{world_size};
+
+    BENCHMARK("MakeModelSerialize, world " + std::to_string(world_size)) {
+        std::ostringstream output;
+        serialization::MakeModelSerialize(output, world.game, world.players, world.lost_objects);
+        return output.tellp();
+    };
+
+    BENCHMARK("EncodeSnapshot, world " + std::to_string(world_size)) {
+        return snapshot_file::EncodeSnapshot(serialization::CaptureState(world.game, world.players, world.lost_objects));
+    };
+
+    const std::vector<char> data = snapshot_file::EncodeSnapshot(serialization::CaptureState(world.game, world.players, world.lost_objects));
+    const auto view = snapshot_file::SnapshotView::Parse(data.data(), data.size());
+
+    BENCHMARK_ADVANCED("RestoreState, world " + std::to_string(world_size))(Catch::Benchmark::Chronometer meter) {
+        // восстановление добавляет к существующему, поэтому у каждого прогона свой пустой мир
+        std::vector<std::unique_ptr<RestoredWorld>> targets;
+        for (int run = 0; run < meter.runs(); ++run) {
+            targets.push_back(std::make_unique<RestoredWorld>(world_size));
+        }
+        meter.measure([&](int run) {
+            auto& target = *targets[run];
+            snapshot_file::RestoreState(view, target.game, target.players, target.lost_objects);
+        });
+    };
+}
+
+TEST_CASE("Retirement check", "[benchmark][retire]") {
+    const size_t world_size = GenerateWorldSize();
+    World world{world_size};
+
+    // срок простоя равен тику: каждый вызов перепроверяет всех игроков, но никто не уходит
+    BENCHMARK("EraseRetiredPlayers, world " + std::to_string(world_size)) {
+        return world.players.EraseRetiredPlayers(world.game, TICK_DELTA, TICK_DELTA);
+    };
+}
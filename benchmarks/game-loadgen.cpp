@@ -0,0 +1,520 @@
+// Нагрузка на игровой API: тысячи виртуальных игроков, у каждого свое keep-alive соединение.
+// Игрок входит в игру, опрашивает state и players, шлет случайные действия, затем замолкает,
+// пока сервер не выведет его по простою, и входит заново.
+// Отдельный игрок-зонд опрашивает state без пауз и следит только за позицией своей собаки:
+// она меняется лишь на тике, а не от чужих действий. Зонд разворачивает собаку после каждого
+// шага, чтобы она не упиралась в конец дороги, и промежутки между шагами приближенно
+// показывают период тиков. Точность ограничена временем ответа на state; простои, когда
+// собака не может идти вдоль выбранной оси, в статистику не попадают.
+// Итог пишется в stdout одной строкой JSON.
+//
+//   ./game_loadgen --host 127.0.0.1 --port 8080 --players 2000 --duration 60 --tick-period 50
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Args {
+    std::string host;
+    std::string port;
+    std::string map_id;
+    unsigned players = 0;
+    unsigned threads = 0;
+    int duration = 0;
+    int ramp_up = 0;
+    int poll_period = 0;
+    int action_period = 0;
+    int active_time = 0;
+    int tick_period = 0;
+};
+
+std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+    Args args;
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("host", po::value(&args.host)->default_value("127.0.0.1"s)->value_name("host"), "server address")
+        ("port", po::value(&args.port)->default_value("8080"s)->value_name("port"), "server port")
+        ("map", po::value(&args.map_id)->value_name("id"), "map to join, the first one by default")
+        ("players", po::value(&args.players)->default_value(1000)->value_name("count"), "virtual players, one connection each")
+        ("threads", po::value(&args.threads)->default_value(std::thread::hardware_concurrency())->value_name("count"), "io threads")
+        ("duration", po::value(&args.duration)->default_value(60)->value_name("seconds"), "test duration")
+        ("ramp-up", po::value(&args.ramp_up)->default_value(5)->value_name("seconds"), "players connect evenly over this time")
+        ("poll-period", po::value(&args.poll_period)->default_value(100)->value_name("milliseconds"), "pause between state and players polls")
+        ("action-period", po::value(&args.action_period)->default_value(500)->value_name("milliseconds"), "pause between actions of an active player")
+        ("active-time", po::value(&args.active_time)->default_value(20000)->value_name("milliseconds"), "how long a player sends actions before going idle")
+        ("tick-period", po::value(&args.tick_period)->default_value(0)->value_name("milliseconds"), "server tick period, to report approximate tick lag");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    args.threads = std::max(1u, args.threads);
+    return args;
+}
+
+enum Endpoint { MAPS, JOIN, STATE, PLAYERS, ACTION, ENDPOINTS_COUNT };
+
+constexpr std::array<std::string_view, ENDPOINTS_COUNT> ENDPOINT_NAMES = {"maps", "join", "state", "players", "action"};
+
+// Задержки ответов одного endpoint'а в микросекундах, их собирают все потоки
+class LatencyStats {
+public:
+    void Add(Clock::duration latency, bool is_ok) {
+        std::lock_guard lock{mutex_};
+        latencies_.push_back(static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+        if (!is_ok) {
+            ++errors_;
+        }
+    }
+
+    // сетевые ошибки: ответа нет, задержка не учитывается
+    void AddFailure() {
+        std::lock_guard lock{mutex_};
+        ++failures_;
+    }
+
+    json::object MakeData() const {
+        std::lock_guard lock{mutex_};
+        auto sorted = latencies_;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile_ms = [&sorted](double fraction) {
+            if (sorted.empty()) {
+                return 0.0;
+            }
+            return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))] / 1000.0;
+        };
+
+        json::object answer;
+        answer["requests"] = sorted.size();
+        answer["http_errors"] = errors_;
+        answer["failures"] = failures_;
+        answer["error_rate"] = sorted.empty() && failures_ == 0 ? 0.0 : double(errors_ + failures_) / double(sorted.size() + failures_);
+        answer["p50_ms"] = percentile_ms(0.5);
+        answer["p90_ms"] = percentile_ms(0.9);
+        answer["p99_ms"] = percentile_ms(0.99);
+        answer["max_ms"] = percentile_ms(1.0);
+        return answer;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::uint32_t> latencies_;
+    std::uint64_t errors_ = 0;
+    std::uint64_t failures_ = 0;
+};
+
+struct Report {
+    std::array<LatencyStats, ENDPOINTS_COUNT> endpoints;
+    std::atomic<std::uint64_t> joins{0};
+    std::atomic<std::uint64_t> retirements{0};
+    std::atomic<std::uint64_t> reconnects{0};
+    // промежутки между шагами собаки зонда
+    LatencyStats probe_moves;
+};
+
+struct Settings {
+    tcp::resolver::results_type endpoints;
+    std::string host;
+    std::string map_id;
+    std::chrono::milliseconds poll_period;
+    std::chrono::milliseconds action_period;
+    std::chrono::milliseconds active_time;
+    Clock::time_point deadline;
+};
+
+/*
+ * Виртуальный игрок. Все его операции идут по очереди на собственном strand'е.
+ * Зонд (is_probe) опрашивает только state, без пауз, и никогда не замолкает;
+ * его собака все время качается взад-вперед по одной оси.
+ */
+class VirtualPlayer : public std::enable_shared_from_this<VirtualPlayer> {
+public:
+    VirtualPlayer(net::io_context& ioc, const Settings& settings, Report& report, unsigned id, bool is_probe)
+        : stream_(net::make_strand(ioc))
+        , timer_(stream_.get_executor())
+        , settings_(settings)
+        , report_(report)
+        , name_((is_probe ? "probe-"s : "bot-"s) + std::to_string(id))
+        , is_probe_(is_probe)
+        , random_(id) {
+    }
+
+    void Start(Clock::duration delay) {
+        Wait(delay, &VirtualPlayer::Connect);
+    }
+
+private:
+    using Response = http::response<http::string_body>;
+    using Step = void (VirtualPlayer::*)();
+
+    void Wait(Clock::duration delay, Step step) {
+        timer_.expires_after(delay);
+        timer_.async_wait([self = shared_from_this(), step](beast::error_code ec) {
+            if (!ec) {
+                ((*self).*step)();
+            }
+        });
+    }
+
+    bool IsStopping() const {
+        return Clock::now() >= settings_.deadline;
+    }
+
+    void Connect() {
+        if (IsStopping()) {
+            return;
+        }
+        stream_.expires_after(10s);
+        stream_.async_connect(settings_.endpoints, [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&) {
+            if (ec) {
+                self->Reconnect();
+                return;
+            }
+            // токен переживает переподключение, входить заново не нужно
+            if (self->token_.empty()) {
+                self->Join();
+            } else {
+                self->Poll();
+            }
+        });
+    }
+
+    void Reconnect() {
+        ++report_.reconnects;
+        beast::error_code ignored;
+        stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+        stream_.close();
+        buffer_.clear();
+        Wait(1s, &VirtualPlayer::Connect);
+    }
+
+    // после ответа вызывается on_response, тело лежит в response_
+    void Send(Endpoint endpoint, http::verb method, std::string_view target, std::string body, Step on_response) {
+        if (IsStopping()) {
+            beast::error_code ignored;
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+            return;
+        }
+
+        request_ = {method, target, 11};
+        request_.set(http::field::host, settings_.host);
+        request_.keep_alive(true);
+        if (!token_.empty()) {
+            request_.set(http::field::authorization, "Bearer " + token_);
+        }
+        if (method == http::verb::post) {
+            request_.set(http::field::content_type, "application/json");
+            request_.body() = std::move(body);
+        }
+        request_.prepare_payload();
+
+        stream_.expires_after(10s);
+        const auto start = Clock::now();
+        http::async_write(stream_, request_, [self = shared_from_this(), endpoint, start, on_response](beast::error_code ec, size_t) {
+            if (ec) {
+                self->report_.endpoints[endpoint].AddFailure();
+                self->Reconnect();
+                return;
+            }
+            self->response_ = {};
+            http::async_read(self->stream_, self->buffer_, self->response_, [self, endpoint, start, on_response](beast::error_code ec, size_t) {
+                if (ec) {
+                    self->report_.endpoints[endpoint].AddFailure();
+                    self->Reconnect();
+                    return;
+                }
+                const auto status = self->response_.result();
+                // 401 на опросе - сервер вывел игрока по простою, это ожидаемый ответ
+                const bool is_ok = http::to_status_class(status) == http::status_class::successful
+                                || (status == http::status::unauthorized && endpoint != JOIN);
+                self->report_.endpoints[endpoint].Add(Clock::now() - start, is_ok);
+                ((*self).*on_response)();
+            });
+        });
+    }
+
+    void Join() {
+        json::object body;
+        body["userName"] = name_;
+        body["mapId"] = settings_.map_id;
+        Send(JOIN, http::verb::post, "/api/v1/game/join", json::serialize(body), &VirtualPlayer::OnJoined);
+    }
+
+    void OnJoined() {
+        boost::system::error_code ec;
+        auto value = json::parse(response_.body(), ec);
+        if (ec || response_.result() != http::status::ok || !value.is_object() || !value.as_object().contains("authToken")) {
+            Wait(1s, &VirtualPlayer::Join);
+            return;
+        }
+        token_ = std::string(value.as_object().at("authToken").as_string());
+        if (const auto* player_id = value.as_object().if_contains("playerId"); player_id != nullptr && player_id->is_int64()) {
+            // у новой собаки тот же id, что у игрока
+            dog_id_ = std::to_string(player_id->as_int64());
+        }
+        last_position_.clear();
+        last_move_ = {};
+        ++report_.joins;
+        active_until_ = is_probe_ ? Clock::time_point::max() : Clock::now() + settings_.active_time;
+        next_action_ = Clock::now();
+        Poll();
+    }
+
+    void Poll() {
+        Send(STATE, http::verb::get, "/api/v1/game/state", {}, &VirtualPlayer::OnState);
+    }
+
+    void OnState() {
+        if (response_.result() == http::status::unauthorized) {
+            // простоял дольше dogRetirementTime: игра началась заново
+            ++report_.retirements;
+            token_.clear();
+            Join();
+            return;
+        }
+
+        if (is_probe_) {
+            OnProbeState();
+            return;
+        }
+
+        Send(PLAYERS, http::verb::get, "/api/v1/game/players", {}, &VirtualPlayer::OnPlayers);
+    }
+
+    // позиция собаки зонда в ответе state, как она записана в JSON
+    std::optional<std::string> FindOwnPosition() const {
+        boost::system::error_code ec;
+        auto value = json::parse(response_.body(), ec);
+        if (ec || !value.is_object()) {
+            return std::nullopt;
+        }
+        const auto* players = value.as_object().if_contains("players");
+        if (players == nullptr || !players->is_object()) {
+            return std::nullopt;
+        }
+        const auto* dog = players->as_object().if_contains(dog_id_);
+        if (dog == nullptr || !dog->is_object()) {
+            return std::nullopt;
+        }
+        const auto* position = dog->as_object().if_contains("pos");
+        if (position == nullptr) {
+            return std::nullopt;
+        }
+        return json::serialize(*position);
+    }
+
+    void OnProbeState() {
+        const auto now = Clock::now();
+        auto position = FindOwnPosition();
+        if (position && *position != last_position_) {
+            if (last_move_ != Clock::time_point{}) {
+                report_.probe_moves.Add(now - last_move_, true);
+            }
+            // первая позиция после входа - еще не шаг, от нее отсчет не ведется
+            last_move_ = last_position_.empty() ? Clock::time_point{} : now;
+            last_position_ = std::move(*position);
+            // шаг назад по той же оси: собака качается на месте и не доходит до конца дороги
+            probe_forward_ = !probe_forward_;
+            SendAction(MakeProbeMove());
+            return;
+        }
+
+        if (now >= next_action_) {
+            // собака стоит дольше action_period: дорога идет по другой оси.
+            // Простой - не опоздание тика, поэтому отсчет начинается заново
+            probe_vertical_ = !probe_vertical_;
+            last_move_ = {};
+            SendAction(MakeProbeMove());
+            return;
+        }
+        Poll();
+    }
+
+    std::string_view MakeProbeMove() const {
+        if (probe_vertical_) {
+            return probe_forward_ ? "D"sv : "U"sv;
+        }
+        return probe_forward_ ? "R"sv : "L"sv;
+    }
+
+    void OnPlayers() {
+        const auto now = Clock::now();
+        // после active_time игрок молчит, пока сервер не выведет его по простою
+        if (now < active_until_ && now >= next_action_) {
+            constexpr std::array<std::string_view, 4> MOVES = {"L", "R", "U", "D"};
+            SendAction(MOVES[random_() % MOVES.size()]);
+        } else {
+            Wait(settings_.poll_period, &VirtualPlayer::Poll);
+        }
+    }
+
+    void SendAction(std::string_view move) {
+        json::object body;
+        body["move"] = move;
+        next_action_ = Clock::now() + settings_.action_period;
+        Send(ACTION, http::verb::post, "/api/v1/game/player/action", json::serialize(body), &VirtualPlayer::OnAction);
+    }
+
+    void OnAction() {
+        if (is_probe_) {
+            Poll();
+        } else {
+            Wait(settings_.poll_period, &VirtualPlayer::Poll);
+        }
+    }
+
+    beast::tcp_stream stream_;
+    net::steady_timer timer_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    Response response_;
+
+    const Settings& settings_;
+    Report& report_;
+    std::string name_;
+    bool is_probe_;
+    std::mt19937 random_;
+
+    std::string token_;
+    Clock::time_point active_until_;
+    Clock::time_point next_action_;
+
+    // только у зонда
+    std::string dog_id_;
+    std::string last_position_;
+    Clock::time_point last_move_;
+    bool probe_vertical_ = false;
+    bool probe_forward_ = false;
+};
+
+// первая карта сервера, если --map не задан
+std::string FetchFirstMap(net::io_context& ioc, const Settings& settings, Report& report) {
+    beast::tcp_stream stream{ioc};
+    stream.expires_after(10s);
+    stream.connect(settings.endpoints);
+
+    http::request<http::empty_body> request{http::verb::get, "/api/v1/maps", 11};
+    request.set(http::field::host, settings.host);
+    const auto start = Clock::now();
+    http::write(stream, request);
+    beast::flat_buffer buffer;
+    http::response<http::string_body> response;
+    http::read(stream, buffer, response);
+    report.endpoints[MAPS].Add(Clock::now() - start, response.result() == http::status::ok);
+
+    auto maps = json::parse(response.body());
+    if (!maps.is_array() || maps.as_array().empty()) {
+        throw std::runtime_error("server has no maps");
+    }
+    return std::string(maps.as_array().front().as_object().at("id").as_string());
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        net::io_context ioc(static_cast<int>(args->threads));
+        Report report;
+        Settings settings;
+        settings.endpoints = tcp::resolver{ioc}.resolve(args->host, args->port);
+        settings.host = args->host;
+        settings.poll_period = std::chrono::milliseconds{args->poll_period};
+        settings.action_period = std::chrono::milliseconds{args->action_period};
+        settings.active_time = std::chrono::milliseconds{args->active_time};
+        settings.map_id = args->map_id.empty() ? FetchFirstMap(ioc, settings, report) : args->map_id;
+
+        const auto start = Clock::now();
+        settings.deadline = start + std::chrono::seconds{args->duration};
+        std::make_shared<VirtualPlayer>(ioc, settings, report, 0, true)->Start(0s);
+        const auto ramp_up = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds{args->ramp_up});
+        for (unsigned i = 0; i < args->players; ++i) {
+            std::make_shared<VirtualPlayer>(ioc, settings, report, i + 1, false)->Start(ramp_up * i / std::max(1u, args->players));
+        }
+
+        // run возвращается, когда после deadline игроки закончили последние запросы
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < args->threads; ++i) {
+            workers.emplace_back([&ioc] {
+                ioc.run();
+            });
+        }
+        ioc.run();
+        workers.clear();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        json::object endpoints;
+        std::uint64_t requests = 0;
+        for (size_t i = 0; i < ENDPOINTS_COUNT; ++i) {
+            auto data = report.endpoints[i].MakeData();
+            requests += data["requests"].as_uint64();
+            endpoints[ENDPOINT_NAMES[i]] = std::move(data);
+        }
+
+        // собака зонда шагает каждый тик: промежутки сверх периода - приближенное опоздание тиков
+        json::object ticks = report.probe_moves.MakeData();
+        ticks["period_ms"] = args->tick_period;
+        if (args->tick_period > 0) {
+            ticks["p50_lag_ms"] = std::max(0.0, ticks["p50_ms"].as_double() - args->tick_period);
+            ticks["p99_lag_ms"] = std::max(0.0, ticks["p99_ms"].as_double() - args->tick_period);
+        }
+
+        json::object result;
+        result["players"] = args->players;
+        result["elapsed_s"] = seconds;
+        result["requests_per_second"] = seconds > 0 ? requests / seconds : 0.0;
+        result["joins"] = report.joins.load();
+        result["retirements"] = report.retirements.load();
+        result["reconnects"] = report.reconnects.load();
+        result["endpoints"] = std::move(endpoints);
+        result["probe_moves"] = std::move(ticks);
+        std::cout << json::serialize(result) << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
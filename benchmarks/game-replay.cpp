@@ -0,0 +1,203 @@
+// Повтор журнала событий без HTTP и без ожидания тикера, с замером скорости симуляции.
+// Журнал пишет сервер с --journal-dir: входы игроков, действия, delta и seed каждого тика.
+// С --print-hashes в stdout идет хеш состояния после каждого тика: по нему сборки сверяются
+// с эталонным выводом. Итог с тиками в секунду и временем этапов пишется в stderr одной строкой JSON.
+//
+//   ./game_replay -c data/config.json --journal-dir journal [--state-file state] [--print-hashes]
+
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../src/game_tick.h"
+#include "../src/journal.h"
+#include "../src/json_loader.h"
+#include "../src/snapshot_shards.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Args {
+    std::string config_file;
+    std::string journal_dir;
+    std::string state_file;
+    bool print_hashes = false;
+};
+
+std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+    Args args;
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("config-file,c", po::value(&args.config_file)->value_name("file"), "config file the journal was written with")
+        ("journal-dir", po::value(&args.journal_dir)->value_name("dir"), "journal to replay")
+        ("state-file", po::value(&args.state_file)->value_name("file"), "snapshot to start from, the journal continues it")
+        ("print-hashes", "print state hash after every tick");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (!vm.contains("config-file"s)) {
+        throw std::runtime_error("Config-file path is not specified"s);
+    }
+    if (!vm.contains("journal-dir"s)) {
+        throw std::runtime_error("Journal dir is not specified"s);
+    }
+    args.print_hashes = vm.contains("print-hashes"s);
+    return args;
+}
+
+// FNV-1a по всему, что меняет тик. Порядок обхода хранилищ определяется событиями, поэтому одинаков при повторе
+class StateHasher {
+public:
+    void Add(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash_ = (hash_ ^ (value >> (i * 8) & 0xff)) * 0x100000001b3ULL;
+        }
+    }
+
+    void Add(double value) {
+        Add(std::bit_cast<std::uint64_t>(value));
+    }
+
+    std::uint64_t Get() const {
+        return hash_;
+    }
+
+private:
+    std::uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+std::uint64_t HashState(const model::Game& game, const extra_data::LostObjectsOnMaps& lost_objects) {
+    StateHasher hasher;
+    for (const auto& session : game.GetGameSession()) {
+        for (const auto& dog : session.GetDogs()) {
+            hasher.Add(static_cast<std::uint64_t>(dog.GetId()));
+            hasher.Add(dog.GetCoords().x);
+            hasher.Add(dog.GetCoords().y);
+            hasher.Add(dog.GetSpeed().horizontal);
+            hasher.Add(dog.GetSpeed().vertical);
+            hasher.Add(static_cast<std::uint64_t>(dog.GetScore()));
+            for (const auto& item : dog.GetBag()) {
+                hasher.Add(static_cast<std::uint64_t>(item.id));
+            }
+        }
+    }
+    for (const auto& map : game.GetMaps()) {
+        const auto& maps_loot = lost_objects.GetLostObjectsOnMaps();
+        auto loot = maps_loot.find(*map.GetId());
+        if (loot == maps_loot.end()) {
+            continue;
+        }
+        for (const auto& object : loot->second.GetObjects()) {
+            hasher.Add(static_cast<std::uint64_t>(object.id));
+            hasher.Add(object.coords.x);
+            hasher.Add(object.coords.y);
+        }
+    }
+    return hasher.Get();
+}
+
+std::string ToHex(std::uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+double ToMilliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        json_loader::GameInfo game_info = json_loader::LoadGame(fs::path(args->config_file));
+        model::Game& game = game_info.game;
+        extra_data::LostObjectsOnMaps lost_objects{game_info.possible_loot};
+        players::Players players;
+        objects_collector::CollectorBuffers buffers;
+
+        std::uint64_t first_segment = 0;
+        if (!args->state_file.empty()) {
+            first_segment = snapshot_shards::RestoreSnapshot(args->state_file, game, players, lost_objects);
+        }
+
+        // события читаются заранее, чтобы замер не включал чтение с диска
+        std::vector<journal::Event> events;
+        journal::Journal journal{journal::JournalConfig{args->journal_dir}};
+        journal.Replay(first_segment, [&events](const journal::Event& event) {
+            events.push_back(event);
+        });
+
+        game_tick::TickTimings timings;
+        std::chrono::nanoseconds input_time{0};
+        std::uint64_t ticks = 0;
+        std::int64_t simulated_ms = 0;
+        size_t retired = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& event : events) {
+            const auto* tick = std::get_if<journal::TickEvent>(&event);
+            if (tick == nullptr) {
+                const auto input_start = std::chrono::steady_clock::now();
+                game_tick::ApplyEvent(game, players, lost_objects, buffers, game_info.retired_time, event);
+                input_time += std::chrono::steady_clock::now() - input_start;
+                continue;
+            }
+
+            retired += game_tick::ApplyEvent(game, players, lost_objects, buffers, game_info.retired_time, event, &timings).size();
+            ++ticks;
+            simulated_ms += tick->delta;
+            if (args->print_hashes) {
+                std::cout << ticks << ' ' << ToHex(HashState(game, lost_objects)) << '\n';
+            }
+        }
+        const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+
+        boost::json::object phases;
+        phases["actions_ms"] = ToMilliseconds(timings.actions);
+        phases["loot_generation_ms"] = ToMilliseconds(timings.loot_generation);
+        phases["collection_ms"] = ToMilliseconds(timings.collection);
+        phases["retirement_ms"] = ToMilliseconds(timings.retirement);
+        phases["input_ms"] = ToMilliseconds(input_time);
+
+        boost::json::object report;
+        report["events"] = events.size();
+        report["ticks"] = ticks;
+        report["simulated_ms"] = simulated_ms;
+        report["retired_players"] = retired;
+        report["elapsed_ms"] = ToMilliseconds(elapsed);
+        report["ticks_per_second"] = seconds > 0 ? ticks / seconds : 0.0;
+        report["phases"] = std::move(phases);
+        report["final_hash"] = ToHex(HashState(game, lost_objects));
+        std::cerr << boost::json::serialize(report) << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
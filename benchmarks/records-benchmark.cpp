@@ -0,0 +1,108 @@
+// Пропускная способность записи результатов в Postgres.
+// Нужна отдельная пустая БД: GAME_BENCH_DB_URL=postgres://... ./records_benchmark
+// Таблица retired_players очищается после каждого замера.
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <boost/uuid/random_generator.hpp>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../src/postgres.h"
+
+using namespace std::literals;
+namespace {
+
+std::vector<domain::Record> MakeRecords(size_t count) {
+    std::vector<domain::Record> records;
+    records.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        records.emplace_back(domain::RecordId::New(), "dog "s + std::to_string(i), static_cast<int>(i % 1000), static_cast<int>(i * 7 % 100000));
+    }
+    return records;
+}
+
+const char* GetBenchDbUrl() {
+    return std::getenv("GAME_BENCH_DB_URL");
+}
+
+// каждому прогону свои записи, иначе ON CONFLICT превратит повторы в пустые вставки
+std::vector<std::vector<domain::Record>> MakeBatches(int runs, size_t batch_size) {
+    std::vector<std::vector<domain::Record>> batches;
+    batches.reserve(runs);
+    for (int run = 0; run < runs; ++run) {
+        batches.push_back(MakeRecords(batch_size));
+    }
+    return batches;
+}
+
+void Cleanup(pqxx::connection& conn) {
+    pqxx::work work{conn};
+    work.exec("TRUNCATE retired_players;");
+    work.commit();
+}
+
+}  // namespace
+
+TEST_CASE("Records insertion throughput", "[postgres]") {
+    const char* db_url = GetBenchDbUrl();
+    if (db_url == nullptr) {
+        WARN("GAME_BENCH_DB_URL is not set, benchmark skipped");
+        return;
+    }
+    // io_context не запускается: бенчмарк берет соединение синхронно
+    net::io_context ioc;
+    PoolConfig pool_config;
+    pool_config.max_size = 1;
+    postgres::Database db{ioc, pool_config, db_url};
+
+    const size_t batch_size = GENERATE(16, 256, 4096);
+
+    BENCHMARK_ADVANCED("single-row prepared insert, batch " + std::to_string(batch_size))(Catch::Benchmark::Chronometer meter) {
+        auto batches = MakeBatches(meter.runs(), batch_size);
+        auto repo = db.GetRecordRepo();
+        meter.measure([&](int run) {
+            pqxx::work work{repo->GetConnection()};
+            for (const auto& record : batches[run]) {
+                repo->Save(record, work);
+            }
+            work.commit();
+        });
+        Cleanup(repo->GetConnection());
+    };
+
+    BENCHMARK_ADVANCED("multi-row prepared insert, batch " + std::to_string(batch_size))(Catch::Benchmark::Chronometer meter) {
+        auto batches = MakeBatches(meter.runs(), batch_size);
+        auto repo = db.GetRecordRepo();
+        meter.measure([&](int run) {
+            pqxx::work work{repo->GetConnection()};
+            repo->InsertRecords(batches[run], work);
+            work.commit();
+        });
+        Cleanup(repo->GetConnection());
+    };
+
+    BENCHMARK_ADVANCED("copy, batch " + std::to_string(batch_size))(Catch::Benchmark::Chronometer meter) {
+        auto batches = MakeBatches(meter.runs(), batch_size);
+        auto repo = db.GetRecordRepo();
+        meter.measure([&](int run) {
+            pqxx::work work{repo->GetConnection()};
+            repo->CopyRecords(batches[run], work);
+            work.commit();
+        });
+        Cleanup(repo->GetConnection());
+    };
+}
+
+TEST_CASE("Record id generation", "[uuid]") {
+    BENCHMARK("generator per id") {
+        return boost::uuids::random_generator()();
+    };
+
+    BENCHMARK("reused generator") {
+        return domain::RecordId::New();
+    };
+}
@@ -1,8 +1,9 @@
 #include "api_request_handler.h"
 #include "log_utils.h"
+#include "snapshot_shards.h"
 
 #include <boost/json.hpp>
-#include <boost/archive/binary_iarchive.hpp>
+#include <cstdlib>
 
 namespace api_request_handler{
 
@@ -23,63 +24,6 @@ namespace details{
         return true;
     }  
 
-    std::string ConvertGeoDirToMoveDir(model::DirectionGeo geo){
-        switch (geo){
-        case model::DirectionGeo::NORTH:
-            return "U";
-        case model::DirectionGeo::SOUTH:
-            return "D";
-        case model::DirectionGeo::WEST:
-            return "L";
-        case model::DirectionGeo::EAST:
-            return "R";
-        default:
-            return "";
-        }
-    }
-
-    model::DirectionGeo ConvertCharToDir(char dir){
-        switch (dir)
-        {
-        case 'U':
-            return model::DirectionGeo::NORTH;
-        case 'D':
-            return model::DirectionGeo::SOUTH;
-        case 'L':
-            return model::DirectionGeo::WEST;
-        case 'R':
-            return model::DirectionGeo::EAST;
-        default:
-            return model::DirectionGeo::NONE;
-        }
-    }
-
-    model::Speed MoveDirectionToSpeed(char move_dir, double dog_speed){
-        if(move_dir == '\0'){
-            return model::Speed{0, 0};
-        }
-
-        model::Speed dog_dir_speed_;
-        switch (move_dir){
-        case 'U':
-            dog_dir_speed_.vertical = -dog_speed;
-            break;
-        case 'D':
-            dog_dir_speed_.vertical = dog_speed;
-            break;
-        case 'L':
-            dog_dir_speed_.horizontal = -dog_speed;
-            break;
-        case 'R': 
-            dog_dir_speed_.horizontal = dog_speed;
-            break;
-        default:
-            assert(false);
-        }
-
-        return dog_dir_speed_;
-    }
-
     bool IsValidActionBody(const std::optional<std::string>& move_dir){
         if(!move_dir.has_value()){
             return false;
@@ -125,31 +69,26 @@ namespace details{
                                                             version, keep_alive, request_handle_utils::ContentType::APPLICATION_JSON, allow);
     }
 
+    // Authorization: Bearer <32 hex-символа>. Токен разбирается прямо из заголовка, без копий
     std::optional<players::Token> TryExtractToken(const StringRequest& request){
-        std::string auth;
-        if(auto it = request.find(http::field::authorization); it != request.end()){
-            auth = it->value();
-        }
-
-        std::string token; 
-        size_t bearer = auth.find_first_of("Bearer");
-
-        if(bearer == std::string::npos){
+        auto it = request.find(http::field::authorization);
+        if(it == request.end()){
             return std::nullopt;
         }
 
-        size_t token_start = auth.find_first_not_of(' ', bearer + 7);
-        try{
-            token = auth.substr(token_start, auth.find_first_of(' ', token_start) - token_start);
-        }catch(...){
-            return std::nullopt;
-        }
+        constexpr auto BEARER = "Bearer"sv;
+        std::string_view auth{it->value().data(), it->value().size()};
+        auto trim_spaces = [](std::string_view str){
+            str.remove_prefix(std::min(str.find_first_not_of(' '), str.size()));
+            str.remove_suffix(str.size() - std::min(str.find_last_not_of(' ') + 1, str.size()));
+            return str;
+        };
 
-        if(token.size() != 32){
+        auth = trim_spaces(auth);
+        if(!auth.starts_with(BEARER)){
             return std::nullopt;
         }
-
-        return players::Token{token};
+        return players::Token::Parse(trim_spaces(auth.substr(BEARER.size())));
     }
 
     template <typename Func>
@@ -166,53 +105,58 @@ ApiRequestHandler::ApiRequestHandler(model::Game& game
                         , int milliseconds
                         , bool is_random_generate
                         , serializing_listener::ApplicationListener* app_listener
-                        , std::shared_ptr<postgres::Database> db
-                        , int retired_time)
-                        : game_(game), lost_objects_(lost_objects), app_listener_(app_listener), db_(db), retired_time_(retired_time){
+                        , std::shared_ptr<leaderboard::Leaderboard> leaderboard
+                        , std::shared_ptr<record_writer::RecordWriter> record_writer
+                        , int retired_time
+                        , std::shared_ptr<journal::Journal> journal)
+                        : game_(game), lost_objects_(lost_objects), app_listener_(app_listener), leaderboard_(leaderboard)
+                        , record_writer_(record_writer), retired_time_(retired_time), journal_(std::move(journal)){
     game_.SetRandomGenerate(is_random_generate);
-    
+
+    if(milliseconds == 0){
+        is_test_version = true;
+    }
+    else{
+        is_test_version = false;
+    }
+}
+
+void ApiRequestHandler::Restore(){
+    std::uint64_t journal_segment = 0;
     if(app_listener_ != nullptr){
-        std::ifstream in_file(dynamic_cast<serializing_listener::SerializingListener*>(app_listener_)->GetPath(), std::ios::binary | std::ios::in);
-        if(in_file.is_open()){
-            try{
-                boost::archive::binary_iarchive ar{in_file};
+        journal_segment = LoadSnapshot();
+    }
 
-                std::vector<serialization::GameSessionRepr> game_sessions_repr;
-                serialization::PlayersRepr players_repr;
-                std::unordered_map<std::string, std::vector<serialization::LostObjectRepr>> lost_objects_repr;            
+    if(journal_){
+        // события после снимка повторяются до того, как журнал начнет принимать новые
+        size_t replayed = journal_->Replay(journal_segment, [this](const journal::Event& event){
+            ApplyEvent(event);
+        });
+        journal_->Start();
 
-                ar >> game_sessions_repr;
-                ar >> players_repr;
-                ar >> lost_objects_repr;
+        json::object replay_data;
+        replay_data.insert(value_type("segment", journal_segment));
+        replay_data.insert(value_type("events", replayed));
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, replay_data)
+                                << "journal replayed";
+    }
+}
 
-                for(auto game_session_repr : game_sessions_repr){
-                    game_.AddGameSession(game_session_repr.Restore(game_, is_random_generate));
-                }
-                players_ = players_repr.Restore(game_);
-
-                std::unordered_map<std::string, std::vector<extra_data::LostObject>> lost_objs;
-                for(auto [map_id, lost_obj] : lost_objects_repr){
-                    lost_objs[map_id] = {};
-                    for(auto object : lost_obj){
-                        lost_objs[map_id].push_back(object.Restore());
-                    }
-                }
-                lost_objects_.SetLostObjectsOnMaps(std::move(lost_objs));
-            }
-            catch(std::exception& e){
-                BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
-                                        << logging::add_value(additional_data, log_data::MakeServerExitedData(1, e.what()))
-                                        << "server exited with deserialize error";
-                throw e;
-            }
-        }
+std::uint64_t ApiRequestHandler::LoadSnapshot(){
+    const auto& path = dynamic_cast<serializing_listener::SerializingListener*>(app_listener_)->GetPath();
+    if(!fs::exists(path)){
+        return 0;
     }
 
-    if(milliseconds == 0){
-        is_test_version = true;
+    try{
+        return snapshot_shards::RestoreSnapshot(path, game_, players_, lost_objects_);
     }
-    else{
-        is_test_version = false;
+    catch(const std::exception& e){
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, log_data::MakeServerExitedData(1, e.what()))
+                                << "server exited with deserialize error";
+        throw;
     }
 }
 
@@ -242,10 +186,11 @@ std::string ApiRequestHandler::GetMapInfo(std::string_view id){
     return json::serialize(map_obj);
 }
 
-std::string ApiRequestHandler::MakeJsonAuthAnswer(std::string token, int player_id){
+std::string ApiRequestHandler::MakeJsonAuthAnswer(const players::Token& token, int player_id){
     json::object auth_answer;
 
-    auth_answer.insert(value_type("authToken", token));
+    auto token_chars = token.ToChars();
+    auth_answer.insert(value_type("authToken", std::string_view(token_chars.data(), token_chars.size())));
     auth_answer.insert(value_type("playerId", player_id));
 
     return json::serialize(auth_answer);
@@ -263,65 +208,31 @@ std::string ApiRequestHandler::FormJsonPlayersMap(const std::vector<std::pair<in
     return json::serialize(players_json);
 }
 
-std::string ApiRequestHandler::FormJsonMapInfo(const std::unordered_map<std::uint64_t, std::shared_ptr<model::Dog>>& dogs, const std::string& map_id){
-    json::object map_info;
-
-    json::object dogs_json;
-    for(auto [id, dog] : dogs){
-        json::object dog_info;
-
-        json::array coords;
-        model::Coordinates dog_coords = dog->GetCoords();
-        coords.push_back(dog_coords.x);
-        coords.push_back(dog_coords.y);
-        dog_info.insert(value_type("pos", coords));
-
-        json::array speed;
-        model::Speed dog_speed = dog->GetSpeed();
-        speed.push_back(dog_speed.horizontal);
-        speed.push_back(dog_speed.vertical);
-        dog_info.insert(value_type("speed", speed));
-
-        dog_info.insert(value_type("dir", details::ConvertGeoDirToMoveDir(dog->GetDir())));
-
-        json::array bag;
-        for(auto item : dog->GetBag()){
-            json::object item_object;
-            item_object.insert(value_type("id", item.id));
-            item_object.insert(value_type("type", item.type));
-
-            bag.push_back(item_object);
-        }
-
-        dog_info.insert(value_type("bag", bag));
-        dog_info.insert(value_type("score", dog->GetScore()));
-
-        dogs_json.insert(value_type(std::to_string(id), dog_info));
+std::string ApiRequestHandler::FormState(const players::Player& player, const model::GameSession& game_session){
+    const extra_data::Loot& lost_objects = lost_objects_.GetLostObjects(player.GetMapId());
+    const double view_radius = game_session.GetMap()->GetViewRadius();
+    const model::Dog* dog = game_session.FindDog(player.GetDog());
+    if(view_radius <= 0 || dog == nullptr){
+        return json_utils::FormJsonMapInfo(game_session.GetDogs(), lost_objects);
     }
-    map_info.insert(value_type("players", dogs_json));
 
-    json::object lost_objects_json;
-    for(auto lost_obj : lost_objects_.GetLostObjects(map_id)){
-        json::object lost_obj_json;
-
-        json::array coords;
-        coords.push_back(lost_obj.coords.x);
-        coords.push_back(lost_obj.coords.y);
-
-        lost_obj_json.insert(value_type("pos", coords));
-        lost_obj_json.insert(value_type("type", lost_obj.type));
-        lost_objects_json.insert(value_type(std::to_string(lost_obj.id), lost_obj_json));
+    auto cache = view_grids_.find(player.GetMapId());
+    if(cache == view_grids_.end()){
+        cache = view_grids_.emplace(player.GetMapId(), ViewGridCache{view_grid::ViewGrid{view_radius}}).first;
+    }
+    if(cache->second.world_version != world_version_){
+        cache->second.grid.Rebuild(game_session.GetDogs(), lost_objects);
+        cache->second.world_version = world_version_;
     }
-    map_info.insert(value_type("lostObjects", lost_objects_json));
 
-    return json::serialize(map_info);
+    cache->second.grid.FindVisible(dog->GetCoords(), visible_);
+    return json_utils::FormJsonMapInfo(game_session.GetDogs(), lost_objects, visible_.dogs, visible_.loot);
 }
 
-std::string ApiRequestHandler::FormRecords(int start, int max_items) const{
+std::string ApiRequestHandler::FormRecords(const std::vector<domain::Record>& records) const{
     json::array records_json;
 
-    auto records = db_->GetRecordRepo()->GetRecords(start, max_items);
-    for(auto record : records){
+    for(const auto& record : records){
         json::object record_json;
         record_json.insert(json::object::value_type("name", record.GetDogName()));
         record_json.insert(json::object::value_type("score", record.GetScore()));
@@ -337,13 +248,13 @@ StringResponse ApiRequestHandler::GetPlayers(const StringRequest& request){
         return details::MakeNotAllowedMethodError("invalidMethod", "Invalid method", request.version(), request.keep_alive(), "GET, HEAD");
     }
 
-    return details::ExecuteAuthorized([request, this](const players::Token& token){
-                players::Player* player = players_.FindByToken(players::Token{token});
+    return details::ExecuteAuthorized([&request, this](const players::Token& token){
+                players::Player* player = players_.FindByToken(token);
                 if(player == nullptr){
                     return details::MakeUnauthorizeError("unknownToken", "Player token has not been found", request.version(), request.keep_alive());
                 }
 
-                return request_handle_utils::MakeStringResponse(http::status::ok, FormJsonPlayersMap(player->GetGameSession()->GetPlayersInfo()),
+                return request_handle_utils::MakeStringResponse(http::status::ok, FormJsonPlayersMap(game_.FindGameSession(player->GetGameSession())->GetPlayersInfo()),
                                                 request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
             }, 
             request);
@@ -354,13 +265,13 @@ StringResponse ApiRequestHandler::GetState(const StringRequest& request){
         return details::MakeNotAllowedMethodError("invalidMethod", "Invalid method", request.version(), request.keep_alive(), "GET, HEAD");
     }
 
-    return details::ExecuteAuthorized([request, this](const players::Token& token){
-                players::Player* player = players_.FindByToken(players::Token{token});
+    return details::ExecuteAuthorized([&request, this](const players::Token& token){
+                players::Player* player = players_.FindByToken(token);
                 if(player == nullptr){
                     return details::MakeUnauthorizeError("unknownToken", "Player token has not been found", request.version(), request.keep_alive());
                 }
                 
-                return request_handle_utils::MakeStringResponse(http::status::ok, FormJsonMapInfo(player->GetGameSession()->GetDogs(), player->GetMapId()),
+                return request_handle_utils::MakeStringResponse(http::status::ok, FormState(*player, *game_.FindGameSession(player->GetGameSession())),
                                                 request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
             },
             request);
@@ -371,8 +282,8 @@ StringResponse ApiRequestHandler::MakeAction(const StringRequest& request){
         return details::MakeNotAllowedMethodError("invalidMethod", "Invalid method", request.version(), request.keep_alive(), "POST");
     }
 
-    return details::ExecuteAuthorized([request, this](const players::Token& token){
-                players::Player* player = players_.FindByToken(players::Token{token});
+    return details::ExecuteAuthorized([&request, this](const players::Token& token){
+                players::Player* player = players_.FindByToken(token);
                 if(player == nullptr){
                     return details::MakeUnauthorizeError("unknownToken", "Player token has not been found", request.version(), request.keep_alive());
                 }
@@ -386,10 +297,10 @@ StringResponse ApiRequestHandler::MakeAction(const StringRequest& request){
                     return details::MakeBadRequestError("invalidArgument", "Failed to parse action", request.version(), request.keep_alive());
                 }
 
-                model::Speed dog_speed = details::MoveDirectionToSpeed((*dog_move_dir)[0],
-                                                                       player->GetGameSession()->GetMapDogSpeed());                
-                player->SetDogSpeed(dog_speed);
-                player->SetDogDir(details::ConvertCharToDir((*dog_move_dir)[0]));
+                game_tick::ApplyMove(game_, *player, (*dog_move_dir)[0]);
+                if(journal_){
+                    journal_->Append(journal::MoveEvent{token, (*dog_move_dir)[0]});
+                }
 
                 return request_handle_utils::MakeStringResponse(http::status::ok, "{}",
                                                 request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
@@ -422,8 +333,13 @@ StringResponse ApiRequestHandler::JoinPlayer(const StringRequest& request){
     }
 
     players::Player* player = players_.AddPlayer(user_info.name_, game_session);
+    ++world_version_;
+    if(journal_){
+        journal_->Append(journal::JoinEvent{user_info.map_id_, user_info.name_, player->GetToken(), player->GetId()
+                                            , game_session->FindDog(player->GetDog())->GetCoords()});
+    }
     
-    return request_handle_utils::MakeStringResponse(http::status::ok, MakeJsonAuthAnswer(*(player->GetToken()), player->GetId()),
+    return request_handle_utils::MakeStringResponse(http::status::ok, MakeJsonAuthAnswer(player->GetToken(), player->GetId()),
                                     request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
 }
 
@@ -464,23 +380,57 @@ StringResponse ApiRequestHandler::SetTimeDelta(const StringRequest& request){
                                                 request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
 }
 
-StringResponse ApiRequestHandler::GetRecords(const StringRequest& request, int start, int max_items) const{
+StringResponse ApiRequestHandler::GetRecords(const StringRequest& request, int start, int max_items, const std::optional<std::string>& after) const{
     if(start < 0 || max_items < 0 || max_items > 100){
         return details::MakeBadRequestError("invalidArgument", "Invalid arguments", request.version(), request.keep_alive());
     }
-    return request_handle_utils::MakeStringResponse(http::status::ok, FormRecords(start, max_items),
+
+    // страница зависит только от таблицы (ее версии в этом процессе) и параметров запроса, которые уже есть в URL
+    std::string etag = leaderboard_->MakeETag(leaderboard_->GetVersion());
+    if(auto it = request.find(http::field::if_none_match); it != request.end() && it->value() == etag){
+        StringResponse response = request_handle_utils::MakeStringResponse(http::status::not_modified, "",
+                                                request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
+        response.set(http::field::etag, etag);
+        return response;
+    }
+
+    leaderboard::Leaderboard::Page page;
+    if(after.has_value()){
+        auto cursor = leaderboard::DecodeCursor(*after);
+        if(!cursor.has_value()){
+            return details::MakeBadRequestError("invalidArgument", "Invalid cursor", request.version(), request.keep_alive());
+        }
+        page = leaderboard_->GetPageAfter(*cursor, max_items);
+    }
+    else{
+        page = leaderboard_->GetPage(start, max_items);
+    }
+
+    StringResponse response = request_handle_utils::MakeStringResponse(http::status::ok, FormRecords(page.records),
                                                 request.version(), request.keep_alive(), request_handle_utils::ContentType::APPLICATION_JSON);
+    response.set(http::field::etag, leaderboard_->MakeETag(page.version));
+    if(page.next_cursor.has_value()){
+        response.set("X-Next-Cursor", *page.next_cursor);
+    }
+    return response;
 }
 
 void ApiRequestHandler::Tick(int delta){
-    auto moves_info = game_.MakeActionsAtTime(delta);
-    lost_objects_.GenerateLostObjectsOnMaps(delta, game_);
-    objects_collector::CollectObjects(game_, lost_objects_, moves_info);
-    auto retired_dogs_id = players_.EraseRetiredPlayers(retired_time_);
-    auto records_result = game_.EraseRetiredDogs(retired_dogs_id);
+    // вся случайность тика идет от генераторов сессий, а их задает seed тика, поэтому в журнале достаточно его
+    std::uint32_t seed = game_.NextTickSeed();
+    auto records_result = Simulate(delta);
+
+    if(journal_){
+        std::vector<journal::Event> events{journal::TickEvent{delta, seed}};
+        if(!records_result.empty()){
+            events.push_back(journal::RetireEvent{records_result});
+        }
+        journal_->Append(events);
+    }
 
     if(!records_result.empty()){
-        db_->GetRecordRepo()->SaveRecords(records_result);
+        // запись в БД идет в фоне, тик ее не ждет
+        record_writer_->Enqueue(std::move(records_result));
     }
 
     if(app_listener_){
@@ -488,4 +438,20 @@ void ApiRequestHandler::Tick(int delta){
     }
 }
 
+std::vector<domain::Record> ApiRequestHandler::Simulate(int delta){
+    ++world_version_;
+    return game_tick::Simulate(game_, players_, lost_objects_, collector_buffers_, delta, retired_time_);
+}
+
+void ApiRequestHandler::ApplyEvent(const journal::Event& event){
+    if(const auto* retire = std::get_if<journal::RetireEvent>(&event)){
+        // уже сохраненные id пропускают и Postgres (ON CONFLICT), и журнал рекордов (по индексу)
+        record_writer_->Enqueue(std::vector<domain::Record>(retire->records));
+        return;
+    }
+    ++world_version_;
+    // ушедшие в тике игроки придут следующим RetireEvent с исходными id
+    game_tick::ApplyEvent(game_, players_, lost_objects_, collector_buffers_, retired_time_, event);
+}
+
 } // api_request_handler
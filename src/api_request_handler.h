@@ -8,13 +8,17 @@
 #include <string>
 
 #include "objects_collector.h"
+#include "game_tick.h"
 #include "request_handle_utils.h"
 #include "model.h"
 #include "player.h"
 #include "json_utils.h"
 #include "extra_data.h"
 #include "serializing_listener.h"
-#include "postgres.h"
+#include "leaderboard.h"
+#include "record_writer.h"
+#include "journal.h"
+#include "view_grid.h"
 
 namespace fs = std::filesystem;
 
@@ -45,8 +49,10 @@ public:
                     , int milliseconds
                     , bool is_random_generate
                     , serializing_listener::ApplicationListener* app_listener
-                    , std::shared_ptr<postgres::Database> db
-                    , int retired_time);
+                    , std::shared_ptr<leaderboard::Leaderboard> leaderboard
+                    , std::shared_ptr<record_writer::RecordWriter> record_writer
+                    , int retired_time
+                    , std::shared_ptr<journal::Journal> journal = nullptr);
 
     template <typename SomeRequest>
     Response HandleRequest(SomeRequest&& request, std::string target){
@@ -84,17 +90,21 @@ public:
                 if(std::string(uv.encoded_path()) == "/records"){
                     int start = 0;
                     int max_items = 100;
+                    std::optional<std::string> after;
                     if(uv.encoded_params().find("start") != uv.encoded_params().end()){
                         start = std::stoi(std::string(uv.encoded_params().find("start")->value));
                     }
                     if(uv.encoded_params().find("maxItems") != uv.encoded_params().end()){
                         max_items = std::stoi(std::string(uv.encoded_params().find("maxItems")->value));
                     }
-
+                    if(uv.encoded_params().find("after") != uv.encoded_params().end()){
+                        after = std::string(uv.encoded_params().find("after")->value);
+                    }
 
                     return GetRecords(request
                                     , start
-                                    , max_items);
+                                    , max_items
+                                    , after);
                 }
             }
         }
@@ -104,6 +114,10 @@ public:
 
     void Tick(int delta);
 
+    // Загружает снимок и повторяет журнал. Вызывается один раз при запуске,
+    // до первого запроса к игре и первого тика
+    void Restore();
+
     const model::Game& GetGame(){
         return game_;
     }
@@ -117,22 +131,42 @@ public:
     }
 
 private:
-    std::shared_ptr<postgres::Database> db_;
+    std::shared_ptr<leaderboard::Leaderboard> leaderboard_;
+    std::shared_ptr<record_writer::RecordWriter> record_writer_;
     model::Game& game_;
     extra_data::LostObjectsOnMaps& lost_objects_;
     players::Players players_;
     serializing_listener::ApplicationListener* app_listener_;
     int retired_time_;
+    // буферы сбора предметов, переживают тик
+    objects_collector::CollectorBuffers collector_buffers_;
+    std::shared_ptr<journal::Journal> journal_;
+
+    // Сетки обзора карт с радиусом обзора. Перестраиваются при первом /state после изменения мира,
+    // то есть не чаще раза за тик
+    struct ViewGridCache{
+        view_grid::ViewGrid grid;
+        std::uint64_t world_version = 0;
+    };
+    std::unordered_map<std::string, ViewGridCache> view_grids_;
+    view_grid::Visible visible_;
+    // растет при каждом входе игрока и тике
+    std::uint64_t world_version_ = 1;
 
     bool is_test_version;
 
+    // изменения состояния, общие для запросов и повтора журнала
+    std::vector<domain::Record> Simulate(int delta);
+    void ApplyEvent(const journal::Event& event);
+    std::uint64_t LoadSnapshot();
+
     std::string GetMaps();
     std::string GetMapInfo(std::string_view id);
 
-    std::string MakeJsonAuthAnswer(std::string token, int player_id);
+    std::string MakeJsonAuthAnswer(const players::Token& token, int player_id);
     std::string FormJsonPlayersMap(const std::vector<std::pair<int, std::string>>& players);
-    std::string FormJsonMapInfo(const std::unordered_map<std::uint64_t, std::shared_ptr<model::Dog>>& dogs, const std::string& map_id);
-    std::string FormRecords(int start, int max_items) const;
+    std::string FormRecords(const std::vector<domain::Record>& records) const;
+    std::string FormState(const players::Player& player, const model::GameSession& game_session);
 
     StringResponse GetPlayers(const StringRequest& request);
     StringResponse GetState(const StringRequest& request);
@@ -140,7 +174,7 @@ private:
     StringResponse GetMapsResponse(const StringRequest& request, const std::string& target);
     StringResponse MakeAction(const StringRequest& request);
     StringResponse SetTimeDelta(const StringRequest& request);
-    StringResponse GetRecords(const StringRequest& request, int start, int max_items) const;
+    StringResponse GetRecords(const StringRequest& request, int start, int max_items, const std::optional<std::string>& after) const;
 
     bool IsContainsMap(std::string_view id) const{
         return game_.FindMap(model::Map::Id{std::string(id)}) != nullptr;
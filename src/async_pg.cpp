@@ -0,0 +1,284 @@
+#include "async_pg.h"
+
+#include <unistd.h>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+
+namespace async_pg{
+
+namespace details{
+
+    class ErrorCategory : public boost::system::error_category{
+    public:
+        const char* name() const noexcept override{
+            return "async_pg";
+        }
+
+        std::string message(int ev) const override{
+            switch(static_cast<Errc>(ev)){
+                case Errc::CONNECTION_FAILED:
+                    return "connection to database failed";
+                case Errc::CONNECTION_LOST:
+                    return "connection to database lost";
+                case Errc::QUERY_FAILED:
+                    return "query failed";
+            }
+            return "unknown error";
+        }
+    };
+
+    std::string GetErrorMessage(PGconn* conn){
+        const char* message = PQerrorMessage(conn);
+        return message == nullptr ? std::string{} : std::string(message);
+    }
+
+} // details
+
+const boost::system::error_category& GetErrorCategory(){
+    static const details::ErrorCategory category;
+    return category;
+}
+
+boost::system::error_code make_error_code(Errc errc){
+    return {static_cast<int>(errc), GetErrorCategory()};
+}
+
+Result::Result(PGresult* result)
+    : result_(result, &PQclear){
+    if(!IsOk()){
+        const char* message = PQresultErrorMessage(result);
+        error_message_ = message == nullptr ? std::string{} : std::string(message);
+    }
+}
+
+bool Result::IsOk() const{
+    if(!result_){
+        return false;
+    }
+    auto status = PQresultStatus(result_.get());
+    return status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+}
+
+int Result::GetRowCount() const{
+    return result_ ? PQntuples(result_.get()) : 0;
+}
+
+int Result::GetColumnCount() const{
+    return result_ ? PQnfields(result_.get()) : 0;
+}
+
+bool Result::IsNull(int row, int column) const{
+    return PQgetisnull(result_.get(), row, column) == 1;
+}
+
+std::string_view Result::GetValue(int row, int column) const{
+    return {PQgetvalue(result_.get(), row, column), static_cast<size_t>(PQgetlength(result_.get(), row, column))};
+}
+
+Connection::Connection(PrivateTag, net::any_io_executor executor, PGconn* conn)
+    : strand_(net::make_strand(executor))
+    , conn_(conn)
+    , socket_(strand_){
+}
+
+Connection::~Connection(){
+    // дескриптор сокета в asio - это dup, его закрывает сам stream_descriptor
+    PQfinish(conn_);
+}
+
+void Connection::StartConnect(net::any_io_executor executor, std::string conninfo, ConnectHandler handler){
+    PGconn* conn = PQconnectStart(conninfo.c_str());
+    if(conn == nullptr){
+        handler(Errc::CONNECTION_FAILED, nullptr);
+        return;
+    }
+
+    auto connection = std::make_shared<Connection>(PrivateTag{}, executor, conn);
+    if(PQstatus(conn) == CONNECTION_BAD || !connection->UpdateSocket()){
+        handler(Errc::CONNECTION_FAILED, nullptr);
+        return;
+    }
+
+    // по документации libpq сначала надо дождаться готовности сокета к записи
+    connection->socket_.async_wait(net::posix::stream_descriptor::wait_write
+                                 , net::bind_executor(connection->strand_, [connection, handler](boost::system::error_code ec){
+        if(ec){
+            handler(Errc::CONNECTION_FAILED, nullptr);
+            return;
+        }
+        connection->PollConnect(handler);
+    }));
+}
+
+void Connection::PollConnect(ConnectHandler handler){
+    auto status = PQconnectPoll(conn_);
+
+    if(status == PGRES_POLLING_OK){
+        if(PQsetnonblocking(conn_, 1) != 0){
+            handler(Errc::CONNECTION_FAILED, nullptr);
+            return;
+        }
+        handler({}, shared_from_this());
+        return;
+    }
+    if(status == PGRES_POLLING_FAILED || !UpdateSocket()){
+        handler(Errc::CONNECTION_FAILED, nullptr);
+        return;
+    }
+
+    auto wait_type = status == PGRES_POLLING_READING ? net::posix::stream_descriptor::wait_read
+                                                     : net::posix::stream_descriptor::wait_write;
+    socket_.async_wait(wait_type, net::bind_executor(strand_, [self = shared_from_this(), handler](boost::system::error_code ec){
+        if(ec){
+            handler(Errc::CONNECTION_FAILED, nullptr);
+            return;
+        }
+        self->PollConnect(handler);
+    }));
+}
+
+bool Connection::UpdateSocket(){
+    int fd = PQsocket(conn_);
+    if(fd < 0){
+        return false;
+    }
+
+    // libpq сама закрывает свой сокет, поэтому asio получает копию дескриптора.
+    // Копия делается заново после каждого шага подключения: новый сокет libpq обычно получает
+    // тот же номер, что и закрытый старый, и по номеру смену сокета не заметить
+    int dup_fd = ::dup(fd);
+    if(dup_fd < 0){
+        return false;
+    }
+    boost::system::error_code ec;
+    socket_.close(ec);
+    socket_.assign(dup_fd, ec);
+    if(ec){
+        ::close(dup_fd);
+        return false;
+    }
+    return true;
+}
+
+void Connection::EnqueueQuery(std::string sql, Params params, QueryHandler handler){
+    net::dispatch(strand_, [self = shared_from_this(), query = Query{std::move(sql), std::move(params), std::move(handler)}]() mutable {
+        self->queries_.push_back(std::move(query));
+        self->StartNextQuery();
+    });
+}
+
+void Connection::StartNextQuery(){
+    if(busy_ || queries_.empty()){
+        return;
+    }
+    if(PQstatus(conn_) == CONNECTION_BAD){
+        FailAll(Errc::CONNECTION_LOST, details::GetErrorMessage(conn_));
+        return;
+    }
+
+    const Query& query = queries_.front();
+    std::vector<const char*> values;
+    values.reserve(query.params.size());
+    for(const auto& param : query.params){
+        values.push_back(param ? param->c_str() : nullptr);
+    }
+
+    busy_ = true;
+    current_result_ = Result{};
+    if(PQsendQueryParams(conn_, query.sql.c_str(), static_cast<int>(values.size()), nullptr, values.data(), nullptr, nullptr, 0) == 0){
+        current_result_ = Result{details::GetErrorMessage(conn_)};
+        FinishQuery(Errc::QUERY_FAILED);
+        return;
+    }
+    FlushQuery();
+}
+
+void Connection::FlushQuery(){
+    int flushed = PQflush(conn_);
+    if(flushed < 0){
+        FailAll(Errc::CONNECTION_LOST, details::GetErrorMessage(conn_));
+        return;
+    }
+    if(flushed == 1){
+        // Запрос не поместился в буфер сокета. Пока он дописывается, сервер может сам ждать,
+        // пока у него заберут ответ, поэтому ждем и записи, и чтения: по libpq прочитанное
+        // нужно забрать PQconsumeInput, иначе обе стороны упрутся в полные буферы.
+        // Сработавшее ожидание отменяет второе, отмененное приходит после и игнорируется
+        auto woken = std::make_shared<bool>(false);
+        auto on_ready = [self = shared_from_this(), woken](boost::system::error_code ec, bool readable){
+            if(*woken){
+                return;
+            }
+            *woken = true;
+            boost::system::error_code ignored;
+            self->socket_.cancel(ignored);
+            if(ec){
+                self->FailAll(Errc::CONNECTION_LOST, ec.message());
+                return;
+            }
+            if(readable && PQconsumeInput(self->conn_) == 0){
+                self->FailAll(Errc::CONNECTION_LOST, details::GetErrorMessage(self->conn_));
+                return;
+            }
+            self->FlushQuery();
+        };
+        socket_.async_wait(net::posix::stream_descriptor::wait_write, net::bind_executor(strand_, [on_ready](boost::system::error_code ec){
+            on_ready(ec, false);
+        }));
+        socket_.async_wait(net::posix::stream_descriptor::wait_read, net::bind_executor(strand_, [on_ready](boost::system::error_code ec){
+            on_ready(ec, true);
+        }));
+        return;
+    }
+    ReadResults();
+}
+
+void Connection::ReadResults(){
+    if(PQconsumeInput(conn_) == 0){
+        FailAll(Errc::CONNECTION_LOST, details::GetErrorMessage(conn_));
+        return;
+    }
+
+    while(PQisBusy(conn_) == 0){
+        PGresult* result = PQgetResult(conn_);
+        if(result == nullptr){
+            FinishQuery(current_result_.IsOk() ? boost::system::error_code{} : make_error_code(Errc::QUERY_FAILED));
+            return;
+        }
+        // запоминаем первую ошибку, иначе последний результат
+        if(current_result_.GetErrorMessage().empty()){
+            current_result_ = Result{result};
+        }
+        else{
+            PQclear(result);
+        }
+    }
+
+    socket_.async_wait(net::posix::stream_descriptor::wait_read, net::bind_executor(strand_, [self = shared_from_this()](boost::system::error_code ec){
+        if(ec){
+            self->FailAll(Errc::CONNECTION_LOST, ec.message());
+            return;
+        }
+        self->ReadResults();
+    }));
+}
+
+void Connection::FinishQuery(boost::system::error_code ec){
+    auto handler = std::move(queries_.front().handler);
+    queries_.pop_front();
+    busy_ = false;
+    handler(ec, std::move(current_result_));
+    StartNextQuery();
+}
+
+void Connection::FailAll(Errc errc, const std::string& message){
+    busy_ = false;
+    auto queries = std::move(queries_);
+    queries_.clear();
+    for(auto& query : queries){
+        query.handler(errc, Result{message});
+    }
+}
+
+} // async_pg
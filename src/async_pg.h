@@ -0,0 +1,152 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <libpq-fe.h>
+
+namespace async_pg{
+
+namespace net = boost::asio;
+
+enum class Errc{
+    CONNECTION_FAILED = 1,
+    CONNECTION_LOST,
+    QUERY_FAILED
+};
+
+} // async_pg
+
+namespace boost::system{
+
+template <>
+struct is_error_code_enum<async_pg::Errc> : std::true_type{};
+
+} // boost::system
+
+namespace async_pg{
+
+const boost::system::error_category& GetErrorCategory();
+boost::system::error_code make_error_code(Errc errc);
+
+// Результат запроса. Значения в текстовом формате, как их вернул сервер.
+class Result{
+public:
+    Result() = default;
+    explicit Result(PGresult* result);
+    explicit Result(std::string error_message) : error_message_(std::move(error_message)){}
+
+    bool IsOk() const;
+    int GetRowCount() const;
+    int GetColumnCount() const;
+    bool IsNull(int row, int column) const;
+    std::string_view GetValue(int row, int column) const;
+    const std::string& GetErrorMessage() const{
+        return error_message_;
+    }
+
+private:
+    std::shared_ptr<PGresult> result_;
+    std::string error_message_;
+};
+
+// nullopt передается как NULL
+using Params = std::vector<std::optional<std::string>>;
+
+/*
+ * Соединение с Postgres поверх неблокирующего API libpq.
+ * Сокет соединения зарегистрирован в реакторе asio, поэтому ни подключение, ни запросы
+ * не блокируют потоки io_context. Запросы выполняются по одному в порядке вызова AsyncQuery,
+ * вся работа с PGconn идет через собственный strand соединения.
+ */
+class Connection : public std::enable_shared_from_this<Connection>{
+    struct PrivateTag{};
+
+public:
+    using ConnectHandler = std::function<void(boost::system::error_code ec, std::shared_ptr<Connection> connection)>;
+    using QueryHandler = std::function<void(boost::system::error_code ec, Result result)>;
+
+    Connection(PrivateTag, net::any_io_executor executor, PGconn* conn);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Сигнатура обработчика: void(boost::system::error_code, std::shared_ptr<Connection>)
+    template <typename CompletionToken>
+    static auto AsyncConnect(net::any_io_executor executor, std::string conninfo, CompletionToken&& token){
+        return net::async_initiate<CompletionToken, void(boost::system::error_code, std::shared_ptr<Connection>)>(
+            [executor](auto handler, std::string conninfo){
+                StartConnect(executor, std::move(conninfo), WrapHandler<ConnectHandler>(std::move(handler), executor));
+            },
+            token, std::move(conninfo));
+    }
+
+    // Сигнатура обработчика: void(boost::system::error_code, Result).
+    // При ошибке запроса приходит Errc::QUERY_FAILED и Result с текстом ошибки.
+    template <typename CompletionToken>
+    auto AsyncQuery(std::string sql, Params params, CompletionToken&& token){
+        return net::async_initiate<CompletionToken, void(boost::system::error_code, Result)>(
+            [self = shared_from_this()](auto handler, std::string sql, Params params){
+                self->EnqueueQuery(std::move(sql), std::move(params)
+                                 , WrapHandler<QueryHandler>(std::move(handler), self->strand_.get_inner_executor()));
+            },
+            token, std::move(sql), std::move(params));
+    }
+
+private:
+    struct Query{
+        std::string sql;
+        Params params;
+        QueryHandler handler;
+    };
+
+    // обработчик вызывается на своем ассоциированном исполнителе, а не на strand'е соединения
+    template <typename Function, typename Handler>
+    static Function WrapHandler(Handler&& handler, net::any_io_executor default_executor){
+        auto executor = net::get_associated_executor(handler, default_executor);
+        auto shared_handler = std::make_shared<std::decay_t<Handler>>(std::move(handler));
+        return [executor, shared_handler](boost::system::error_code ec, auto value){
+            net::post(executor, [ec, value = std::move(value), shared_handler]() mutable {
+                (*shared_handler)(ec, std::move(value));
+            });
+        };
+    }
+
+    static void StartConnect(net::any_io_executor executor, std::string conninfo, ConnectHandler handler);
+    void PollConnect(ConnectHandler handler);
+    // сокет может смениться во время подключения (перебор хостов, откат с SSL), поэтому
+    // asio получает новую копию дескриптора после каждого шага
+    bool UpdateSocket();
+
+    void EnqueueQuery(std::string sql, Params params, QueryHandler handler);
+    void StartNextQuery();
+    void FlushQuery();
+    void ReadResults();
+    void FinishQuery(boost::system::error_code ec);
+    void FailAll(Errc errc, const std::string& message);
+
+    net::strand<net::any_io_executor> strand_;
+    PGconn* conn_;
+    net::posix::stream_descriptor socket_;
+
+    std::deque<Query> queries_;
+    bool busy_ = false;
+    Result current_result_;
+};
+
+} // async_pg
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/crc.hpp>
+
+// Общие кирпичики файлов-журналов: числа в little-endian и записи вида [u32 длина][u32 crc32][данные]
+namespace binary_log{
+
+constexpr size_t ENTRY_HEADER_SIZE = 2 * sizeof(std::uint32_t);
+
+inline void PutU32(std::vector<char>& out, std::uint32_t value){
+    for(int i = 0; i < 4; ++i){
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+inline void PutU64(std::vector<char>& out, std::uint64_t value){
+    PutU32(out, static_cast<std::uint32_t>(value));
+    PutU32(out, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline void PutDouble(std::vector<char>& out, double value){
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    PutU64(out, bits);
+}
+
+// строка с длиной впереди
+inline void PutString(std::vector<char>& out, std::string_view str){
+    PutU32(out, static_cast<std::uint32_t>(str.size()));
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+inline std::uint32_t GetU32(const char* data){
+    std::uint32_t value = 0;
+    for(int i = 0; i < 4; ++i){
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+inline std::uint32_t Crc32(const char* data, size_t size){
+    boost::crc_32_type crc;
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+// дописывает в out запись с заголовком из длины и crc
+inline void AppendEntry(std::vector<char>& out, const std::vector<char>& payload){
+    PutU32(out, static_cast<std::uint32_t>(payload.size()));
+    PutU32(out, Crc32(payload.data(), payload.size()));
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+// Последовательное чтение полей записи. После первой ошибки все чтения возвращают nullopt.
+class Reader{
+public:
+    Reader(const char* data, size_t size) : data_(data), size_(size){}
+
+    std::optional<std::uint32_t> GetU32(){
+        if(!Has(4)){
+            return std::nullopt;
+        }
+        auto value = binary_log::GetU32(data_ + pos_);
+        pos_ += 4;
+        return value;
+    }
+
+    std::optional<std::uint64_t> GetU64(){
+        auto low = GetU32();
+        auto high = GetU32();
+        if(!low || !high){
+            return std::nullopt;
+        }
+        return static_cast<std::uint64_t>(*high) << 32 | *low;
+    }
+
+    std::optional<double> GetDouble(){
+        auto bits = GetU64();
+        if(!bits){
+            return std::nullopt;
+        }
+        double value;
+        std::memcpy(&value, &*bits, sizeof(value));
+        return value;
+    }
+
+    std::optional<std::string> GetString(){
+        auto size = GetU32();
+        if(!size || !Has(*size)){
+            failed_ = true;
+            return std::nullopt;
+        }
+        std::string str(data_ + pos_, *size);
+        pos_ += *size;
+        return str;
+    }
+
+    std::optional<std::string_view> GetBytes(size_t count){
+        if(!Has(count)){
+            return std::nullopt;
+        }
+        std::string_view bytes(data_ + pos_, count);
+        pos_ += count;
+        return bytes;
+    }
+
+    size_t GetRemaining() const{
+        return failed_ ? 0 : size_ - pos_;
+    }
+
+    bool IsFailed() const{
+        return failed_;
+    }
+
+private:
+    bool Has(size_t count){
+        if(failed_ || size_ - pos_ < count){
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool failed_ = false;
+};
+
+// Разбирает файл на записи до первой оборванной или испорченной.
+// Возвращает смещение конца последней целой записи.
+template <typename Handler>
+size_t ReadEntries(const std::vector<char>& data, size_t offset, size_t max_payload_size, Handler&& handler){
+    while(data.size() - offset >= ENTRY_HEADER_SIZE){
+        std::uint32_t size = GetU32(data.data() + offset);
+        std::uint32_t crc = GetU32(data.data() + offset + 4);
+        const char* payload = data.data() + offset + ENTRY_HEADER_SIZE;
+
+        if(size > max_payload_size || data.size() - offset - ENTRY_HEADER_SIZE < size || Crc32(payload, size) != crc){
+            break;
+        }
+        if(!handler(payload, static_cast<size_t>(size))){
+            break;
+        }
+        offset += ENTRY_HEADER_SIZE + size;
+    }
+    return offset;
+}
+
+} // binary_log
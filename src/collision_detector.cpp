@@ -24,6 +24,12 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
 
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
     std::vector<GatheringEvent> events;
+    FindGatherEvents(provider, events);
+    return events;
+}
+
+void FindGatherEvents(const ItemGathererProvider& provider, std::vector<GatheringEvent>& events) {
+    events.clear();
     for(size_t item_index = 0; item_index < provider.ItemsCount(); ++item_index){
         for(size_t gatherer_index = 0; gatherer_index < provider.GatherersCount(); ++gatherer_index){
             auto gatherer_info = provider.GetGatherer(gatherer_index);
@@ -41,8 +47,83 @@ std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provide
     std::sort(events.begin(), events.end(), [](const GatheringEvent& lhs, const GatheringEvent& rhs){      
         return lhs.time < rhs.time;
     });
-    return events;
 }
 
+SpatialHash::SpatialHash(double cell_size, size_t bucket_count)
+    : cell_size_(cell_size) {
+    size_t buckets = 1;
+    while (buckets < bucket_count) {
+        buckets *= 2;
+    }
+    heads_.assign(buckets, NONE);
+}
+
+void SpatialHash::Reserve(size_t count) {
+    nodes_.reserve(count);
+}
+
+void SpatialHash::Insert(size_t id, geom::Point2D position) {
+    assert(!Contains(id));
+    if (id >= nodes_.size()) {
+        nodes_.resize(id + 1);
+    }
+
+    Node& node = nodes_[id];
+    node.position = position;
+    node.cell_x = CellOf(position.x);
+    node.cell_y = CellOf(position.y);
+    node.bucket = BucketOf(node.cell_x, node.cell_y);
+    node.prev = NONE;
+    node.next = heads_[node.bucket];
+    if (node.next != NONE) {
+        nodes_[node.next].prev = static_cast<std::uint32_t>(id);
+    }
+    heads_[node.bucket] = static_cast<std::uint32_t>(id);
+    ++size_;
+}
+
+void SpatialHash::Erase(size_t id) {
+    if (!Contains(id)) {
+        return;
+    }
+
+    Node& node = nodes_[id];
+    if (node.prev != NONE) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.bucket] = node.next;
+    }
+    if (node.next != NONE) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node = Node{};
+    --size_;
+}
+
+void SpatialHash::Clear() {
+    std::fill(heads_.begin(), heads_.end(), NONE);
+    nodes_.clear();
+    size_ = 0;
+}
+
+void FindGatherEvents(const SpatialHash& items, std::span<const Gatherer> gatherers, std::vector<GatheringEvent>& events) {
+    events.clear();
+    for (size_t gatherer_index = 0; gatherer_index < gatherers.size(); ++gatherer_index) {
+        const Gatherer& gatherer = gatherers[gatherer_index];
+        if (gatherer.start_pos == gatherer.end_pos) {
+            continue;
+        }
+        items.ForEachNear(gatherer.start_pos, gatherer.end_pos, gatherer.width, [&](size_t item_index, geom::Point2D position) {
+            CollectionResult try_collect_point_res = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, position);
+            if (try_collect_point_res.IsCollected(gatherer.width)) {
+                events.push_back(GatheringEvent{item_index, gatherer_index, try_collect_point_res.sq_distance, try_collect_point_res.proj_ratio});
+            }
+        });
+    }
+
+    std::sort(events.begin(), events.end(), [](const GatheringEvent& lhs, const GatheringEvent& rhs) {
+        return lhs.time < rhs.time;
+    });
+}
 
 }  // namespace collision_detector
\ No newline at end of file
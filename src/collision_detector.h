@@ -3,6 +3,10 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
 #include <vector>
 
 namespace collision_detector {
@@ -54,4 +58,97 @@ struct GatheringEvent {
 
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+// То же в переданный буфер: он очищается, но его память переиспользуется
+void FindGatherEvents(const ItemGathererProvider& provider, std::vector<GatheringEvent>& events);
+
+/*
+ * Пространственный хеш точечных предметов. Плоскость разбита на квадратные ячейки,
+ * ячейки хешируются в фиксированное число корзин, предметы корзины связаны списком через свои номера.
+ * Вставка и удаление O(1) и без выделения памяти, пока номера меньше заказанных в Reserve.
+ * Номер предмета выбирает владелец (например, позиция трофея в хранилище).
+ */
+class SpatialHash {
+public:
+    static constexpr double DEFAULT_CELL_SIZE = 1.0;
+    static constexpr size_t DEFAULT_BUCKET_COUNT = 256;
+
+    // bucket_count округляется вверх до степени двойки
+    explicit SpatialHash(double cell_size = DEFAULT_CELL_SIZE, size_t bucket_count = DEFAULT_BUCKET_COUNT);
+
+    void Reserve(size_t count);
+    // номер id не должен быть занят
+    void Insert(size_t id, geom::Point2D position);
+    void Erase(size_t id);
+    void Clear();
+
+    bool Contains(size_t id) const {
+        return id < nodes_.size() && nodes_[id].bucket != NONE;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // Вызывает fn(id, position) для предметов из ячеек, которые задевает отрезок a-b, расширенный на radius.
+    // Каждый предмет - не больше одного раза. Если ячеек больше, чем корзин, проще перебрать все предметы
+    template <typename Fn>
+    void ForEachNear(geom::Point2D a, geom::Point2D b, double radius, Fn&& fn) const {
+        const std::int64_t min_x = CellOf(std::min(a.x, b.x) - radius);
+        const std::int64_t max_x = CellOf(std::max(a.x, b.x) + radius);
+        const std::int64_t min_y = CellOf(std::min(a.y, b.y) - radius);
+        const std::int64_t max_y = CellOf(std::max(a.y, b.y) + radius);
+
+        if (static_cast<double>(max_x - min_x + 1) * static_cast<double>(max_y - min_y + 1) > heads_.size()) {
+            for (size_t id = 0; id < nodes_.size(); ++id) {
+                if (nodes_[id].bucket != NONE) {
+                    fn(id, nodes_[id].position);
+                }
+            }
+            return;
+        }
+
+        for (std::int64_t cell_x = min_x; cell_x <= max_x; ++cell_x) {
+            for (std::int64_t cell_y = min_y; cell_y <= max_y; ++cell_y) {
+                for (std::uint32_t id = heads_[BucketOf(cell_x, cell_y)]; id != NONE; id = nodes_[id].next) {
+                    // в корзине бывают предметы других ячеек, каждый отдается только из своей
+                    if (nodes_[id].cell_x == cell_x && nodes_[id].cell_y == cell_y) {
+                        fn(static_cast<size_t>(id), nodes_[id].position);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node {
+        geom::Point2D position;
+        std::int64_t cell_x = 0;
+        std::int64_t cell_y = 0;
+        std::uint32_t bucket = NONE;
+        std::uint32_t prev = NONE;
+        std::uint32_t next = NONE;
+    };
+
+    std::int64_t CellOf(double coord) const {
+        return static_cast<std::int64_t>(std::floor(coord / cell_size_));
+    }
+
+    std::uint32_t BucketOf(std::int64_t cell_x, std::int64_t cell_y) const {
+        std::uint64_t hash = static_cast<std::uint64_t>(cell_x) * 0x9E3779B97F4A7C15ull
+                           ^ static_cast<std::uint64_t>(cell_y) * 0xC2B2AE3D27D4EB4Full;
+        return static_cast<std::uint32_t>((hash ^ (hash >> 32)) & (heads_.size() - 1));
+    }
+
+    double cell_size_;
+    std::vector<std::uint32_t> heads_;
+    std::vector<Node> nodes_;
+    size_t size_ = 0;
+};
+
+// События сбора по пространственному хешу: для каждого собирателя проверяются
+// только предметы из ячеек вдоль его пути. Радиус сбора, как и выше, - ширина собирателя
+void FindGatherEvents(const SpatialHash& items, std::span<const Gatherer> gatherers, std::vector<GatheringEvent>& events);
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "connection_pool.h"
+#include "log_utils.h"
+
+#include <future>
+
+#include <boost/system/system_error.hpp>
+#include <pqxx/pqxx>
+
+ConnectionPool::ConnectionPool(net::io_context& ioc, PoolConfig config, ConnectionFactory connection_factory)
+    : ioc_(ioc)
+    , config_(config)
+    , connection_factory_(std::move(connection_factory))
+    , reconnect_timer_(ioc)
+    , health_check_timer_(ioc){
+    assert(config_.max_size > 0);
+    std::lock_guard lock{mutex_};
+    ScheduleHealthCheckLocked();
+}
+
+ConnectionPool::~ConnectionPool(){
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+        reconnect_timer_.cancel();
+        health_check_timer_.cancel();
+    }
+    // дожидаемся подключений и проверок, которые еще обращаются к пулу
+    blocking_pool_.join();
+}
+
+ConnectionPool::ConnectionWrapper ConnectionPool::GetConnection(){
+    std::promise<ConnectionPtr> promise;
+    auto future = promise.get_future();
+
+    auto waiter = Acquire([&promise](boost::system::error_code ec, ConnectionPtr conn){
+        if(ec){
+            promise.set_exception(std::make_exception_ptr(boost::system::system_error{ec, "ConnectionPool::GetConnection"}));
+        }
+        else{
+            promise.set_value(std::move(conn));
+        }
+    });
+
+    // таймер ожидающего работает на io_context, который может быть еще не запущен
+    if(future.wait_for(config_.acquire_timeout) == std::future_status::timeout){
+        OnWaiterTimeout(waiter);
+    }
+    return ConnectionWrapper{future.get(), *this};
+}
+
+PoolStats ConnectionPool::GetStats() const{
+    std::lock_guard lock{mutex_};
+    PoolStats stats = stats_;
+    stats.open = open_;
+    stats.idle = idle_.size();
+    stats.waiting = waiters_.size();
+    return stats;
+}
+
+ConnectionPool::WaiterPtr ConnectionPool::Acquire(AcquireCallback callback){
+    auto waiter = std::make_shared<Waiter>();
+    waiter->callback = std::move(callback);
+    waiter->start = Clock::now();
+
+    ConnectionPtr conn;
+    {
+        std::lock_guard lock{mutex_};
+        if(!idle_.empty()){
+            conn = std::move(idle_.front());
+            idle_.pop_front();
+            FinishLocked(*waiter, true);
+        }
+        else{
+            waiter->timer = std::make_unique<net::steady_timer>(ioc_, config_.acquire_timeout);
+            waiter->timer->async_wait([this, waiter](boost::system::error_code ec){
+                if(!ec){
+                    OnWaiterTimeout(waiter);
+                }
+            });
+            waiters_.push_back(waiter);
+            MaybeConnectLocked();
+        }
+    }
+
+    if(conn){
+        waiter->callback({}, std::move(conn));
+    }
+    return waiter;
+}
+
+void ConnectionPool::ReturnConnection(ConnectionPtr&& conn){
+    if(!conn->is_open()){
+        DropConnection(std::move(conn));
+        return;
+    }
+    HandOut(std::move(conn));
+}
+
+void ConnectionPool::HandOut(ConnectionPtr&& conn){
+    WaiterPtr waiter;
+    {
+        std::lock_guard lock{mutex_};
+        if(waiters_.empty()){
+            idle_.push_back(std::move(conn));
+            return;
+        }
+        waiter = std::move(waiters_.front());
+        waiters_.pop_front();
+        FinishLocked(*waiter, true);
+    }
+    waiter->callback({}, std::move(conn));
+}
+
+void ConnectionPool::DropConnection(ConnectionPtr&& conn){
+    // закрываем вне блокировки: это обращение к сети
+    conn.reset();
+
+    std::lock_guard lock{mutex_};
+    --open_;
+    ++stats_.dropped_connections;
+    MaybeConnectLocked();
+}
+
+void ConnectionPool::FinishLocked(Waiter& waiter, bool acquired){
+    waiter.done = true;
+    if(waiter.timer){
+        waiter.timer->cancel();
+    }
+    if(acquired){
+        auto wait = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - waiter.start);
+        ++stats_.acquired;
+        stats_.total_wait += wait;
+        stats_.max_wait = std::max(stats_.max_wait, wait);
+    }
+}
+
+void ConnectionPool::OnWaiterTimeout(const WaiterPtr& waiter){
+    {
+        std::lock_guard lock{mutex_};
+        if(waiter->done){
+            return;
+        }
+        waiters_.remove(waiter);
+        FinishLocked(*waiter, false);
+        ++stats_.timeouts;
+    }
+    waiter->callback(net::error::timed_out, nullptr);
+}
+
+void ConnectionPool::MaybeConnectLocked(){
+    // новое соединение открывается только если его кто-то ждет
+    if(stopping_ || reconnect_scheduled_ || open_ >= config_.max_size || connecting_ >= waiters_.size()){
+        return;
+    }
+
+    ++open_;
+    ++connecting_;
+    net::post(blocking_pool_, [this]{
+        ConnectionPtr conn;
+        try{
+            conn = connection_factory_();
+        }catch(const std::exception& ex){
+            BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                     << logging::add_value(additional_data, log_data::MakeErrorData(0, ex.what(), "db connect"))
+                                     << "error";
+        }
+
+        if(conn){
+            OnConnected(std::move(conn));
+        }
+        else{
+            OnConnectFailed();
+        }
+    });
+}
+
+void ConnectionPool::OnConnected(ConnectionPtr&& conn){
+    {
+        std::lock_guard lock{mutex_};
+        --connecting_;
+        backoff_ = std::chrono::milliseconds{0};
+    }
+    HandOut(std::move(conn));
+}
+
+void ConnectionPool::OnConnectFailed(){
+    std::lock_guard lock{mutex_};
+    --connecting_;
+    --open_;
+    ++stats_.connect_failures;
+
+    backoff_ = backoff_.count() == 0 ? config_.reconnect_backoff_min
+                                     : std::min(backoff_ * 2, config_.reconnect_backoff_max);
+    if(stopping_){
+        return;
+    }
+
+    reconnect_scheduled_ = true;
+    reconnect_timer_.expires_after(backoff_);
+    reconnect_timer_.async_wait([this](boost::system::error_code ec){
+        if(ec){
+            return;
+        }
+        std::lock_guard lock{mutex_};
+        reconnect_scheduled_ = false;
+        MaybeConnectLocked();
+    });
+}
+
+void ConnectionPool::ScheduleHealthCheckLocked(){
+    if(stopping_ || config_.health_check_period.count() == 0){
+        return;
+    }
+    health_check_timer_.expires_after(config_.health_check_period);
+    health_check_timer_.async_wait([this](boost::system::error_code ec){
+        if(!ec){
+            RunHealthCheck();
+        }
+    });
+}
+
+void ConnectionPool::RunHealthCheck(){
+    std::deque<ConnectionPtr> to_check;
+    {
+        std::lock_guard lock{mutex_};
+        to_check.swap(idle_);
+    }
+
+    net::post(blocking_pool_, [this, to_check = std::move(to_check)]() mutable {
+        for(auto& conn : to_check){
+            bool alive = false;
+            try{
+                pqxx::nontransaction work{*conn};
+                work.exec("SELECT 1;");
+                alive = true;
+            }catch(const std::exception&){
+            }
+
+            if(alive){
+                HandOut(std::move(conn));
+            }
+            else{
+                DropConnection(std::move(conn));
+            }
+        }
+
+        std::lock_guard lock{mutex_};
+        ScheduleHealthCheckLocked();
+    });
+}
+
+boost::json::value MakePoolStatsData(const PoolStats& stats){
+    std::int64_t mean_wait = stats.acquired == 0 ? 0 : stats.total_wait.count() / static_cast<std::int64_t>(stats.acquired);
+
+    boost::json::object answer;
+    answer.insert(boost::json::object::value_type{"acquired", stats.acquired});
+    answer.insert(boost::json::object::value_type{"timeouts", stats.timeouts});
+    answer.insert(boost::json::object::value_type{"connect_failures", stats.connect_failures});
+    answer.insert(boost::json::object::value_type{"dropped_connections", stats.dropped_connections});
+    answer.insert(boost::json::object::value_type{"open", stats.open});
+    answer.insert(boost::json::object::value_type{"idle", stats.idle});
+    answer.insert(boost::json::object::value_type{"waiting", stats.waiting});
+    answer.insert(boost::json::object::value_type{"mean_wait_us", mean_wait});
+    answer.insert(boost::json::object::value_type{"max_wait_us", stats.max_wait.count()});
+    return answer;
+}
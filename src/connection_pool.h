@@ -1,17 +1,69 @@
-#include <mutex>
-#include <condition_variable>
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
 #include <memory>
-#include <vector>
+#include <mutex>
+#include <deque>
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/json.hpp>
+#include <boost/system/error_code.hpp>
 
 #include <pqxx/connection>
 
+namespace net = boost::asio;
+using namespace std::chrono_literals;
+
+struct PoolConfig{
+    // соединения открываются лениво, но не больше max_size
+    size_t max_size = 4;
+    std::chrono::milliseconds acquire_timeout = 5s;
+    // как часто проверять простаивающие соединения запросом SELECT 1
+    std::chrono::milliseconds health_check_period = 30s;
+    std::chrono::milliseconds reconnect_backoff_min = 100ms;
+    std::chrono::milliseconds reconnect_backoff_max = 10s;
+};
+
+struct PoolStats{
+    std::uint64_t acquired = 0;
+    std::uint64_t timeouts = 0;
+    std::uint64_t connect_failures = 0;
+    std::uint64_t dropped_connections = 0;
+    size_t open = 0;
+    size_t idle = 0;
+    size_t waiting = 0;
+    std::chrono::microseconds total_wait{0};
+    std::chrono::microseconds max_wait{0};
+};
+
+boost::json::value MakePoolStatsData(const PoolStats& stats);
+
+/*
+ * Пул соединений с Postgres.
+ * Ни одна операция пула не блокирует поток io_context: установка соединения и
+ * проверка его работоспособности выполняются на отдельном пуле потоков, а ожидание
+ * свободного соединения - это асинхронная операция с тайм-аутом.
+ */
 class ConnectionPool {
     using PoolType = ConnectionPool;
     using ConnectionPtr = std::shared_ptr<pqxx::connection>;
 
 public:
+    using ConnectionFactory = std::function<ConnectionPtr()>;
+
     class ConnectionWrapper {
     public:
+        ConnectionWrapper() = default;
+
         ConnectionWrapper(std::shared_ptr<pqxx::connection>&& conn, PoolType& pool) noexcept
             : conn_{std::move(conn)}
             , pool_{&pool} {
@@ -20,8 +72,19 @@ public:
         ConnectionWrapper(const ConnectionWrapper&) = delete;
         ConnectionWrapper& operator=(const ConnectionWrapper&) = delete;
 
-        ConnectionWrapper(ConnectionWrapper&&) = default;
-        ConnectionWrapper& operator=(ConnectionWrapper&&) = default;
+        ConnectionWrapper(ConnectionWrapper&& other) noexcept
+            : conn_{std::move(other.conn_)}
+            , pool_{other.pool_} {
+        }
+
+        ConnectionWrapper& operator=(ConnectionWrapper&& other) noexcept {
+            if (this != &other) {
+                Release();
+                conn_ = std::move(other.conn_);
+                pool_ = other.pool_;
+            }
+            return *this;
+        }
 
         pqxx::connection& operator*() const& noexcept {
             return *conn_;
@@ -32,46 +95,101 @@ public:
             return conn_.get();
         }
 
+        explicit operator bool() const noexcept {
+            return conn_ != nullptr;
+        }
+
         ~ConnectionWrapper() {
+            Release();
+        }
+
+    private:
+        void Release() {
             if (conn_) {
                 pool_->ReturnConnection(std::move(conn_));
             }
         }
 
-    private:
         std::shared_ptr<pqxx::connection> conn_;
-        PoolType* pool_;
+        PoolType* pool_ = nullptr;
     };
 
-    template <typename ConnectionFactory>
-    explicit ConnectionPool(size_t capacity, ConnectionFactory&& connection_factory) {
-        pool_.reserve(capacity);
-        for (size_t i = 0; i < capacity; ++i) {
-            pool_.emplace_back(connection_factory());
-        }
-    }
+    ConnectionPool(net::io_context& ioc, PoolConfig config, ConnectionFactory connection_factory);
+    ~ConnectionPool();
 
-    ConnectionWrapper GetConnection() {
-        std::unique_lock lock{mutex_};
-        cond_var_.wait(lock, [this] {
-            return used_connections_ < pool_.size();
-        });
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
 
-        return {std::move(pool_[used_connections_++]), *this};
+    // Сигнатура обработчика: void(boost::system::error_code, ConnectionWrapper).
+    // При тайм-ауте приходит net::error::timed_out и пустой ConnectionWrapper.
+    template <typename CompletionToken>
+    auto AsyncGetConnection(CompletionToken&& token) {
+        return net::async_initiate<CompletionToken, void(boost::system::error_code, ConnectionWrapper)>(
+            [this](auto handler) {
+                auto executor = net::get_associated_executor(handler, ioc_.get_executor());
+                auto shared_handler = std::make_shared<decltype(handler)>(std::move(handler));
+                Acquire([this, executor, shared_handler](boost::system::error_code ec, ConnectionPtr conn) {
+                    // обертка создается сразу, чтобы соединение вернулось в пул,
+                    // даже если обработчик так и не будет вызван
+                    net::post(executor, [ec, wrapper = ConnectionWrapper{std::move(conn), *this}, shared_handler]() mutable {
+                        (*shared_handler)(ec, std::move(wrapper));
+                    });
+                });
+            },
+            token);
     }
 
+    // Блокирующее получение соединения. Нельзя вызывать из потоков io_context,
+    // предназначено для фоновых потоков. Бросает исключение при тайм-ауте.
+    ConnectionWrapper GetConnection();
+
+    PoolStats GetStats() const;
+
 private:
-    void ReturnConnection(ConnectionPtr&& conn) {
-        {
-            std::lock_guard lock{mutex_};
-            assert(used_connections_ != 0);
-            pool_[--used_connections_] = std::move(conn);
-        }
-        cond_var_.notify_one();
-    }
+    using AcquireCallback = std::function<void(boost::system::error_code ec, ConnectionPtr conn)>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Waiter {
+        AcquireCallback callback;
+        Clock::time_point start;
+        std::unique_ptr<net::steady_timer> timer;
+        bool done = false;
+    };
+    using WaiterPtr = std::shared_ptr<Waiter>;
+
+    // callback вызывается ровно один раз: с соединением или с ошибкой
+    WaiterPtr Acquire(AcquireCallback callback);
+    void ReturnConnection(ConnectionPtr&& conn);
+
+    // передает соединение первому ожидающему или кладет в список свободных
+    void HandOut(ConnectionPtr&& conn);
+    void DropConnection(ConnectionPtr&& conn);
+    void OnWaiterTimeout(const WaiterPtr& waiter);
+    void OnConnected(ConnectionPtr&& conn);
+    void OnConnectFailed();
+    void RunHealthCheck();
+
+    // методы *Locked вызываются под mutex_
+    void FinishLocked(Waiter& waiter, bool acquired);
+    void MaybeConnectLocked();
+    void ScheduleHealthCheckLocked();
+
+    net::io_context& ioc_;
+    PoolConfig config_;
+    ConnectionFactory connection_factory_;
+
+    mutable std::mutex mutex_;
+    std::deque<ConnectionPtr> idle_;
+    std::list<WaiterPtr> waiters_;
+    size_t open_ = 0;        // включая выданные и устанавливаемые соединения
+    size_t connecting_ = 0;
+    std::chrono::milliseconds backoff_{0};
+    bool reconnect_scheduled_ = false;
+    bool stopping_ = false;
+    PoolStats stats_;
 
-    std::mutex mutex_;
-    std::condition_variable cond_var_;
-    std::vector<ConnectionPtr> pool_;
-    size_t used_connections_ = 0;
-};
\ No newline at end of file
+    net::steady_timer reconnect_timer_;
+    net::steady_timer health_check_timer_;
+    // здесь выполняются блокирующие операции libpq
+    net::thread_pool blocking_pool_{2};
+};
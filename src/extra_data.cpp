@@ -2,15 +2,12 @@
 
 namespace extra_data{
 
-std::vector<LostObject> PossibleLootOnMapsToGenerate::GenerateLootOnMap(const model::Map* map, int loot_count, int looter_count, int time) {
-    int count_new_lost_objects = loot_generator_.Generate(time * 1ms, loot_count, looter_count);
+void PossibleLootOnMapsToGenerate::GenerateLootOnMap(const model::Map* map, MapLoot& lost_objects, int looter_count, int time, random_gen::Pcg32& random) {
+    int count_new_lost_objects = loot_generator_.Generate(time * 1ms, lost_objects.GetObjects().size(), looter_count);
 
-    std::vector<LostObject> new_lost_objects;
     for(int i = 0; i < count_new_lost_objects; ++i){
-        new_lost_objects.push_back(LostObject{next_id_++, GenerateRandomType(*map->GetId()), model::generate_coords::GenerateRandomPointOnMap(*map)});
+        lost_objects.Add(LostObject{next_id_++, GenerateRandomType(*map->GetId(), random), model::generate_coords::GenerateRandomPointOnMap(*map, random)});
     }
-
-    return new_lost_objects;
 }
 
 std::vector<std::string> PossibleLootOnMapsToGenerate::GetMapsId() const{
@@ -21,9 +18,8 @@ std::vector<std::string> PossibleLootOnMapsToGenerate::GetMapsId() const{
     return ids;
 }
 
-unsigned PossibleLootOnMapsToGenerate::GenerateRandomType(const std::string& map_id) const{
-    srand(time(NULL));
-    return rand() % possible_loot_on_map_.at(map_id).size();
+unsigned PossibleLootOnMapsToGenerate::GenerateRandomType(const std::string& map_id, random_gen::Pcg32& random) const{
+    return random.UniformInt(static_cast<std::uint32_t>(possible_loot_on_map_.at(map_id).size()));
 }
 
 LostObjectsOnMaps& LostObjectsOnMaps::operator=(const LostObjectsOnMaps& other){
@@ -32,25 +28,26 @@ LostObjectsOnMaps& LostObjectsOnMaps::operator=(const LostObjectsOnMaps& other){
     return *this;
 }       
 
-void LostObjectsOnMaps::GenerateLostObjectsOnMaps(int delta, const model::Game& game){
-    for(auto [map_id, lost_objects] : lost_objects_on_map_){
-        auto game_session = game.FindGameSessionFromMapId(model::Map::Id{map_id});
-        int looter_count = 0;
-        if(game_session != nullptr){
-            looter_count = game_session->GetDogsCount();
+void LostObjectsOnMaps::GenerateLostObjectsOnMaps(int delta, model::Game& game){
+    // обход по картам игры, а не по lost_objects_on_map_: так Map::Id не собирается из строки на каждом тике
+    for(const model::Map& map : game.GetMaps()){
+        auto lost_objects = lost_objects_on_map_.find(*map.GetId());
+        if(lost_objects == lost_objects_on_map_.end()){
+            continue;
         }
 
-        std::vector<LostObject> new_lost_objects = possible_loot_.GenerateLootOnMap(
-                                    game.FindMap(model::Map::Id{map_id}), lost_objects.size(), looter_count, delta);
-
-        for(LostObject lost_obj : new_lost_objects){
-            if(lost_objects_on_map_[map_id].size() == lost_objects_on_map_[map_id].capacity()){
-                lost_objects_on_map_.at(map_id).push_back(lost_obj);
-            }
-            else
-                lost_objects_on_map_.at(map_id).push_back(lost_obj);
-
+        auto game_session = game.FindGameSessionFromMapId(map.GetId());
+        if(game_session == nullptr){
+            // без мародеров трофеи не появляются, но время без трофеев все равно идет
+            random_gen::Pcg32 unused;
+            possible_loot_.GenerateLootOnMap(&map, lost_objects->second, 0, delta, unused);
+            continue;
         }
+        int looter_count = game_session->GetDogsCount();
+        // трофеев на карте не больше, чем мародеров: память под них берется при входе игроков, а не в тике
+        lost_objects->second.Reserve(looter_count);
+
+        possible_loot_.GenerateLootOnMap(&map, lost_objects->second, looter_count, delta, game_session->GetRandom());
     }
 }
 
@@ -8,6 +8,7 @@
 #include <deque>
 
 #include "model.h"
+#include "slot_map.h"
 #include "loot_generator.h"
 
 namespace extra_data{
@@ -30,6 +31,60 @@ struct LostObject{
     model::Coordinates coords;
 };
 
+// Трофеи одной карты. Лежат подряд; удаление переносит последний трофей на место
+// удаленного, поэтому позиции меняются, а id трофея - нет
+struct LootTag{};
+using Loot = util::SlotMap<LostObject, LootTag>;
+
+// Трофеи карты вместе с пространственным хешем их позиций. Хеш правится при появлении
+// и подборе трофеев, номер в нем - позиция трофея в GetObjects()
+class MapLoot{
+public:
+    const Loot& GetObjects() const{
+        return objects_;
+    }
+
+    const collision_detector::SpatialHash& GetIndex() const{
+        return index_;
+    }
+
+    void Add(LostObject lost_object){
+        index_.Insert(objects_.size(), geom::Point2D(lost_object.coords.x, lost_object.coords.y));
+        objects_.Insert(std::move(lost_object));
+    }
+
+    // Удаляет трофеи по позициям, позиции идут по возрастанию. Удаление с конца:
+    // перенесенный на место удаленного трофей уже не из удаляемых. O(k)
+    template <typename Iter>
+    void EraseAt(Iter begin, Iter end){
+        for(Iter iter = end; iter != begin;){
+            --iter;
+            EraseAt(*iter);
+        }
+    }
+
+    void EraseAt(size_t position){
+        size_t last = objects_.size() - 1;
+        index_.Erase(position);
+        if(position != last){
+            // SlotMap переносит последний трофей на место удаленного, хеш следует за ним
+            const LostObject& moved = objects_[last];
+            index_.Erase(last);
+            index_.Insert(position, geom::Point2D(moved.coords.x, moved.coords.y));
+        }
+        objects_.Erase(objects_.GetHandle(position));
+    }
+
+    void Reserve(size_t count){
+        objects_.reserve(count);
+        index_.Reserve(count);
+    }
+
+private:
+    Loot objects_;
+    collision_detector::SpatialHash index_;
+};
+
 // хранение информации о возможном луте на карте
 class PossibleLootOnMapsToGenerate{
 public:
@@ -45,7 +100,9 @@ public:
         return possible_loot_on_map_.at(std::string(id));
     }
 
-    std::vector<LostObject> GenerateLootOnMap(const model::Map* map, int loot_count, int looter_count, int time);
+    // новые трофеи дописываются в конец lost_objects
+    // случайные тип и место берутся из генератора сессии карты
+    void GenerateLootOnMap(const model::Map* map, MapLoot& lost_objects, int looter_count, int time, random_gen::Pcg32& random);
 
     std::vector<std::string> GetMapsId() const;
 
@@ -53,9 +110,26 @@ public:
         return possible_loot_on_map_.at(map_id).at(obj_type).value;
     }
 
+    // состояние генерации, без него после восстановления id трофеев начались бы заново
+    unsigned GetNextId() const{
+        return next_id_;
+    }
+
+    void SetNextId(unsigned next_id){
+        next_id_ = next_id;
+    }
+
+    loot_gen::LootGenerator::TimeInterval GetTimeWithoutLoot() const{
+        return loot_generator_.GetTimeWithoutLoot();
+    }
+
+    void SetTimeWithoutLoot(loot_gen::LootGenerator::TimeInterval time_without_loot){
+        loot_generator_.SetTimeWithoutLoot(time_without_loot);
+    }
+
 private:
 
-    unsigned GenerateRandomType(const std::string& map_id) const;
+    unsigned GenerateRandomType(const std::string& map_id, random_gen::Pcg32& random) const;
 
     std::unordered_map<std::string, std::vector<LootObject>> possible_loot_on_map_;
     loot_gen::LootGenerator loot_generator_;
@@ -76,38 +150,59 @@ public:
         }
     }
 
-    void GenerateLostObjectsOnMaps(int delta, const model::Game& game);
+    void GenerateLostObjectsOnMaps(int delta, model::Game& game);
 
     std::vector<LootObject> GetPossibleLootObjectsOnMap(const std::string& id) const{
         return possible_loot_.GetPossibleLootObjectsOnMap(id);
     }
 
-    const std::vector<LostObject>& GetLostObjects(const std::string& id) const{
-        return lost_objects_on_map_.at(id);
+    const Loot& GetLostObjects(const std::string& id) const{
+        return lost_objects_on_map_.at(id).GetObjects();
+    }
+
+    const collision_detector::SpatialHash& GetLostObjectsIndex(const std::string& id) const{
+        return lost_objects_on_map_.at(id).GetIndex();
     }
 
+    // Удаляет трофеи по позициям в GetLostObjects, позиции идут по возрастанию
     template <typename Iter>
     void EraseLostObjectsOnMap(const std::string& map_id, Iter begin, Iter end){
-        int count_erased_objects = 0;
-        for(Iter iter = begin; iter != end; ++iter){
-            lost_objects_on_map_.at(map_id).erase(next(lost_objects_on_map_.at(map_id).begin(), *iter - count_erased_objects++));
-        }
+        lost_objects_on_map_.at(map_id).EraseAt(begin, end);
     }
 
     int GetObjectValue(const std::string& map_id, int obj_type) const{
         return possible_loot_.GetObjectValue(map_id, obj_type);
     }
 
-    const std::unordered_map<std::string, std::vector<LostObject>>& GetLostObjectsOnMaps() const{
+    const std::unordered_map<std::string, MapLoot>& GetLostObjectsOnMaps() const{
         return lost_objects_on_map_;
     }
 
     void SetLostObjectsOnMaps(std::unordered_map<std::string, std::vector<LostObject>>&& lost_objects){
-        lost_objects_on_map_ = std::move(lost_objects);
+        lost_objects_on_map_.clear();
+        for(auto& [map_id, objects] : lost_objects){
+            SetLostObjects(map_id, std::move(objects));
+        }
+    }
+
+    void SetLostObjects(const std::string& map_id, std::vector<LostObject>&& lost_objects){
+        MapLoot& loot = lost_objects_on_map_[map_id] = MapLoot{};
+        loot.Reserve(lost_objects.size());
+        for(LostObject& lost_object : lost_objects){
+            loot.Add(std::move(lost_object));
+        }
+    }
+
+    const PossibleLootOnMapsToGenerate& GetPossibleLoot() const{
+        return possible_loot_;
+    }
+
+    PossibleLootOnMapsToGenerate& GetPossibleLoot(){
+        return possible_loot_;
     }
 
 private:
-    std::unordered_map<std::string, std::vector<LostObject>> lost_objects_on_map_;
+    std::unordered_map<std::string, MapLoot> lost_objects_on_map_;
     PossibleLootOnMapsToGenerate& possible_loot_;
 };
 
@@ -0,0 +1,128 @@
+#include "game_tick.h"
+
+#include <cassert>
+
+namespace game_tick{
+
+namespace {
+
+model::DirectionGeo ConvertCharToDir(char dir){
+    switch (dir)
+    {
+    case 'U':
+        return model::DirectionGeo::NORTH;
+    case 'D':
+        return model::DirectionGeo::SOUTH;
+    case 'L':
+        return model::DirectionGeo::WEST;
+    case 'R':
+        return model::DirectionGeo::EAST;
+    default:
+        return model::DirectionGeo::NONE;
+    }
+}
+
+model::Speed MoveDirectionToSpeed(char move_dir, double dog_speed){
+    if(move_dir == '\0'){
+        return model::Speed{0, 0};
+    }
+
+    model::Speed dog_dir_speed_;
+    switch (move_dir){
+    case 'U':
+        dog_dir_speed_.vertical = -dog_speed;
+        break;
+    case 'D':
+        dog_dir_speed_.vertical = dog_speed;
+        break;
+    case 'L':
+        dog_dir_speed_.horizontal = -dog_speed;
+        break;
+    case 'R': 
+        dog_dir_speed_.horizontal = dog_speed;
+        break;
+    default:
+        assert(false);
+    }
+
+    return dog_dir_speed_;
+}
+
+// выполняет fn и прибавляет его время к duration, без timings просто выполняет
+template <typename Fn>
+decltype(auto) Measure(TickTimings* timings, std::chrono::nanoseconds TickTimings::*duration, Fn&& fn){
+    if(timings == nullptr){
+        return fn();
+    }
+    struct Guard{
+        ~Guard(){
+            timings->*duration += std::chrono::steady_clock::now() - start;
+        }
+        TickTimings* timings;
+        std::chrono::nanoseconds TickTimings::*duration;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    } guard{timings, duration};
+    return fn();
+}
+
+} // namespace
+
+std::vector<domain::Record> Simulate(model::Game& game
+                                   , players::Players& players
+                                   , extra_data::LostObjectsOnMaps& lost_objects
+                                   , objects_collector::CollectorBuffers& buffers
+                                   , int delta
+                                   , int retired_time
+                                   , TickTimings* timings){
+    const model::SessionsMovesInfo& moves_info = Measure(timings, &TickTimings::actions, [&]() -> const model::SessionsMovesInfo& {
+        return game.MakeActionsAtTime(delta);
+    });
+    Measure(timings, &TickTimings::loot_generation, [&]{
+        lost_objects.GenerateLostObjectsOnMaps(delta, game);
+    });
+    Measure(timings, &TickTimings::collection, [&]{
+        objects_collector::CollectObjects(game, lost_objects, moves_info, buffers);
+    });
+    return Measure(timings, &TickTimings::retirement, [&]{
+        auto retired_dogs = players.EraseRetiredPlayers(game, delta, retired_time);
+        return game.EraseRetiredDogs(retired_dogs);
+    });
+}
+
+void ApplyMove(model::Game& game, const players::Player& player, char direction){
+    model::GameSession* game_session = game.FindGameSession(player.GetGameSession());
+    model::Dog* dog = game_session != nullptr ? game_session->FindDog(player.GetDog()) : nullptr;
+    if(dog == nullptr){
+        return;
+    }
+    dog->SetSpeed(MoveDirectionToSpeed(direction, game_session->GetMapDogSpeed()));
+    dog->SetDir(ConvertCharToDir(direction));
+}
+
+std::vector<domain::Record> ApplyEvent(model::Game& game
+                                     , players::Players& players
+                                     , extra_data::LostObjectsOnMaps& lost_objects
+                                     , objects_collector::CollectorBuffers& buffers
+                                     , int retired_time
+                                     , const journal::Event& event
+                                     , TickTimings* timings){
+    if(const auto* join = std::get_if<journal::JoinEvent>(&event)){
+        model::GameSession* game_session = game.FindGameSessionFromMapId(model::Map::Id(join->map_id));
+        if(game_session == nullptr){
+            game_session = game.AddGameSession(join->map_id);
+        }
+        players.RestorePlayer(join->dog_name, game_session, join->token, join->player_id, join->pos);
+    }
+    else if(const auto* move = std::get_if<journal::MoveEvent>(&event)){
+        if(const players::Player* player = players.FindByToken(move->token); player != nullptr){
+            ApplyMove(game, *player, move->direction);
+        }
+    }
+    else if(const auto* tick = std::get_if<journal::TickEvent>(&event)){
+        game.UseTickSeed(tick->seed);
+        return Simulate(game, players, lost_objects, buffers, tick->delta, retired_time, timings);
+    }
+    return {};
+}
+
+} // game_tick
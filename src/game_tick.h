@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "model.h"
+#include "player.h"
+#include "extra_data.h"
+#include "objects_collector.h"
+#include "records.h"
+#include "journal.h"
+
+namespace game_tick{
+
+// Суммарное время этапов тиков, заполняется, если передано в Simulate
+struct TickTimings{
+    std::chrono::nanoseconds actions{0};
+    std::chrono::nanoseconds loot_generation{0};
+    std::chrono::nanoseconds collection{0};
+    std::chrono::nanoseconds retirement{0};
+};
+
+/*
+ * Шаг симуляции на delta миллисекунд: ход собак, появление и сбор трофеев, уход простоявших игроков.
+ * Общий для обработчика API и повтора журнала. Все промежуточные данные лежат в буферах
+ * сессий и в buffers, поэтому установившийся тик (без входов и уходов игроков) не выделяет память.
+ * Возвращает результаты ушедших игроков.
+ */
+std::vector<domain::Record> Simulate(model::Game& game
+                                   , players::Players& players
+                                   , extra_data::LostObjectsOnMaps& lost_objects
+                                   , objects_collector::CollectorBuffers& buffers
+                                   , int delta
+                                   , int retired_time
+                                   , TickTimings* timings = nullptr);
+
+// direction - символ из запроса action: 'U', 'D', 'L', 'R' или '\0' для остановки
+void ApplyMove(model::Game& game, const players::Player& player, char direction);
+
+/*
+ * Повтор события журнала без HTTP: при запуске сервера и в game_replay.
+ * RetireEvent модель не меняет и пропускается, его результаты уже сохранены.
+ * Для TickEvent возвращает результаты игроков, ушедших в этом тике.
+ */
+std::vector<domain::Record> ApplyEvent(model::Game& game
+                                     , players::Players& players
+                                     , extra_data::LostObjectsOnMaps& lost_objects
+                                     , objects_collector::CollectorBuffers& buffers
+                                     , int retired_time
+                                     , const journal::Event& event
+                                     , TickTimings* timings = nullptr);
+
+} // game_tick
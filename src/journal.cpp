@@ -0,0 +1,495 @@
+#include "journal.h"
+#include "binary_log.h"
+#include "log_utils.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+
+namespace journal{
+
+namespace details{
+
+    constexpr std::array<char, 4> MAGIC = {'G', 'S', 'J', 'L'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = MAGIC.size() + sizeof(std::uint32_t);
+    constexpr size_t MAX_PAYLOAD_SIZE = 1 << 20;
+
+    constexpr std::string_view SEGMENT_PREFIX = "journal-";
+    constexpr std::string_view SEGMENT_SUFFIX = ".log";
+
+    enum class EventType : std::uint32_t{
+        JOIN = 1,
+        MOVE,
+        TICK,
+        RETIRE
+    };
+
+    using binary_log::PutU32;
+    using binary_log::PutDouble;
+    using binary_log::PutString;
+
+    // токен пишется так же, как отдается клиенту
+    void PutToken(std::vector<char>& out, const players::Token& token){
+        auto chars = token.ToChars();
+        PutString(out, std::string_view(chars.data(), chars.size()));
+    }
+
+    struct Encoder{
+        void operator()(const JoinEvent& event) const{
+            PutU32(out, static_cast<std::uint32_t>(EventType::JOIN));
+            PutString(out, event.map_id);
+            PutString(out, event.dog_name);
+            PutToken(out, event.token);
+            PutU32(out, static_cast<std::uint32_t>(event.player_id));
+            PutDouble(out, event.pos.x);
+            PutDouble(out, event.pos.y);
+        }
+
+        void operator()(const MoveEvent& event) const{
+            PutU32(out, static_cast<std::uint32_t>(EventType::MOVE));
+            PutToken(out, event.token);
+            PutU32(out, static_cast<unsigned char>(event.direction));
+        }
+
+        void operator()(const TickEvent& event) const{
+            PutU32(out, static_cast<std::uint32_t>(EventType::TICK));
+            PutU32(out, static_cast<std::uint32_t>(event.delta));
+            PutU32(out, event.seed);
+        }
+
+        void operator()(const RetireEvent& event) const{
+            PutU32(out, static_cast<std::uint32_t>(EventType::RETIRE));
+            PutU32(out, static_cast<std::uint32_t>(event.records.size()));
+            for(const auto& record : event.records){
+                const auto& uuid = *record.GetId();
+                out.insert(out.end(), uuid.begin(), uuid.end());
+                PutU32(out, static_cast<std::uint32_t>(record.GetScore()));
+                PutU32(out, static_cast<std::uint32_t>(record.GetTime()));
+                PutString(out, record.GetDogName());
+            }
+        }
+
+        std::vector<char>& out;
+    };
+
+    std::optional<Event> DecodeEvent(const char* data, size_t size){
+        binary_log::Reader reader(data, size);
+        auto type = reader.GetU32();
+        if(!type){
+            return std::nullopt;
+        }
+
+        std::optional<Event> event;
+        switch(static_cast<EventType>(*type)){
+            case EventType::JOIN:{
+                JoinEvent join;
+                auto map_id = reader.GetString();
+                auto dog_name = reader.GetString();
+                auto token = reader.GetString();
+                auto player_id = reader.GetU32();
+                auto x = reader.GetDouble();
+                auto y = reader.GetDouble();
+                if(reader.IsFailed()){
+                    return std::nullopt;
+                }
+                auto parsed_token = players::Token::Parse(*token);
+                if(!parsed_token){
+                    return std::nullopt;
+                }
+                join.map_id = std::move(*map_id);
+                join.dog_name = std::move(*dog_name);
+                join.token = *parsed_token;
+                join.player_id = static_cast<int>(*player_id);
+                join.pos = model::Coordinates{*x, *y};
+                event = std::move(join);
+                break;
+            }
+            case EventType::MOVE:{
+                auto token = reader.GetString();
+                auto direction = reader.GetU32();
+                if(reader.IsFailed()){
+                    return std::nullopt;
+                }
+                auto parsed_token = players::Token::Parse(*token);
+                if(!parsed_token){
+                    return std::nullopt;
+                }
+                event = MoveEvent{*parsed_token, static_cast<char>(*direction)};
+                break;
+            }
+            case EventType::TICK:{
+                auto delta = reader.GetU32();
+                auto seed = reader.GetU32();
+                if(reader.IsFailed()){
+                    return std::nullopt;
+                }
+                event = TickEvent{static_cast<int>(*delta), *seed};
+                break;
+            }
+            case EventType::RETIRE:{
+                auto count = reader.GetU32();
+                if(!count){
+                    return std::nullopt;
+                }
+                RetireEvent retire;
+                for(std::uint32_t i = 0; i < *count; ++i){
+                    auto uuid_bytes = reader.GetBytes(16);
+                    auto score = reader.GetU32();
+                    auto play_time = reader.GetU32();
+                    auto name = reader.GetString();
+                    if(reader.IsFailed()){
+                        return std::nullopt;
+                    }
+                    util::detail::UUIDType uuid;
+                    std::copy(uuid_bytes->begin(), uuid_bytes->end(), uuid.begin());
+                    retire.records.emplace_back(domain::RecordId{uuid}, *name
+                                                , static_cast<int>(*score), static_cast<int>(*play_time));
+                }
+                event = std::move(retire);
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+
+        if(reader.GetRemaining() != 0){
+            return std::nullopt;
+        }
+        return event;
+    }
+
+    std::vector<char> MakeHeader(){
+        std::vector<char> header(MAGIC.begin(), MAGIC.end());
+        PutU32(header, VERSION);
+        return header;
+    }
+
+    void LogJournalError(const std::string& text){
+        BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, log_data::MakeErrorData(0, text, "journal"))
+                                << "error";
+    }
+
+    bool WriteAll(int fd, const std::vector<char>& data){
+        size_t written = 0;
+        while(written < data.size()){
+            ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+            if(result < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+} // details
+
+boost::json::value MakeJournalStatsData(const JournalStats& stats){
+    boost::json::object answer;
+    answer.insert(boost::json::object::value_type{"events", stats.events});
+    answer.insert(boost::json::object::value_type{"commits", stats.commits});
+    answer.insert(boost::json::object::value_type{"bytes", stats.bytes});
+    answer.insert(boost::json::object::value_type{"failed_commits", stats.failed_commits});
+    return answer;
+}
+
+Journal::Journal(JournalConfig config)
+    : config_(std::move(config)){
+    std::filesystem::create_directories(config_.dir);
+}
+
+Journal::~Journal(){
+    if(worker_.joinable()){
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        cond_var_.notify_all();
+        worker_.join();
+    }
+    CloseSegment();
+}
+
+size_t Journal::Replay(std::uint64_t first_segment, const std::function<void(const Event&)>& handler) const{
+    size_t replayed = 0;
+    for(auto segment : ListSegments()){
+        if(segment < first_segment){
+            continue;
+        }
+
+        auto path = GetSegmentPath(segment);
+        std::vector<char> data;
+        {
+            std::ifstream file(path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        if(data.size() < details::HEADER_SIZE){
+            // сегмент создан, но заголовок не дописан
+            continue;
+        }
+        if(!std::equal(details::MAGIC.begin(), details::MAGIC.end(), data.begin())
+            || binary_log::GetU32(data.data() + details::MAGIC.size()) != details::VERSION){
+            throw std::runtime_error(path.string() + " is not a journal segment");
+        }
+
+        size_t offset = binary_log::ReadEntries(data, details::HEADER_SIZE, details::MAX_PAYLOAD_SIZE, [&](const char* payload, size_t size){
+            auto event = details::DecodeEvent(payload, size);
+            if(!event){
+                return false;
+            }
+            handler(*event);
+            ++replayed;
+            return true;
+        });
+
+        // оборванный хвост остается от падения. После перезапуска события пишутся
+        // в следующий сегмент, поэтому повтор продолжается с него
+        if(offset != data.size()){
+            details::LogJournalError("skipped broken tail of " + path.string() + ": "
+                                     + std::to_string(data.size() - offset) + " bytes");
+        }
+    }
+    return replayed;
+}
+
+void Journal::Start(){
+    auto segments = ListSegments();
+    {
+        std::lock_guard lock{mutex_};
+        current_segment_ = segments.empty() ? 1 : segments.back() + 1;
+    }
+    worker_ = std::thread([this]{
+        Run();
+    });
+}
+
+void Journal::Append(const Event& event){
+    {
+        std::lock_guard lock{mutex_};
+        AppendLocked(event);
+    }
+    cond_var_.notify_all();
+}
+
+void Journal::Append(const std::vector<Event>& events){
+    if(events.empty()){
+        return;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        for(const auto& event : events){
+            AppendLocked(event);
+        }
+    }
+    cond_var_.notify_all();
+}
+
+std::uint64_t Journal::Rotate(){
+    std::lock_guard lock{mutex_};
+    return ++current_segment_;
+}
+
+void Journal::DropSegmentsBefore(std::uint64_t segment){
+    // события старых сегментов должны лечь на диск до удаления, иначе поток записи создаст файл заново
+    if(!Flush()){
+        details::LogJournalError("old segments are kept: journal is not written");
+        return;
+    }
+    for(auto old_segment : ListSegments()){
+        if(old_segment >= segment){
+            break;
+        }
+        std::error_code ec;
+        std::filesystem::remove(GetSegmentPath(old_segment), ec);
+        if(ec){
+            details::LogJournalError("remove " + GetSegmentPath(old_segment).string() + ": " + ec.message());
+        }
+    }
+}
+
+bool Journal::Flush(){
+    std::unique_lock lock{mutex_};
+    if(!worker_.joinable()){
+        return true;
+    }
+    auto target = appended_;
+    auto failed_commits = stats_.failed_commits;
+    flush_requested_ = true;
+    cond_var_.notify_all();
+    cond_var_.wait(lock, [this, target, failed_commits]{
+        return committed_ >= target || stats_.failed_commits != failed_commits;
+    });
+    return committed_ >= target;
+}
+
+JournalStats Journal::GetStats() const{
+    std::lock_guard lock{mutex_};
+    return stats_;
+}
+
+void Journal::AppendLocked(const Event& event){
+    if(pending_.empty() || pending_.back().segment != current_segment_){
+        pending_.push_back(Chunk{current_segment_, {}, 0});
+    }
+    auto& chunk = pending_.back();
+
+    std::vector<char> payload;
+    std::visit(details::Encoder{payload}, event);
+    binary_log::AppendEntry(chunk.data, payload);
+    ++chunk.events;
+    ++appended_;
+}
+
+void Journal::Run(){
+    std::unique_lock lock{mutex_};
+    while(true){
+        cond_var_.wait(lock, [this]{
+            return stopping_ || !pending_.empty();
+        });
+        if(pending_.empty()){
+            return;
+        }
+        // копим события, пока не истечет интервал или кто-то не ждет Flush
+        cond_var_.wait_for(lock, config_.commit_interval, [this]{
+            return stopping_ || flush_requested_;
+        });
+
+        std::vector<Chunk> chunks;
+        chunks.swap(pending_);
+        auto target = appended_;
+        flush_requested_ = false;
+        lock.unlock();
+
+        bool is_ok = WriteChunks(chunks);
+
+        lock.lock();
+        if(is_ok){
+            committed_ = target;
+            ++stats_.commits;
+            for(const auto& chunk : chunks){
+                stats_.events += chunk.events;
+                stats_.bytes += chunk.data.size();
+            }
+        }
+        else{
+            ++stats_.failed_commits;
+            if(stopping_){
+                // Повторять некому. Дальнейшие события без пропавших бесполезны: после пропущенного
+                // входа игрока его действия при повторе ничего бы не сделали
+                size_t lost = 0;
+                for(const auto& chunk : chunks){
+                    lost += chunk.events;
+                }
+                for(const auto& chunk : pending_){
+                    lost += chunk.events;
+                }
+                pending_.clear();
+                details::LogJournalError("events are lost: " + std::to_string(lost));
+            }
+            else{
+                // пачка возвращается в начало очереди и пишется снова целиком, порядок событий сохраняется
+                chunks.insert(chunks.end(), std::make_move_iterator(pending_.begin()), std::make_move_iterator(pending_.end()));
+                pending_.swap(chunks);
+            }
+        }
+        cond_var_.notify_all();
+    }
+}
+
+bool Journal::WriteChunks(const std::vector<Chunk>& chunks){
+    // размеры сегментов до пачки: при ошибке пачка убирается целиком, чтобы повтор не записал ее дважды
+    std::vector<std::pair<std::uint64_t, off_t>> sizes_before;
+    auto rollback = [&]{
+        for(const auto& [segment, size] : sizes_before){
+            if(size >= 0){
+                ::truncate(GetSegmentPath(segment).c_str(), size);
+            }
+        }
+        return false;
+    };
+
+    for(const auto& chunk : chunks){
+        if(fd_ < 0 || chunk.segment != open_segment_){
+            CloseSegment();
+            if(!OpenSegment(chunk.segment)){
+                return rollback();
+            }
+        }
+        if(sizes_before.empty() || sizes_before.back().first != open_segment_){
+            sizes_before.emplace_back(open_segment_, ::lseek(fd_, 0, SEEK_END));
+        }
+        if(!details::WriteAll(fd_, chunk.data)){
+            details::LogJournalError("write " + GetSegmentPath(open_segment_).string() + ": " + std::strerror(errno));
+            return rollback();
+        }
+    }
+    if(fd_ >= 0 && ::fdatasync(fd_) != 0){
+        details::LogJournalError("fsync " + GetSegmentPath(open_segment_).string() + ": " + std::strerror(errno));
+        return rollback();
+    }
+    return true;
+}
+
+bool Journal::OpenSegment(std::uint64_t segment){
+    auto path = GetSegmentPath(segment);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd_ < 0){
+        details::LogJournalError("open " + path.string() + ": " + std::strerror(errno));
+        return false;
+    }
+    open_segment_ = segment;
+
+    if(::lseek(fd_, 0, SEEK_END) == 0 && !details::WriteAll(fd_, details::MakeHeader())){
+        details::LogJournalError("write " + path.string() + ": " + std::strerror(errno));
+        CloseSegment();
+        return false;
+    }
+    return true;
+}
+
+void Journal::CloseSegment(){
+    if(fd_ < 0){
+        return;
+    }
+    // прошлый сегмент мог остаться с записями без fdatasync, если пачка перешла в новый
+    ::fdatasync(fd_);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+std::filesystem::path Journal::GetSegmentPath(std::uint64_t segment) const{
+    return config_.dir / (std::string(details::SEGMENT_PREFIX) + std::to_string(segment) + std::string(details::SEGMENT_SUFFIX));
+}
+
+std::vector<std::uint64_t> Journal::ListSegments() const{
+    std::vector<std::uint64_t> segments;
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(config_.dir, ec)){
+        auto name = entry.path().filename().string();
+        if(name.size() <= details::SEGMENT_PREFIX.size() + details::SEGMENT_SUFFIX.size()
+            || name.compare(0, details::SEGMENT_PREFIX.size(), details::SEGMENT_PREFIX) != 0
+            || name.compare(name.size() - details::SEGMENT_SUFFIX.size(), details::SEGMENT_SUFFIX.size(), details::SEGMENT_SUFFIX) != 0){
+            continue;
+        }
+        auto number = name.substr(details::SEGMENT_PREFIX.size(), name.size() - details::SEGMENT_PREFIX.size() - details::SEGMENT_SUFFIX.size());
+        if(number.empty() || !std::all_of(number.begin(), number.end(), [](char c){ return c >= '0' && c <= '9'; })){
+            continue;
+        }
+        segments.push_back(std::stoull(number));
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // journal
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include "model.h"
+#include "records.h"
+#include "token.h"
+
+namespace journal{
+
+using namespace std::chrono_literals;
+
+// Игрок вошел в игру: токен и точка появления пишутся явно, при повторе они не генерируются
+struct JoinEvent{
+    std::string map_id;
+    std::string dog_name;
+    players::Token token;
+    int player_id = 0;
+    model::Coordinates pos;
+};
+
+// direction - символ из запроса action, '\0' - остановка
+struct MoveEvent{
+    players::Token token;
+    char direction = '\0';
+};
+
+// seed'ом тика инициализируются генераторы сессий, поэтому тик повторяется точно
+struct TickEvent{
+    int delta = 0;
+    std::uint32_t seed = 0;
+};
+
+// результаты ушедших игроков с их id, чтобы при повторе не появились дубликаты
+struct RetireEvent{
+    std::vector<domain::Record> records;
+};
+
+using Event = std::variant<JoinEvent, MoveEvent, TickEvent, RetireEvent>;
+
+struct JournalConfig{
+    std::filesystem::path dir;
+    // сколько копить события перед общим fdatasync
+    std::chrono::milliseconds commit_interval = 20ms;
+};
+
+struct JournalStats{
+    std::uint64_t events = 0;
+    std::uint64_t commits = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t failed_commits = 0;
+};
+
+boost::json::value MakeJournalStatsData(const JournalStats& stats);
+
+/*
+ * Журнал событий, меняющих состояние игры, между снимками.
+ * Append только кодирует событие в буфер, запись и fdatasync идут в отдельном
+ * потоке одной пачкой раз в commit_interval (group commit).
+ * Журнал разбит на сегменты journal-<номер>.log. Снимок запоминает номер сегмента,
+ * с которого начинаются события после него (Rotate), и после записи снимка старые
+ * сегменты удаляются. При запуске события повторяются поверх последнего снимка.
+ */
+class Journal{
+public:
+    explicit Journal(JournalConfig config);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Повторяет события из сегментов с номером >= first_segment. Вызывается до Start.
+    // Возвращает число повторенных событий.
+    size_t Replay(std::uint64_t first_segment, const std::function<void(const Event&)>& handler) const;
+
+    // начинает новый сегмент после существующих и запускает поток записи
+    void Start();
+
+    void Append(const Event& event);
+    // события пачки попадают в файл одной записью
+    void Append(const std::vector<Event>& events);
+
+    // События после вызова пишутся в новый сегмент, его номер сохраняется в снимке
+    std::uint64_t Rotate();
+    // Удаляет сегменты, события которых уже есть в снимке
+    void DropSegmentsBefore(std::uint64_t segment);
+
+    // Дожидается записи на диск всего, что было добавлено до вызова.
+    // false, если запись не удалась: события остаются в очереди и пишутся повторно
+    bool Flush();
+
+    JournalStats GetStats() const;
+
+private:
+    struct Chunk{
+        std::uint64_t segment;
+        std::vector<char> data;
+        size_t events = 0;
+    };
+
+    void AppendLocked(const Event& event);
+    void Run();
+    bool WriteChunks(const std::vector<Chunk>& chunks);
+    bool OpenSegment(std::uint64_t segment);
+    void CloseSegment();
+
+    std::filesystem::path GetSegmentPath(std::uint64_t segment) const;
+    std::vector<std::uint64_t> ListSegments() const;
+
+    JournalConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_var_;
+    std::vector<Chunk> pending_;
+    std::uint64_t current_segment_ = 0;
+    std::uint64_t appended_ = 0;
+    std::uint64_t committed_ = 0;
+    bool flush_requested_ = false;
+    bool stopping_ = false;
+    JournalStats stats_;
+
+    // доступны только из потока записи
+    int fd_ = -1;
+    std::uint64_t open_segment_ = 0;
+
+    std::thread worker_;
+};
+
+} // journal
@@ -86,6 +86,11 @@ GameInfo LoadGame(const std::filesystem::path& json_path) {
         default_bag_capacity = value.as_object().at("defaultBagCapacity").as_int64();
     }
 
+    double default_view_radius = 0;
+    if(value.as_object().find("defaultViewRadius") != value.as_object().end()){
+        default_view_radius = value.as_object().at("defaultViewRadius").to_number<double>();
+    }
+
     std::chrono::milliseconds ms = static_cast<uint64_t>(value.as_object().at("lootGeneratorConfig").as_object().at("period").as_double() * 1000) * 1ms;
     double probability = value.as_object().at("lootGeneratorConfig").as_object().at("probability").as_double();
 
@@ -106,7 +111,13 @@ GameInfo LoadGame(const std::filesystem::path& json_path) {
             bag_capacity = json_map.as_object().at("bagCapacity").as_int64();
         }
 
+        double view_radius = default_view_radius;
+        if(json_map.as_object().find("viewRadius") != json_map.as_object().end()){
+            view_radius = json_map.as_object().at("viewRadius").to_number<double>();
+        }
+
         model::Map map(model::Map::Id{id}, std::string(name.data(), name.size()), dog_speed, bag_capacity);
+        map.SetViewRadius(view_radius);
 
         AddRoadsToMap(map, json_map.as_object().at("roads").as_array());
         AddBuildingsToMap(map, json_map.as_object().at("buildings").as_array());
@@ -108,4 +108,99 @@ namespace json_utils{
             return std::nullopt;
         }
     }
+
+    std::string ConvertGeoDirToMoveDir(model::DirectionGeo geo){
+        switch (geo){
+        case model::DirectionGeo::NORTH:
+            return "U";
+        case model::DirectionGeo::SOUTH:
+            return "D";
+        case model::DirectionGeo::WEST:
+            return "L";
+        case model::DirectionGeo::EAST:
+            return "R";
+        default:
+            return "";
+        }
+    }
+
+    json::object FormDogJson(const model::Dog& dog){
+        json::object dog_info;
+
+        json::array coords;
+        model::Coordinates dog_coords = dog.GetCoords();
+        coords.push_back(dog_coords.x);
+        coords.push_back(dog_coords.y);
+        dog_info.insert(value_type("pos", coords));
+
+        json::array speed;
+        model::Speed dog_speed = dog.GetSpeed();
+        speed.push_back(dog_speed.horizontal);
+        speed.push_back(dog_speed.vertical);
+        dog_info.insert(value_type("speed", speed));
+
+        dog_info.insert(value_type("dir", ConvertGeoDirToMoveDir(dog.GetDir())));
+
+        json::array bag;
+        for(auto item : dog.GetBag()){
+            json::object item_object;
+            item_object.insert(value_type("id", item.id));
+            item_object.insert(value_type("type", item.type));
+
+            bag.push_back(item_object);
+        }
+
+        dog_info.insert(value_type("bag", bag));
+        dog_info.insert(value_type("score", dog.GetScore()));
+        return dog_info;
+    }
+
+    json::object FormLostObjectJson(const extra_data::LostObject& lost_obj){
+        json::object lost_obj_json;
+
+        json::array coords;
+        coords.push_back(lost_obj.coords.x);
+        coords.push_back(lost_obj.coords.y);
+
+        lost_obj_json.insert(value_type("pos", coords));
+        lost_obj_json.insert(value_type("type", lost_obj.type));
+        return lost_obj_json;
+    }
+
+    std::string FormJsonMapInfo(const model::GameSession::Dogs& dogs, const extra_data::Loot& lost_objects){
+        json::object map_info;
+
+        json::object dogs_json;
+        for(const auto& dog : dogs){
+            dogs_json.insert(value_type(std::to_string(dog.GetId()), FormDogJson(dog)));
+        }
+        map_info.insert(value_type("players", dogs_json));
+
+        json::object lost_objects_json;
+        for(const auto& lost_obj : lost_objects){
+            lost_objects_json.insert(value_type(std::to_string(lost_obj.id), FormLostObjectJson(lost_obj)));
+        }
+        map_info.insert(value_type("lostObjects", lost_objects_json));
+
+        return json::serialize(map_info);
+    }
+
+    std::string FormJsonMapInfo(const model::GameSession::Dogs& dogs, const extra_data::Loot& lost_objects
+                              , std::span<const size_t> visible_dogs, std::span<const size_t> visible_loot){
+        json::object map_info;
+
+        json::object dogs_json;
+        for(size_t position : visible_dogs){
+            dogs_json.insert(value_type(std::to_string(dogs[position].GetId()), FormDogJson(dogs[position])));
+        }
+        map_info.insert(value_type("players", dogs_json));
+
+        json::object lost_objects_json;
+        for(size_t position : visible_loot){
+            lost_objects_json.insert(value_type(std::to_string(lost_objects[position].id), FormLostObjectJson(lost_objects[position])));
+        }
+        map_info.insert(value_type("lostObjects", lost_objects_json));
+
+        return json::serialize(map_info);
+    }
 }
\ No newline at end of file
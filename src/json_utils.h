@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/json.hpp>
+#include <span>
 #include "model.h"
 #include "extra_data.h"
 
@@ -21,4 +22,12 @@ namespace json_utils{
     json::array GetLootTypes(const std::vector<extra_data::LootObject>& loot_objects);
     std::optional<std::string> GetMoveDirection(const std::string& request_body);
     std::optional<int> GetTimeDeltaFromJson(const std::string& request_body);
+    std::string ConvertGeoDirToMoveDir(model::DirectionGeo geo);
+    json::object FormDogJson(const model::Dog& dog);
+    json::object FormLostObjectJson(const extra_data::LostObject& lost_obj);
+    // тело ответа /api/v1/game/state
+    std::string FormJsonMapInfo(const model::GameSession::Dogs& dogs, const extra_data::Loot& lost_objects);
+    // только видимые игроку собаки и трофеи, позиции - в dogs и lost_objects
+    std::string FormJsonMapInfo(const model::GameSession::Dogs& dogs, const extra_data::Loot& lost_objects
+                              , std::span<const size_t> visible_dogs, std::span<const size_t> visible_loot);
 }
\ No newline at end of file
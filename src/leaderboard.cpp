@@ -0,0 +1,176 @@
+#include "leaderboard.h"
+
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <random>
+#include <tuple>
+
+namespace leaderboard{
+
+namespace details{
+
+    // больший счет выше, поэтому score сравнивается с минусом
+    struct RecordLess{
+        bool operator()(const domain::Record& lhs, const domain::Record& rhs) const{
+            return std::make_tuple(-lhs.GetScore(), lhs.GetTime(), std::cref(lhs.GetDogName()), std::cref(*lhs.GetId()))
+                 < std::make_tuple(-rhs.GetScore(), rhs.GetTime(), std::cref(rhs.GetDogName()), std::cref(*rhs.GetId()));
+        }
+
+        bool operator()(const Cursor& lhs, const domain::Record& rhs) const{
+            return std::make_tuple(-lhs.score, lhs.play_time, std::cref(lhs.name), std::cref(*lhs.id))
+                 < std::make_tuple(-rhs.GetScore(), rhs.GetTime(), std::cref(rhs.GetDogName()), std::cref(*rhs.GetId()));
+        }
+    };
+
+    constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+    std::string ToHex(std::string_view str){
+        std::string hex;
+        hex.reserve(str.size() * 2);
+        for(unsigned char c : str){
+            hex += HEX_DIGITS[c >> 4];
+            hex += HEX_DIGITS[c & 0xF];
+        }
+        return hex;
+    }
+
+    std::optional<std::string> FromHex(std::string_view hex){
+        if(hex.size() % 2 != 0){
+            return std::nullopt;
+        }
+        std::string str;
+        str.reserve(hex.size() / 2);
+        for(size_t i = 0; i < hex.size(); i += 2){
+            unsigned value = 0;
+            auto [ptr, ec] = std::from_chars(hex.data() + i, hex.data() + i + 2, value, 16);
+            if(ec != std::errc{} || ptr != hex.data() + i + 2){
+                return std::nullopt;
+            }
+            str += static_cast<char>(value);
+        }
+        return str;
+    }
+
+    template <typename Int>
+    std::optional<Int> ParseInt(std::string_view str){
+        Int value{};
+        auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if(ec != std::errc{} || ptr != str.data() + str.size()){
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::uint64_t MakeEpoch(){
+        std::random_device device;
+        return (static_cast<std::uint64_t>(device()) << 32) | device();
+    }
+
+} // details
+
+// формат: <score>.<play_time>.<uuid>.<имя в hex>
+std::string EncodeCursor(const domain::Record& record){
+    return std::to_string(record.GetScore()) + "." + std::to_string(record.GetTime()) + "."
+         + record.GetId().ToString() + "." + details::ToHex(record.GetDogName());
+}
+
+std::optional<Cursor> DecodeCursor(std::string_view cursor){
+    std::vector<std::string_view> parts;
+    while(parts.size() < 3){
+        size_t dot = cursor.find('.');
+        if(dot == std::string_view::npos){
+            return std::nullopt;
+        }
+        parts.push_back(cursor.substr(0, dot));
+        cursor.remove_prefix(dot + 1);
+    }
+    parts.push_back(cursor);
+
+    auto score = details::ParseInt<int>(parts[0]);
+    auto play_time = details::ParseInt<int>(parts[1]);
+    auto name = details::FromHex(parts[3]);
+    if(!score || !play_time || !name){
+        return std::nullopt;
+    }
+
+    try{
+        return Cursor{*score, *play_time, std::move(*name), domain::RecordId::FromString(std::string(parts[2]))};
+    }catch(const std::exception&){
+        return std::nullopt;
+    }
+}
+
+Leaderboard::Leaderboard()
+    : epoch_(details::MakeEpoch()){
+}
+
+void Leaderboard::Add(const std::vector<domain::Record>& records){
+    std::unique_lock lock{mutex_};
+
+    // новые записи дописываются в конец, сортируются и сливаются с таблицей:
+    // O(n + k log k) на пачку вместо O(n) на каждую запись, что важно при восстановлении
+    const size_t old_size = records_.size();
+    for(const auto& record : records){
+        if(ids_.insert(record.GetId()).second){
+            records_.push_back(record);
+        }
+    }
+    if(records_.size() == old_size){
+        return;
+    }
+
+    auto middle = records_.begin() + old_size;
+    std::sort(middle, records_.end(), details::RecordLess{});
+    std::inplace_merge(records_.begin(), middle, records_.end(), details::RecordLess{});
+    ++version_;
+}
+
+Leaderboard::Page Leaderboard::GetPage(size_t start, size_t max_items) const{
+    std::shared_lock lock{mutex_};
+    if(start >= records_.size()){
+        return Page{{}, version_, std::nullopt};
+    }
+    return MakePage(records_.begin() + start, max_items);
+}
+
+Leaderboard::Page Leaderboard::GetPageAfter(const Cursor& cursor, size_t max_items) const{
+    std::shared_lock lock{mutex_};
+    auto begin = std::upper_bound(records_.begin(), records_.end(), cursor, details::RecordLess{});
+    return MakePage(begin, max_items);
+}
+
+bool Leaderboard::Contains(const domain::RecordId& id) const{
+    std::shared_lock lock{mutex_};
+    return ids_.contains(id);
+}
+
+std::uint64_t Leaderboard::GetVersion() const{
+    std::shared_lock lock{mutex_};
+    return version_;
+}
+
+size_t Leaderboard::GetSize() const{
+    std::shared_lock lock{mutex_};
+    return records_.size();
+}
+
+std::string Leaderboard::MakeETag(std::uint64_t version) const{
+    return "\"" + std::to_string(epoch_) + "-" + std::to_string(version) + "\"";
+}
+
+Leaderboard::Page Leaderboard::MakePage(Iterator begin, size_t max_items) const{
+    Page page;
+    page.version = version_;
+
+    size_t available = static_cast<size_t>(records_.end() - begin);
+    auto end = begin + std::min(available, max_items);
+    page.records.assign(begin, end);
+
+    if(end != records_.end() && !page.records.empty()){
+        page.next_cursor = EncodeCursor(page.records.back());
+    }
+    return page;
+}
+
+} // leaderboard
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/container_hash/hash.hpp>
+
+#include "records.h"
+
+namespace leaderboard{
+
+// Позиция в таблице рекордов для постраничного вывода по ключу.
+// Содержит полный ключ сортировки, поэтому поиск не зависит от смещения.
+struct Cursor{
+    int score = 0;
+    int play_time = 0;
+    std::string name;
+    domain::RecordId id;
+};
+
+struct RecordIdHasher{
+    size_t operator()(const domain::RecordId& id) const{
+        return boost::hash<util::detail::UUIDType>{}(*id);
+    }
+};
+
+std::string EncodeCursor(const domain::Record& record);
+std::optional<Cursor> DecodeCursor(std::string_view cursor);
+
+/*
+ * Упорядоченная копия таблицы retired_players в памяти.
+ * Порядок тот же, что и в запросе к БД: score DESC, play_time, name (и id для однозначности).
+ * Читается из strand'а API, пополняется из потока записи рекордов.
+ */
+class Leaderboard{
+public:
+    struct Page{
+        std::vector<domain::Record> records;
+        std::uint64_t version = 0;
+        // есть, если после страницы остались записи
+        std::optional<std::string> next_cursor;
+    };
+
+    Leaderboard();
+
+    // повторно добавленные записи (по id) игнорируются
+    void Add(const std::vector<domain::Record>& records);
+
+    Page GetPage(size_t start, size_t max_items) const;
+    // страница, начинающаяся сразу после записи cursor: O(log n + max_items)
+    Page GetPageAfter(const Cursor& cursor, size_t max_items) const;
+
+    bool Contains(const domain::RecordId& id) const;
+
+    std::uint64_t GetVersion() const;
+    size_t GetSize() const;
+
+    // ETag страницы с данной версией. Версия начинается заново при каждом запуске,
+    // поэтому в ETag есть и случайная эпоха процесса: ETag прошлого запуска не совпадет с новой таблицей
+    std::string MakeETag(std::uint64_t version) const;
+
+private:
+    using Iterator = std::vector<domain::Record>::const_iterator;
+
+    Page MakePage(Iterator begin, size_t max_items) const;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<domain::Record> records_;
+    std::unordered_set<domain::RecordId, RecordIdHasher> ids_;
+    std::uint64_t version_ = 0;
+    const std::uint64_t epoch_;
+};
+
+} // leaderboard
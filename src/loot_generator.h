@@ -35,6 +35,15 @@ public:
      */
     unsigned Generate(TimeInterval time_delta, unsigned loot_count, unsigned looter_count);
 
+    // накопленное время без появления трофеев, сохраняется в снимке состояния
+    TimeInterval GetTimeWithoutLoot() const {
+        return time_without_loot_;
+    }
+
+    void SetTimeWithoutLoot(TimeInterval time_without_loot) {
+        time_without_loot_ = time_without_loot;
+    }
+
 private:
     static double DefaultGenerator() noexcept {
         return 1.0;
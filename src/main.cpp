@@ -6,7 +6,12 @@
 #include <boost/asio/signal_set.hpp>
 #include <boost/json.hpp>
 #include <boost/program_options.hpp>
+#include <atomic>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <random>
 #include <thread>
 
 // #define BOOST_USE_WINAPI_VERSION _WIN32_WINNT
@@ -14,6 +19,8 @@
 #include "json_loader.h"
 #include "request_handler.h"
 #include "postgres.h"
+#include "record_log.h"
+#include "ticker.h"
 
 using namespace std::literals;
 namespace net = boost::asio;
@@ -23,57 +30,9 @@ using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
 
 namespace {
 
-class Ticker : public std::enable_shared_from_this<Ticker> {
-public:
-    using Strand = net::strand<net::io_context::executor_type>;
-    using Handler = std::function<void(std::chrono::milliseconds delta)>;
-
-    // Функция handler будет вызываться внутри strand с интервалом period
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
-        : strand_{strand}
-        , period_{period}
-        , handler_{std::move(handler)} {
-    }
-
-    void Start() {
-        net::dispatch(strand_, [self = shared_from_this()] {
-            self->last_tick_ = Clock::now();
-            self->ScheduleTick();
-        });
-    }
-
-private:
-    void ScheduleTick() {
-        assert(strand_.running_in_this_thread());
-        timer_.expires_after(period_);
-        timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
-            self->OnTick(ec);
-        });
-    }
-
-    void OnTick(boost::system::error_code ec) {
-        using namespace std::chrono;
-        assert(strand_.running_in_this_thread());
-
-        if (!ec) {
-            auto this_tick = Clock::now();
-            auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-            last_tick_ = this_tick;
-            try {
-                handler_(delta);
-            } catch (...) {
-            }
-            ScheduleTick();
-        }
-    }
-
-    using Clock = std::chrono::steady_clock;
-
-    Strand strand_;
-    std::chrono::milliseconds period_;
-    net::steady_timer timer_{strand_};
-    Handler handler_;
-    std::chrono::steady_clock::time_point last_tick_;
+enum class RecordsBackend{
+    POSTGRES,
+    FILE
 };
 
 struct Args{
@@ -83,6 +42,19 @@ struct Args{
     bool is_random_generate;
     std::string snapshoot_path;
     int save_state_period;
+    ticker::CatchUpPolicy tick_catch_up;
+    unsigned tick_max_steps;
+    int tick_stats_period;
+    std::string records_spill_path;
+    unsigned db_pool_size;
+    int db_acquire_timeout;
+    RecordsBackend records_backend;
+    std::string records_file;
+    int records_sync_interval;
+    std::string journal_dir;
+    int journal_commit_interval;
+    int state_compression_level;
+    std::uint64_t random_seed;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]){
@@ -97,8 +69,21 @@ struct Args{
         ("config-file,c", po::value(&args.config_file)->value_name("file"), "set config file path")
         ("www-root,w", po::value(&args.root_path)->value_name("dir"), "set static files root")
         ("randomize-spawn-points", "spawn dogs at random positions")
+        ("random-seed", po::value(&args.random_seed)->value_name("seed"), "seed of game randomness, random by default")
         ("state-file", po::value(&args.snapshoot_path)->value_name("state_file"))
-        ("save-state-period", po::value(&args.save_state_period)->value_name("save_state_period"));
+        ("save-state-period", po::value(&args.save_state_period)->value_name("save_state_period"))
+        ("state-compression-level", po::value(&args.state_compression_level)->value_name("level"), "gzip level 1-9 for state snapshots, 0 - no compression")
+        ("tick-catch-up", po::value<std::string>()->value_name("policy"), "tick catch-up policy: multi-step, clamp or skip")
+        ("tick-max-steps", po::value(&args.tick_max_steps)->value_name("steps"), "max periods to catch up in one timer wake-up")
+        ("tick-stats-period", po::value(&args.tick_stats_period)->value_name("milliseconds"), "tick lag statistics logging period")
+        ("records-spill-file", po::value(&args.records_spill_path)->value_name("file"), "where to keep records while database is unavailable")
+        ("db-pool-size", po::value(&args.db_pool_size)->value_name("connections"), "max database connections, opened on demand")
+        ("db-acquire-timeout", po::value(&args.db_acquire_timeout)->value_name("milliseconds"), "how long to wait for a free database connection")
+        ("records-backend", po::value<std::string>()->value_name("backend"), "where to store records: postgres or file")
+        ("records-file", po::value(&args.records_file)->value_name("file"), "record log path for the file backend")
+        ("records-sync-interval", po::value(&args.records_sync_interval)->value_name("milliseconds"), "min interval between record log fsyncs, 0 - after every batch")
+        ("journal-dir", po::value(&args.journal_dir)->value_name("dir"), "write-ahead journal of game events between state snapshots")
+        ("journal-commit-interval", po::value(&args.journal_commit_interval)->value_name("milliseconds"), "how long journal events are batched before fsync");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -121,11 +106,63 @@ struct Args{
     if(!vm.contains("save-state-period")){
         args.save_state_period = 0;
     }
+    if(!vm.contains("state-compression-level"s)){
+        args.state_compression_level = 0;
+    }
+    if(args.state_compression_level < 0 || args.state_compression_level > 9){
+        throw std::runtime_error("State compression level must be in 0-9"s);
+    }
     if(!vm.contains("state-file"s)){
         args.snapshoot_path = "";
         args.save_state_period = 0;
     }
     
+    args.tick_catch_up = ticker::CatchUpPolicy::MULTI_STEP;
+    if(vm.contains("tick-catch-up"s)){
+        auto policy = ticker::ParseCatchUpPolicy(vm["tick-catch-up"s].as<std::string>());
+        if(!policy.has_value()){
+            throw std::runtime_error("Unknown tick catch-up policy"s);
+        }
+        args.tick_catch_up = *policy;
+    }
+    if(!vm.contains("tick-max-steps"s)){
+        args.tick_max_steps = 5;
+    }
+    if(!vm.contains("tick-stats-period"s)){
+        args.tick_stats_period = 10000;
+    }
+    if(!vm.contains("db-pool-size"s)){
+        args.db_pool_size = std::thread::hardware_concurrency();
+    }
+    if(!vm.contains("db-acquire-timeout"s)){
+        args.db_acquire_timeout = 5000;
+    }
+
+    args.records_backend = RecordsBackend::POSTGRES;
+    if(vm.contains("records-backend"s)){
+        const auto& backend = vm["records-backend"s].as<std::string>();
+        if(backend == "file"s){
+            args.records_backend = RecordsBackend::FILE;
+        }
+        else if(backend != "postgres"s){
+            throw std::runtime_error("Unknown records backend"s);
+        }
+    }
+    if(args.records_backend == RecordsBackend::FILE && !vm.contains("records-file"s)){
+        throw std::runtime_error("Records file path is not specified"s);
+    }
+    if(!vm.contains("records-sync-interval"s)){
+        args.records_sync_interval = 0;
+    }
+    if(!vm.contains("journal-commit-interval"s)){
+        args.journal_commit_interval = 20;
+    }
+
+    if(!vm.contains("random-seed"s)){
+        std::random_device device;
+        args.random_seed = static_cast<std::uint64_t>(device()) << 32 | device();
+    }
+
     if (!vm.contains("randomize-spawn-points"s)) {
         args.is_random_generate = false;
     }
@@ -136,6 +173,60 @@ struct Args{
     return args;
 }
 
+// Длительность этапов запуска, пишется в лог одним сообщением
+class StartupTimings{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // выполняет fn и запоминает, сколько он занял (в том числе при ошибке).
+    // Этапы могут идти в разных потоках
+    template <typename Fn>
+    decltype(auto) Measure(const std::string& phase, Fn&& fn){
+        PhaseGuard guard{*this, phase};
+        return fn();
+    }
+
+    // время от запуска процесса
+    void Mark(const std::string& phase){
+        Add(phase, Clock::now() - start_);
+    }
+
+    boost::json::value MakeData() const{
+        std::lock_guard lock{mutex_};
+        boost::json::object answer;
+        for(const auto& [phase, duration] : phases_){
+            answer.insert(boost::json::object::value_type{phase + "_ms", duration.count()});
+        }
+        return answer;
+    }
+
+private:
+    struct PhaseGuard{
+        ~PhaseGuard(){
+            timings.Add(phase, Clock::now() - start);
+        }
+
+        StartupTimings& timings;
+        const std::string& phase;
+        Clock::time_point start = Clock::now();
+    };
+
+    void Add(const std::string& phase, Clock::duration duration){
+        std::lock_guard lock{mutex_};
+        phases_.emplace_back(phase, std::chrono::duration_cast<std::chrono::milliseconds>(duration));
+    }
+
+    Clock::time_point start_ = Clock::now();
+    mutable std::mutex mutex_;
+    std::vector<std::pair<std::string, std::chrono::milliseconds>> phases_;
+};
+
+void LogStartupError(const std::string& text){
+    BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                             << logging::add_value(additional_data, log_data::MakeErrorData(0, text, "startup"))
+                             << "error";
+}
+
 // Запускает функцию fn на n потоках, включая текущий
 template <typename Fn>
 void RunWorkers(unsigned num_workers, const Fn& fn) {
@@ -154,9 +245,18 @@ void RunWorkers(unsigned num_workers, const Fn& fn) {
 int main(int argc, const char* argv[]) {
     try {
         if(auto args = ParseCommandLine(argc, argv)){
+            StartupTimings startup_timings;
+            logging::add_console_log(std::clog, keywords::format = &formatter::JsonFormatter);
+
             // 1. Загружаем карту из файла и построить модель игры
-            srand(std::time(NULL));
-            json_loader::GameInfo game_info = json_loader::LoadGame(fs::path(args->config_file));
+            json_loader::GameInfo game_info = startup_timings.Measure("config", [&]{
+                return json_loader::LoadGame(fs::path(args->config_file));
+            });
+            // с этим seed'ом и журналом игру можно повторить; снимок продолжает свою последовательность
+            game_info.game.SetRandomSeed(args->random_seed);
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                    << logging::add_value(additional_data, boost::json::object{{"seed", args->random_seed}})
+                                    << "random seed";
 
             const unsigned num_threads = std::thread::hardware_concurrency();
             net::io_context ioc(num_threads);
@@ -179,47 +279,210 @@ int main(int argc, const char* argv[]) {
 
             std::shared_ptr<serializing_listener::SerializingListener> listener = args->snapshoot_path.empty() ? nullptr
                                                                                     : std::make_shared<serializing_listener::SerializingListener>
-                                                                                    (args->save_state_period * 1ms, args->snapshoot_path);
+                                                                                    (args->save_state_period * 1ms, args->snapshoot_path, args->state_compression_level);
+
+            // журнал событий между снимками, повторяется при запуске поверх последнего снимка
+            std::shared_ptr<journal::Journal> journal;
+            if(!args->journal_dir.empty()){
+                journal::JournalConfig journal_config;
+                journal_config.dir = args->journal_dir;
+                journal_config.commit_interval = args->journal_commit_interval * 1ms;
+                journal = std::make_shared<journal::Journal>(journal_config);
+                if(listener){
+                    listener->SetJournal(journal);
+                }
+            }
+
+            // таблица рекордов в памяти, /records отвечает из нее без обращения к хранилищу
+            auto leaderboard = std::make_shared<leaderboard::Leaderboard>();
+            // Хранилище рекордов открывается в фоне вместе с восстановлением состояния.
+            // Повтор журнала уже отдает рекорды ушедших игроков, поэтому писатель копит их
+            // в очереди и запускается, только когда хранилище открыто
+            std::shared_ptr<postgres::Database> db;
+            std::shared_ptr<record_log::RecordLog> record_log;
+            record_writer::RecordWriter::SaveFunc save_records;
+
+            if(args->records_backend == RecordsBackend::FILE){
+                save_records = [&record_log](const std::vector<domain::Record>& records){
+                    record_log->SaveRecords(records);
+                };
+            }
+            else{
+                save_records = [&db, leaderboard](const std::vector<domain::Record>& records){
+                    db->GetRecordRepo()->SaveRecords(records);
+                    leaderboard->Add(records);
+                };
+            }
 
-            const char* db_url = std::getenv("GAME_DB_URL");
-            std::shared_ptr<postgres::Database> db = std::make_shared<postgres::Database>(num_threads, db_url);
+            auto open_storage = [&]{
+                if(args->records_backend == RecordsBackend::FILE){
+                    // журнал восстанавливается прямо в таблицу рекордов, она же служит его индексом
+                    record_log::LogConfig log_config;
+                    log_config.path = args->records_file;
+                    log_config.sync_interval = args->records_sync_interval * 1ms;
+                    record_log = std::make_shared<record_log::RecordLog>(log_config, leaderboard);
+                    return;
+                }
+
+                const char* db_url = std::getenv("GAME_DB_URL");
+                PoolConfig pool_config;
+                pool_config.max_size = std::max(1u, args->db_pool_size);
+                pool_config.acquire_timeout = args->db_acquire_timeout * 1ms;
+                const std::string db_conninfo = db_url == nullptr ? ""s : std::string(db_url);
+                db = std::make_shared<postgres::Database>(ioc, pool_config, db_conninfo);
+
+                // Заполняется через неблокирующее соединение на потоках io_context. Этап ждет загрузки:
+                // без нее /records отдал бы неполную таблицу, а ошибка останавливает сервер, как и ошибка БД
+                auto warmed_up = std::make_shared<std::promise<void>>();
+                auto warmed_up_future = warmed_up->get_future();
+                auto on_error = [warmed_up](boost::system::error_code ec){
+                    warmed_up->set_exception(std::make_exception_ptr(boost::system::system_error(ec, "leaderboard warm-up")));
+                };
+                async_pg::Connection::AsyncConnect(ioc.get_executor(), db_conninfo, [leaderboard, warmed_up, on_error](boost::system::error_code ec, std::shared_ptr<async_pg::Connection> connection){
+                    if(ec){
+                        on_error(ec);
+                        return;
+                    }
+                    auto repo = std::make_shared<postgres::AsyncRecordRepository>(std::move(connection));
+                    repo->AsyncGetRecords(0, std::numeric_limits<int>::max(), [leaderboard, warmed_up, on_error, repo](boost::system::error_code ec, std::vector<domain::Record> records){
+                        if(ec){
+                            on_error(ec);
+                            return;
+                        }
+                        leaderboard->Add(records);
+                        warmed_up->set_value();
+                    });
+                });
+                // после остановки io_context обработчики уже не вызовутся
+                while(warmed_up_future.wait_for(100ms) != std::future_status::ready){
+                    if(ioc.stopped()){
+                        throw std::runtime_error("server stopped during leaderboard warm-up"s);
+                    }
+                }
+                warmed_up_future.get();
+            };
+
+            record_writer::WriterConfig writer_config;
+            writer_config.spill_path = args->records_spill_path;
+            if(args->records_backend == RecordsBackend::FILE && args->records_sync_interval > 0){
+                // пачка, после которой записей больше нет, иначе ждала бы fsync до остановки
+                writer_config.flush = [&record_log]{
+                    record_log->Sync();
+                };
+                writer_config.flush_interval = args->records_sync_interval * 1ms;
+            }
+            auto record_writer = std::make_shared<record_writer::RecordWriter>(std::move(save_records), writer_config);
 
             std::shared_ptr<http_handler::RequestHandler> handler = std::make_shared<http_handler::RequestHandler>(game_info.game, lost_objects_on_maps
                                                                         , fs::path(args->root_path), api_strand, args->milliseconds, args->is_random_generate
                                                                         , dynamic_cast<serializing_listener::ApplicationListener*>(&*listener)
-                                                                        , db, game_info.retired_time);
+                                                                        , leaderboard, record_writer, game_info.retired_time, journal);
 
-            if(args->milliseconds > 0){
-                auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds(args->milliseconds), [&handler](std::chrono::milliseconds delta){
+            // тикер создается на strand'е, когда состояние восстановлено
+            std::shared_ptr<ticker::Ticker> ticker;
+            auto start_ticker = [&]{
+                if(args->milliseconds <= 0){
+                    return;
+                }
+                ticker = std::make_shared<ticker::Ticker>(api_strand, std::chrono::milliseconds(args->milliseconds), [&handler](std::chrono::milliseconds delta){
                     handler->Tick(delta.count());
-                });
+                }, args->tick_catch_up, args->tick_max_steps);
+                if(args->tick_stats_period > 0){
+                    ticker->SetStatsHandler(std::chrono::milliseconds(args->tick_stats_period), [db, listener, journal](const ticker::TickStats& stats){
+                        BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                                << logging::add_value(additional_data, ticker::MakeTickStatsData(stats))
+                                                << "tick stats";
+                        if(db){
+                            BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                                    << logging::add_value(additional_data, MakePoolStatsData(db->GetPoolStats()))
+                                                    << "db pool stats";
+                        }
+                        if(listener){
+                            BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                                    << logging::add_value(additional_data, serializing_listener::MakeSnapshotStatsData(listener->GetStats()))
+                                                    << "snapshot stats";
+                        }
+                        if(journal){
+                            BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                                    << logging::add_value(additional_data, journal::MakeJournalStatsData(journal->GetStats()))
+                                                    << "journal stats";
+                        }
+                    });
+                }
                 ticker->Start();
-            }
+            };
 
             const net::ip::address address{net::ip::make_address_v4("0.0.0.0")};
             static const int port = 8080;
 
-            // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
+            // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов.
+            // Порт открывается сразу, до готовности API отвечает 503
             http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, auto&& send) {
                 (*handler)(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
             });
-
-            logging::add_console_log(std::clog, keywords::format = &formatter::JsonFormatter);
+            startup_timings.Mark("listen");
 
             BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
                                     << logging::add_value(additional_data, log_data::MakeStartServerData(port, address))
                                     << "server started";
 
+            // Восстановление состояния и открытие хранилища идут параллельно, пока потоки io_context
+            // уже принимают соединения. Ошибка любого этапа останавливает сервер
+            std::atomic<bool> startup_failed{false};
+            std::jthread startup_thread([&]{
+                auto run_phase = [&](const std::string& phase, const auto& fn){
+                    try{
+                        startup_timings.Measure(phase, fn);
+                    }catch(const std::exception& e){
+                        LogStartupError(phase + ": "s + e.what());
+                        startup_failed = true;
+                    }
+                };
+                {
+                    std::jthread storage_thread([&]{
+                        run_phase("storage", open_storage);
+                    });
+                    run_phase("restore", [&handler]{
+                        handler->Restore();
+                    });
+                }
+
+                if(startup_failed){
+                    ioc.stop();
+                    return;
+                }
+                net::dispatch(api_strand, [&]{
+                    // хранилище открыто: рекорды из журнала и из spill-файла можно сохранять
+                    record_writer->Start();
+                    start_ticker();
+                    handler->SetReady();
+                    startup_timings.Mark("ready");
+                    BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                            << logging::add_value(additional_data, startup_timings.MakeData())
+                                            << "server ready";
+                });
+            });
+
             // 6. Запускаем обработку асинхронных операций
             RunWorkers(std::max(1u, num_threads), [&ioc] {
                 ioc.run();
             });
+            startup_thread.join();
+
+            // состояние сохраняется, только если оно было полностью восстановлено
+            if(listener && handler->IsReady()){
+                listener->Save(handler->GetGame(), handler->GetPlayers(), handler->GetLostObjects());
+            }
+
+            if(journal){
+                journal->Flush();
+            }
+
+            // дописываем результаты игроков, ушедших перед остановкой
+            record_writer->Stop();
 
-            if(!args->snapshoot_path.empty()){
-                std::filesystem::path temp_path = std::filesystem::weakly_canonical(args->snapshoot_path + "/../temp");
-                std::ofstream temp_file(temp_path, std::ios::binary);
-                serialization::MakeModelSerialize(temp_file, handler->GetGame(), handler->GetPlayers(), handler->GetLostObjects());
-                std::filesystem::rename(temp_path, args->snapshoot_path);
+            if(startup_failed){
+                return EXIT_FAILURE;
             }
         }
     } catch (const std::exception& ex) {
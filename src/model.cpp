@@ -4,6 +4,7 @@
 #include <random>
 #include <ctime>
 #include <chrono>
+#include <ranges>
 
 #include "records.h"
 
@@ -36,6 +37,53 @@ void Map::AddOffice(Office office) {
         offices_.pop_back();
         throw;
     }
+    offices_index_.Insert(index, geom::Point2D(o.GetPosition().x, o.GetPosition().y));
+}
+
+RoadSampler::RoadSampler(const std::vector<Road>& roads)
+    : probability_(roads.size())
+    , alias_(roads.size()) {
+    const size_t count = roads.size();
+    std::vector<double> scaled(count);
+    double total_length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = std::abs(roads[i].GetEnd().x - roads[i].GetStart().x) + std::abs(roads[i].GetEnd().y - roads[i].GetStart().y);
+        total_length += scaled[i];
+    }
+
+    // доли дорог, умноженные на их число: в среднем 1 на ячейку таблицы
+    std::vector<std::uint32_t> small;
+    std::vector<std::uint32_t> large;
+    for (size_t i = 0; i < count; ++i) {
+        // на карте из одних точек все дороги равновероятны
+        scaled[i] = total_length > 0 ? scaled[i] * count / total_length : 1.0;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+    }
+
+    // недостающую часть короткой дороги добирает длинная
+    while (!small.empty() && !large.empty()) {
+        std::uint32_t less = small.back();
+        small.pop_back();
+        std::uint32_t more = large.back();
+        large.pop_back();
+
+        probability_[less] = scaled[less];
+        alias_[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        (scaled[more] < 1.0 ? small : large).push_back(more);
+    }
+    // остаток из-за погрешности округления
+    for (const auto* rest : {&small, &large}) {
+        for (std::uint32_t i : *rest) {
+            probability_[i] = 1.0;
+            alias_[i] = i;
+        }
+    }
+}
+
+size_t RoadSampler::Sample(random_gen::Pcg32& random) const {
+    std::uint32_t cell = random.UniformInt(static_cast<std::uint32_t>(probability_.size()));
+    return random.UniformDouble() < probability_[cell] ? cell : alias_[cell];
 }
 
 void Game::AddMap(Map map) {
@@ -44,6 +92,7 @@ void Game::AddMap(Map map) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
+            map.BuildRoadSampler();
             maps_.emplace_back(std::move(map));
         } catch (...) {
             map_id_to_index_.erase(it);
@@ -54,22 +103,22 @@ void Game::AddMap(Map map) {
 
 namespace generate_coords{
 
-double GenerateRandomDouble(int start, int end){
-    return (std::rand() % ((start - end) * 10) + start * 10) / 10.; 
+// шаг 0.1 от start включительно до end
+double GenerateRandomDouble(int start, int end, random_gen::Pcg32& random){
+    return (random.UniformInt(static_cast<std::uint32_t>(end - start) * 10) + start * 10) / 10.;
 }
 
-model::Coordinates GenerateRandomPointOnMap(const model::Map& map){
-    model::Map::Roads roads = map.GetRoads();
-
-    model::Road road = roads[rand() % roads.size()];
+model::Coordinates GenerateRandomPointOnMap(const model::Map& map, random_gen::Pcg32& random){
+    // точка равномерна по длине дорог: длинная дорога выпадает чаще короткой
+    const model::Road& road = map.GetRoads()[map.GetRoadSampler().Sample(random)];
 
     model::Coordinates coords;
     coords.x = road.GetStart().x == road.GetEnd().x ? 
                                     road.GetStart().x : 
-                                    GenerateRandomDouble(std::min(road.GetStart().x, road.GetEnd().x), std::max(road.GetStart().x, road.GetEnd().x));
+                                    GenerateRandomDouble(std::min(road.GetStart().x, road.GetEnd().x), std::max(road.GetStart().x, road.GetEnd().x), random);
     coords.y = road.GetStart().y == road.GetEnd().y ? 
                                     road.GetStart().y : 
-                                    GenerateRandomDouble(std::min(road.GetStart().y, road.GetEnd().y), std::max(road.GetStart().y, road.GetEnd().y));
+                                    GenerateRandomDouble(std::min(road.GetStart().y, road.GetEnd().y), std::max(road.GetStart().y, road.GetEnd().y), random);
 
     return coords;
 }
@@ -81,17 +130,17 @@ Coordinates Map::CanGoToPoint(const Coordinates& A, const Coordinates& B, model:
         return A;
     }   
 
-    std::vector<Road> includes_roads;
-
-    for(auto road : roads_){
-        if(IsContainsInRoute(road, A)){
-            includes_roads.push_back(road);
-            if(IsContainsInRoute(road, B)){
-                return B;
-            }
+    for(const Road& road : roads_){
+        if(IsContainsInRoute(road, A) && IsContainsInRoute(road, B)){
+            return B;
         }
     }
 
+    // дороги, на которых стоит собака, перебираются повторно, а не копируются в вектор - тик не выделяет память
+    auto includes_roads = roads_ | std::views::filter([this, &A](const Road& road){
+        return IsContainsInRoute(road, A);
+    });
+
     Coordinates coord;
 
     coord.x = A.x;
@@ -99,7 +148,7 @@ Coordinates Map::CanGoToPoint(const Coordinates& A, const Coordinates& B, model:
 
     switch (dir){
     case model::DirectionGeo::NORTH:
-        for(auto road : includes_roads){
+        for(const Road& road : includes_roads){
             if(coord.y > std::min(road.GetStart().y, road.GetEnd().y) - 0.4 &&
                 std::min(road.GetStart().x, road.GetEnd().x) - 0.4 <= coord.x && 
                 coord.x <= std::max(road.GetStart().x, road.GetEnd().x) + 0.4)
@@ -109,7 +158,7 @@ Coordinates Map::CanGoToPoint(const Coordinates& A, const Coordinates& B, model:
         }
         break;
     case model::DirectionGeo::SOUTH:
-        for(auto road : includes_roads){
+        for(const Road& road : includes_roads){
             if(coord.y < std::max(road.GetStart().y, road.GetEnd().y) + 0.4 
                 && std::min(road.GetStart().x, road.GetEnd().x) - 0.4 <= coord.x  
                 && coord.x <= std::max(road.GetStart().x, road.GetEnd().x) + 0.4){
@@ -118,7 +167,7 @@ Coordinates Map::CanGoToPoint(const Coordinates& A, const Coordinates& B, model:
         }
         break;
     case model::DirectionGeo::WEST:
-        for(auto road : includes_roads){
+        for(const Road& road : includes_roads){
             if(coord.x > std::min(road.GetStart().x, road.GetEnd().x) - 0.4 
                 && std::min(road.GetStart().y, road.GetEnd().y) - 0.4 <= coord.y 
                 && coord.y <= std::max(road.GetStart().y, road.GetEnd().y) + 0.4){
@@ -127,7 +176,7 @@ Coordinates Map::CanGoToPoint(const Coordinates& A, const Coordinates& B, model:
         }
         break;
     default:
-        for(auto road : includes_roads){
+        for(const Road& road : includes_roads){
             if(coord.x < std::max(road.GetStart().x, road.GetEnd().x) + 0.4
                 && std::min(road.GetStart().y, road.GetEnd().y) - 0.4 <= coord.y 
                 && coord.y <= std::max(road.GetStart().y, road.GetEnd().y) + 0.4){
@@ -144,64 +193,79 @@ bool Map::IsContainsInRoute(const Road& road, const Coordinates& point) const{
             && (std::min(road.GetStart().y, road.GetEnd().y) - 0.4 <= point.y && point.y <= std::max(road.GetStart().y, road.GetEnd().y) + 0.4);
 }
 
-std::shared_ptr<Dog> GameSession::AddDog(std::string name, int id){
+DogHandle GameSession::AddDog(std::string name, int id){
     Coordinates dog_coord;
     if(is_random_generate_){
-        dog_coord = generate_coords::GenerateRandomPointOnMap(*map_);
+        dog_coord = generate_coords::GenerateRandomPointOnMap(*map_, random_);
     }
-    dogs_.insert(std::pair<int, std::shared_ptr<Dog>>(id, std::make_shared<Dog>(id, name, dog_coord)));
-    return dogs_[id];
+    return AddDog(id, Dog{id, std::move(name), dog_coord});
 }
 
-void GameSession::AddDog(uint64_t id, const Dog& dog){
-    dogs_[id] = std::make_shared<Dog>(dog);
+DogHandle GameSession::AddDog(uint64_t id, const Dog& dog){
+    if(Dog* existing = FindDogById(static_cast<int>(id)); existing != nullptr){
+        *existing = dog;
+        return dog_id_to_handle_.at(static_cast<int>(id));
+    }
+    DogHandle handle = dogs_.Insert(dog);
+    dogs_.Find(handle)->ReserveBag(map_->GetBagCapacity());
+    dog_id_to_handle_[static_cast<int>(id)] = handle;
+    return handle;
 }
 
 std::vector<std::pair<int, std::string>> GameSession::GetPlayersInfo() const{
     std::vector<std::pair<int, std::string>> ids_;
-    for(auto [id, dog] : dogs_){
-        ids_.push_back({id, dog->GetName()});
+    ids_.reserve(dogs_.size());
+    for(const Dog& dog : dogs_){
+        ids_.push_back({dog.GetId(), dog.GetName()});
     }
     return ids_;
 }
 
-std::unordered_map<int, MoveInfo> GameSession::MakeActionsAtTime(int time){
-    std::unordered_map<int, MoveInfo> moves_info;
+const std::vector<MoveInfo>& GameSession::MakeActionsAtTime(int time){
+    moves_.clear();
+    moves_.reserve(dogs_.size());
 
-    for(auto [id, dog] : dogs_){
+    for(Dog& dog : dogs_){
         Coordinates next_pos;
-        next_pos.x = dog->GetCoords().x + dog->GetSpeed().horizontal * (time / 1000.);
-        next_pos.y = dog->GetCoords().y + dog->GetSpeed().vertical * (time / 1000.);
+        next_pos.x = dog.GetCoords().x + dog.GetSpeed().horizontal * (time / 1000.);
+        next_pos.y = dog.GetCoords().y + dog.GetSpeed().vertical * (time / 1000.);
         
-        Coordinates move = map_->CanGoToPoint(dog->GetCoords(), next_pos, dog->GetDir());
-        Coordinates last_pos = dog->GetCoords();
+        Coordinates move = map_->CanGoToPoint(dog.GetCoords(), next_pos, dog.GetDir());
+        Coordinates last_pos = dog.GetCoords();
 
-        if(last_pos == move && !dog->GetChangeDirInTick()){
-            dog->AddAfkTime(time);
+        if(last_pos == move && !dog.GetChangeDirInTick()){
+            dog.AddAfkTime(time);
         }
         else{
-            dog->ClearAfkTime();
+            dog.ClearAfkTime();
         }
 
-        dog->SetChangeDirInTick(false);
-        dog->SetCoords(move);
+        dog.SetChangeDirInTick(false);
+        dog.SetCoords(move);
         if(move != next_pos){
-            dog->SetSpeed(Speed{0, 0});
+            dog.SetSpeed(Speed{0, 0});
         }
 
-        dog->AddPlayTime(time);
-        moves_info[dog->GetId()] = {last_pos, next_pos};
+        dog.AddPlayTime(time);
+        moves_.push_back({last_pos, next_pos});
     }
 
-    return moves_info;
+    return moves_;
 }
 
-void GameSession::EraseDogsById(std::vector<int> dogs_id, std::vector<domain::Record>& records){
-    for(int dog_id : dogs_id){
-        auto dog = dogs_[dog_id];
-        records.push_back(domain::Record{domain::RecordId::New(), dog->GetName(), dog->GetScore(), dog->GetPlayTime()});
-        dogs_.erase(dog_id);
+bool GameSession::EraseDog(DogHandle handle, std::vector<domain::Record>& records){
+    const Dog* dog = dogs_.Find(handle);
+    if(dog == nullptr){
+        return false;
     }
+    records.push_back(domain::Record{domain::RecordId::New(), dog->GetName(), dog->GetScore(), dog->GetPlayTime()});
+    dog_id_to_handle_.erase(dog->GetId());
+    dogs_.Erase(handle);
+    return true;
+}
+
+void GameSession::SeedRandom(std::uint32_t tick_seed){
+    random_.Seed(tick_seed, random_gen::MakeStream(GetMapId()));
 }
 
 const Map* Game::FindMap(const Map::Id& id) const noexcept {
@@ -211,35 +275,63 @@ const Map* Game::FindMap(const Map::Id& id) const noexcept {
     return nullptr;
 }
 
-void Game::AddGameSession(GameSession&& game_sessoion){
-    game_sessions_.push_back(std::make_shared<GameSession>(std::move(game_sessoion)));
-    game_session_to_map_id_[Map::Id(game_sessoion.GetMapId())] = game_sessions_.size() - 1;
+model::GameSession* Game::AddGameSession(GameSession&& game_sessoion){
+    Map::Id map_id{game_sessoion.GetMapId()};
+    GameSessionHandle handle = game_sessions_.Insert(std::move(game_sessoion));
+    GameSession* game_session = game_sessions_.Find(handle);
+    game_session->SetHandle(handle);
+    // до первого тика собаки появляются по seed'у последнего тика
+    game_session->SeedRandom(tick_seed_);
+    game_session_to_map_id_[std::move(map_id)] = handle;
+    return game_session;
 }
 
 model::GameSession* Game::AddGameSession(std::string map_id){
     Map::Id map_id_{map_id};
-    std::shared_ptr<model::GameSession> game_session = std::make_shared<model::GameSession>(FindMapForGameSession(map_id_), is_random_generate_);
-    game_sessions_.push_back(game_session);
-    game_session_to_map_id_[map_id_] = game_sessions_.size() - 1;
-    return &*game_sessions_.back();
+    return AddGameSession(GameSession{FindMapForGameSession(map_id_), is_random_generate_});
+}
+
+model::GameSession* Game::FindGameSessionFromMapId(const Map::Id& id){
+    if (auto it = game_session_to_map_id_.find(id); it != game_session_to_map_id_.end()) {
+        return game_sessions_.Find(it->second);
+    }
+    return nullptr;
 }
 
-model::GameSession* Game::FindGameSessionFromMapId(const Map::Id& id) const{
+const model::GameSession* Game::FindGameSessionFromMapId(const Map::Id& id) const{
     if (auto it = game_session_to_map_id_.find(id); it != game_session_to_map_id_.end()) {
-        return &*game_sessions_.at(it->second);
+        return game_sessions_.Find(it->second);
     }
     return nullptr;
 }
 
-MapIdToMovesInfo Game::MakeActionsAtTime(int time){
-    MapIdToMovesInfo map_id_to_moves_info;
+std::uint32_t Game::NextTickSeed(){
+    std::uint32_t seed = seed_generator_();
+    SeedSessions(seed);
+    return seed;
+}
 
-    for(auto game_session : game_sessions_){
-        std::unordered_map<int, MoveInfo> moves_info = game_session->MakeActionsAtTime(time);
-        map_id_to_moves_info[Map::Id(game_session->GetMapId())] = moves_info;
+void Game::UseTickSeed(std::uint32_t seed){
+    seed_generator_();
+    SeedSessions(seed);
+}
+
+void Game::SeedSessions(std::uint32_t seed){
+    tick_seed_ = seed;
+    for(GameSession& game_session : game_sessions_){
+        game_session.SeedRandom(seed);
     }
+}
+
+const SessionsMovesInfo& Game::MakeActionsAtTime(int time){
+    sessions_moves_.clear();
+    sessions_moves_.reserve(game_sessions_.size());
 
-    return map_id_to_moves_info;
+    for(GameSession& game_session : game_sessions_){
+        sessions_moves_.push_back(SessionMoves{game_session.GetHandle(), game_session.MakeActionsAtTime(time)});
+    }
+
+    return sessions_moves_;
 }
 
 Map* Game::FindMapForGameSession(const Map::Id& id){
@@ -249,12 +341,14 @@ Map* Game::FindMapForGameSession(const Map::Id& id){
     return nullptr;
 }
 
-std::vector<domain::Record> Game::EraseRetiredDogs(std::unordered_map<std::string, std::vector<int>> dogs_id){
+std::vector<domain::Record> Game::EraseRetiredDogs(const std::vector<DogRef>& dogs){
     std::vector<domain::Record> records_res;
+    records_res.reserve(dogs.size());
 
-    for(auto [map_id, dogs_id_on_map] : dogs_id){
-        auto game_session_ = FindGameSessionFromMapId(model::Map::Id(map_id));
-        game_session_->EraseDogsById(dogs_id_on_map, records_res);
+    for(const DogRef& ref : dogs){
+        if(GameSession* game_session = game_sessions_.Find(ref.session); game_session != nullptr){
+            game_session->EraseDog(ref.dog, records_res);
+        }
     }
 
     return records_res;
@@ -5,10 +5,13 @@
 #include <map>
 #include <optional>
 #include <memory>
+#include <span>
 
 #include "tagged.h"
+#include "slot_map.h"
 #include "collision_detector.h"
 #include "records.h"
+#include "random_gen.h"
 
 namespace model {
 
@@ -169,6 +172,27 @@ private:
     Offset offset_;
 };
 
+/*
+ * Выбор дороги с вероятностью, пропорциональной ее длине (alias-метод Уолкера).
+ * Таблица строится один раз при добавлении карты в игру, выбор стоит O(1) и не выделяет память.
+ */
+class RoadSampler {
+public:
+    RoadSampler() = default;
+    explicit RoadSampler(const std::vector<Road>& roads);
+
+    // индекс в roads, по которым построена таблица
+    size_t Sample(random_gen::Pcg32& random) const;
+
+    bool IsEmpty() const noexcept {
+        return probability_.empty();
+    }
+
+private:
+    std::vector<double> probability_;
+    std::vector<std::uint32_t> alias_;
+};
+
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
@@ -203,6 +227,20 @@ public:
         return offices_;
     }
 
+    // офисы не двигаются, хеш строится при загрузке карты; номер в хеше - индекс в GetOffices()
+    const collision_detector::SpatialHash& GetOfficesIndex() const noexcept {
+        return offices_index_;
+    }
+
+    // строится в Game::AddMap, когда дорог больше не добавляется
+    const RoadSampler& GetRoadSampler() const noexcept {
+        return road_sampler_;
+    }
+
+    void BuildRoadSampler() {
+        road_sampler_ = RoadSampler{roads_};
+    }
+
     double GetDogSpeed() const noexcept{
         return dog_speed_;
     }
@@ -211,6 +249,15 @@ public:
         return bag_capacity_;
     }
 
+    // 0 - /state отдает всю сессию, иначе только собак и трофеи в этом радиусе от игрока
+    double GetViewRadius() const noexcept{
+        return view_radius_;
+    }
+
+    void SetViewRadius(double view_radius) noexcept{
+        view_radius_ = view_radius;
+    }
+
     void AddRoad(const Road& road) {
         roads_.emplace_back(road);
     }
@@ -235,9 +282,12 @@ private:
 
     double dog_speed_;
     int bag_capacity_;
+    double view_radius_ = 0;
 
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
+    collision_detector::SpatialHash offices_index_;
+    RoadSampler road_sampler_;
 };
 
 class Dog{ 
@@ -306,6 +356,11 @@ public:
         bag_.clear();
     }
 
+    // рюкзак занимает память один раз при входе, а не при подборе предметов
+    void ReserveBag(size_t capacity){
+        bag_.reserve(capacity);
+    }
+
     int GetAfkTime() const{
         return afk_time_;
     }
@@ -349,22 +404,36 @@ private:
 
 namespace generate_coords{
 
-double GenerateRandomDouble(int start, int end);
-Coordinates GenerateRandomPointOnMap(const Map& map);
+double GenerateRandomDouble(int start, int end, random_gen::Pcg32& random);
+Coordinates GenerateRandomPointOnMap(const Map& map, random_gen::Pcg32& random);
 
 } // generate_coords
 
+struct DogTag{};
+using DogHandle = util::Handle<DogTag>;
+
+struct GameSessionTag{};
+using GameSessionHandle = util::Handle<GameSessionTag>;
+
+// собака конкретной сессии
+struct DogRef{
+    GameSessionHandle session;
+    DogHandle dog;
+};
+
 class GameSession{
 public:
     using PlayerInfo = std::vector<std::pair<int, std::string>>;
+    using Dogs = util::SlotMap<Dog, DogTag>;
 
     GameSession(const Map* map, bool is_random_generate) : map_(map), is_random_generate_(is_random_generate){}
 
-    std::shared_ptr<Dog> AddDog(std::string name, int id);
+    DogHandle AddDog(std::string name, int id);
     
-    void AddDog(uint64_t id, const Dog& dog);
+    // собака с тем же id заменяется
+    DogHandle AddDog(uint64_t id, const Dog& dog);
 
-    std::string GetMapId() const{
+    const std::string& GetMapId() const{
         return *(map_->GetId());
     }
 
@@ -374,10 +443,39 @@ public:
     
     std::vector<std::pair<int, std::string>> GetPlayersInfo() const;
 
-    const std::unordered_map<std::uint64_t, std::shared_ptr<Dog>>& GetDogs() const{
+    // собаки в порядке обхода, он же порядок MakeActionsAtTime
+    const Dogs& GetDogs() const{
+        return dogs_;
+    }
+
+    Dogs& GetDogs(){
         return dogs_;
     }
 
+    Dog* FindDog(DogHandle handle){
+        return dogs_.Find(handle);
+    }
+
+    const Dog* FindDog(DogHandle handle) const{
+        return dogs_.Find(handle);
+    }
+
+    // пустой Handle, если собаки нет
+    DogHandle FindDogHandle(int id) const{
+        if(auto it = dog_id_to_handle_.find(id); it != dog_id_to_handle_.end()){
+            return it->second;
+        }
+        return DogHandle{};
+    }
+
+    Dog* FindDogById(int id){
+        return dogs_.Find(FindDogHandle(id));
+    }
+
+    const Dog* FindDogById(int id) const{
+        return dogs_.Find(FindDogHandle(id));
+    }
+
     int GetDogsCount() const {
         return dogs_.size();
     }
@@ -390,21 +488,52 @@ public:
         return map_;
     }
 
-    std::unordered_map<int, MoveInfo> MakeActionsAtTime(int time);
+    // назначается Game при добавлении сессии
+    GameSessionHandle GetHandle() const{
+        return handle_;
+    }
+
+    void SetHandle(GameSessionHandle handle){
+        handle_ = handle;
+    }
+
+    // генератор сессии: точки появления собак и трофеев
+    random_gen::Pcg32& GetRandom(){
+        return random_;
+    }
+
+    // у каждой карты свой поток, поэтому сессии с одним seed'ом тика не повторяют друг друга
+    void SeedRandom(std::uint32_t tick_seed);
+
+    // Перемещения собак в порядке GetDogs(). Буфер сессии переиспользуется,
+    // ссылка действительна до следующего вызова
+    const std::vector<MoveInfo>& MakeActionsAtTime(int time);
 
-    void EraseDogsById(std::vector<int> dogs_id, std::vector<domain::Record>& records);
+    // false, если собаки уже нет
+    bool EraseDog(DogHandle handle, std::vector<domain::Record>& records);
     
 private:
     bool is_random_generate_;
     const Map* map_;
-    std::unordered_map<std::uint64_t, std::shared_ptr<Dog>> dogs_;
+    GameSessionHandle handle_;
+    Dogs dogs_;
+    std::unordered_map<int, DogHandle> dog_id_to_handle_;
+    std::vector<MoveInfo> moves_;
+    random_gen::Pcg32 random_;
 };
 
-using MapIdToMovesInfo = std::unordered_map<Map::Id, std::unordered_map<int, MoveInfo>, util::TaggedHasher<Map::Id>>;
+// moves смотрит в буфер сессии и действителен до следующего тика
+struct SessionMoves{
+    GameSessionHandle session;
+    std::span<const MoveInfo> moves;
+};
+
+using SessionsMovesInfo = std::vector<SessionMoves>;
 
 class Game {
 public:
     using Maps = std::vector<Map>;
+    using GameSessions = util::SlotMap<GameSession, GameSessionTag>;
     Game() = default;
 
     void AddMap(Map map);
@@ -415,36 +544,84 @@ public:
 
     const Map* FindMap(const Map::Id& id) const noexcept;
 
-    void AddGameSession(GameSession&& game_sessoion);
+    // Указатели на сессии действительны до добавления следующей сессии, дольше хранятся GameSessionHandle
+    model::GameSession* AddGameSession(GameSession&& game_sessoion);
     model::GameSession* AddGameSession(std::string map_id);
 
-    model::GameSession* FindGameSessionFromMapId(const Map::Id& id) const;
+    model::GameSession* FindGameSessionFromMapId(const Map::Id& id);
+    const model::GameSession* FindGameSessionFromMapId(const Map::Id& id) const;
+
+    model::GameSession* FindGameSession(GameSessionHandle handle){
+        return game_sessions_.Find(handle);
+    }
+
+    const model::GameSession* FindGameSession(GameSessionHandle handle) const{
+        return game_sessions_.Find(handle);
+    }
+
+    Dog* FindDog(const DogRef& ref){
+        GameSession* game_session = game_sessions_.Find(ref.session);
+        return game_session != nullptr ? game_session->FindDog(ref.dog) : nullptr;
+    }
+
+    const Dog* FindDog(const DogRef& ref) const{
+        const GameSession* game_session = game_sessions_.Find(ref.session);
+        return game_session != nullptr ? game_session->FindDog(ref.dog) : nullptr;
+    }
 
-    const std::vector<std::shared_ptr<GameSession>>& GetGameSession() const{
+    const GameSessions& GetGameSession() const{
         return game_sessions_;
     }
 
-    MapIdToMovesInfo MakeActionsAtTime(int time = 1);
+    // результат живет в буфере игры до следующего вызова
+    const SessionsMovesInfo& MakeActionsAtTime(int time = 1);
 
     void SetRandomGenerate(bool is_random_generate){
         is_random_generate_ = is_random_generate;
     }
 
+    bool IsRandomGenerate() const{
+        return is_random_generate_;
+    }
+
+    // Seed генератора seed'ов тиков, задается при запуске
+    void SetRandomSeed(std::uint64_t seed){
+        seed_generator_.Seed(seed);
+    }
+
+    // состояние генератора хранится в снимке, после восстановления тики продолжают ту же последовательность
+    random_gen::Pcg32::State GetRandomState() const{
+        return seed_generator_.GetState();
+    }
+
+    void SetRandomState(random_gen::Pcg32::State state){
+        seed_generator_.SetState(state);
+    }
+
+    // seed очередного тика, им заново инициализируются генераторы всех сессий
+    std::uint32_t NextTickSeed();
+    // seed из журнала: генератор сдвигается так же, как при живом тике
+    void UseTickSeed(std::uint32_t seed);
+
     // возвращает результаты удаленных игроков
-    std::vector<domain::Record> EraseRetiredDogs(std::unordered_map<std::string, std::vector<int>> dogs_id);
+    std::vector<domain::Record> EraseRetiredDogs(const std::vector<DogRef>& dogs);
 
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
-    using GameSessionMapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
+    using GameSessionMapIdToHandle = std::unordered_map<Map::Id, GameSessionHandle, MapIdHasher>;
 
     Map* FindMapForGameSession(const Map::Id& id);
+    void SeedSessions(std::uint32_t seed);
 
     bool is_random_generate_;
     Maps maps_;
-    std::vector<std::shared_ptr<model::GameSession>> game_sessions_;
+    GameSessions game_sessions_;
     MapIdToIndex map_id_to_index_;
-    GameSessionMapIdToIndex game_session_to_map_id_;
+    GameSessionMapIdToHandle game_session_to_map_id_;
+    SessionsMovesInfo sessions_moves_;
+    random_gen::Pcg32 seed_generator_;
+    std::uint32_t tick_seed_ = 0;
 };
 
 }  // namespace model
@@ -1,6 +1,15 @@
+#pragma once
+
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <istream>
+#include <span>
+#include <stdexcept>
 
 #include "model.h"
 #include "player.h"
@@ -30,6 +39,96 @@ void serialize(Archive& ar, Speed& speed, [[maybe_unused]] const unsigned versio
 
 namespace serialization {
 
+// Плоская копия состояния игры. Снимается на strand'е без построения Repr-объектов,
+// а кодируется и пишется в файл уже в фоне
+struct DogState{
+    int id = 0;
+    std::string name;
+    model::Coordinates pos;
+    model::Speed speed;
+    model::DirectionGeo direction = model::DirectionGeo::NORTH;
+    int score = 0;
+    int afk_time = 0;
+    int play_time = 0;
+    // предметы собаки - отрезок StateSnapshot::bag_items
+    size_t bag_begin = 0;
+    size_t bag_size = 0;
+};
+
+struct SessionState{
+    std::string map_id;
+    // собаки сессии - отрезок StateSnapshot::dogs
+    size_t dogs_begin = 0;
+    size_t dogs_count = 0;
+};
+
+struct PlayerState{
+    std::string map_id;
+    int player_id = 0;
+    int dog_id = 0;
+    players::Token token;
+};
+
+struct LostObjectsState{
+    std::string map_id;
+    std::vector<extra_data::LostObject> objects;
+};
+
+struct StateSnapshot{
+    std::vector<SessionState> sessions;
+    std::vector<DogState> dogs;
+    std::vector<model::CollectedItem> bag_items;
+    std::vector<PlayerState> players;
+    int next_player_id = 0;
+    std::vector<LostObjectsState> lost_objects;
+    unsigned next_loot_id = 0;
+    std::chrono::milliseconds time_without_loot{0};
+    // генератор seed'ов тиков, пустое состояние - в снимке его нет
+    random_gen::Pcg32::State random;
+    // первый сегмент журнала с событиями после снимка, 0 - журнал не ведется
+    std::uint64_t journal_segment = 0;
+};
+
+inline StateSnapshot CaptureState(const model::Game& game
+                                , const players::Players& players
+                                , const extra_data::LostObjectsOnMaps& lost_objects_on_map){
+    StateSnapshot snapshot;
+
+    size_t dogs_count = 0;
+    for(const auto& game_session : game.GetGameSession()){
+        dogs_count += game_session.GetDogs().size();
+    }
+    snapshot.sessions.reserve(game.GetGameSession().size());
+    snapshot.dogs.reserve(dogs_count);
+
+    for(const auto& game_session : game.GetGameSession()){
+        snapshot.sessions.push_back(SessionState{game_session.GetMapId(), snapshot.dogs.size(), game_session.GetDogs().size()});
+        for(const auto& dog : game_session.GetDogs()){
+            const auto& bag = dog.GetBag();
+            snapshot.dogs.push_back(DogState{dog.GetId(), dog.GetName(), dog.GetCoords(), dog.GetSpeed(), dog.GetDir()
+                                           , dog.GetScore(), dog.GetAfkTime(), dog.GetPlayTime()
+                                           , snapshot.bag_items.size(), bag.size()});
+            snapshot.bag_items.insert(snapshot.bag_items.end(), bag.begin(), bag.end());
+        }
+    }
+
+    snapshot.players.reserve(players.GetPlayers().size());
+    for(const auto& player : players.GetPlayers()){
+        snapshot.players.push_back(PlayerState{player.GetMapId(), player.GetPlayerId(), player.GetId(), player.GetToken()});
+    }
+    snapshot.next_player_id = players.GetNextId();
+
+    snapshot.lost_objects.reserve(lost_objects_on_map.GetLostObjectsOnMaps().size());
+    for(const auto& [map_id, objects] : lost_objects_on_map.GetLostObjectsOnMaps()){
+        snapshot.lost_objects.push_back(LostObjectsState{map_id, {objects.GetObjects().begin(), objects.GetObjects().end()}});
+    }
+    snapshot.next_loot_id = lost_objects_on_map.GetPossibleLoot().GetNextId();
+    snapshot.time_without_loot = lost_objects_on_map.GetPossibleLoot().GetTimeWithoutLoot();
+    snapshot.random = game.GetRandomState();
+
+    return snapshot;
+}
+
 // DogRepr (DogRepresentation) - сериализованное представление класса Dog
 class DogRepr {
 public:
@@ -45,6 +144,16 @@ public:
         , bag_(dog.GetBag()) {
     }
 
+    DogRepr(const DogState& dog, std::span<const model::CollectedItem> bag)
+        : id_(dog.id)
+        , name_(dog.name)
+        , pos_(dog.pos)
+        , speed_(dog.speed)
+        , direction_(dog.direction)
+        , score_(dog.score)
+        , bag_(bag.begin(), bag.end()) {
+    }
+
     [[nodiscard]] model::Dog Restore() const {
         model::Dog dog{id_, name_, pos_};
         dog.SetSpeed(speed_);
@@ -56,6 +165,12 @@ public:
         return dog;
     }
 
+    void AppendTo(StateSnapshot& snapshot) const {
+        snapshot.dogs.push_back(DogState{id_, name_, pos_, speed_, direction_, score_, 0, 0
+                                       , snapshot.bag_items.size(), bag_.size()});
+        snapshot.bag_items.insert(snapshot.bag_items.end(), bag_.begin(), bag_.end());
+    }
+
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
         ar& id_;
@@ -83,8 +198,16 @@ public:
 
     explicit GameSessionRepr(const model::GameSession& game_session) 
         : map_id_(game_session.GetMapId()){
-        for(auto [id, dog] : game_session.GetDogs()){
-            dogs_[id] = DogRepr{*dog};
+        for(const auto& dog : game_session.GetDogs()){
+            dogs_[dog.GetId()] = DogRepr{dog};
+        }
+    }
+
+    GameSessionRepr(const StateSnapshot& snapshot, const SessionState& session)
+        : map_id_(session.map_id){
+        for(size_t i = session.dogs_begin; i < session.dogs_begin + session.dogs_count; ++i){
+            const DogState& dog = snapshot.dogs[i];
+            dogs_[dog.id] = DogRepr{dog, std::span{snapshot.bag_items}.subspan(dog.bag_begin, dog.bag_size)};
         }
     }
 
@@ -96,6 +219,13 @@ public:
         return game_session;
     }
 
+    void AppendTo(StateSnapshot& snapshot) const{
+        snapshot.sessions.push_back(SessionState{map_id_, snapshot.dogs.size(), dogs_.size()});
+        for(const auto& [id, dog] : dogs_){
+            dog.AppendTo(snapshot);
+        }
+    }
+
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version){
         ar& map_id_;
@@ -115,17 +245,34 @@ public:
     explicit PlayerRepr(const players::Player& player) 
         : map_id_(player.GetMapId())
         , dog_id_(player.GetId())
-        , token_(*player.GetToken()){
+        , token_(player.GetToken().ToString()){
+    }
+
+    explicit PlayerRepr(const PlayerState& player)
+        : map_id_(player.map_id)
+        , dog_id_(player.dog_id)
+        , token_(player.token.ToString()){
+    }
+
+    players::Player* Restore(const model::Game& game, int player_id, players::Players& players) const{
+        const model::GameSession* game_session = game.FindGameSessionFromMapId(model::Map::Id{map_id_});
+        if(game_session == nullptr || game_session->FindDogById(dog_id_) == nullptr){
+            throw std::runtime_error("player without dog in snapshot");
+        }
+        return players.AddPlayer(GetToken(), player_id, *game_session, dog_id_);
     }
 
-    [[nodiscard]] players::Player Restore(const model::Game& game){
-        model::GameSession* game_session = game.FindGameSessionFromMapId(model::Map::Id{map_id_});
-        players::Player player{game_session, game_session->GetDogs().at(dog_id_), players::Token{token_}};
-        return player;
+    // в архиве токен хранится строкой, как его видит клиент
+    players::Token GetToken() const{
+        auto token = players::Token::Parse(token_);
+        if(!token){
+            throw std::runtime_error("invalid player token in snapshot");
+        }
+        return *token;
     }
 
-    std::string GetToken() const{
-        return token_;
+    PlayerState ToState(int player_id) const{
+        return PlayerState{map_id_, player_id, dog_id_, GetToken()};
     }
 
     template <typename Archive>
@@ -146,21 +293,27 @@ public:
 
     PlayersRepr() = default;
 
-    explicit PlayersRepr(const players::Players& players) {
-        for(auto [map_id, players_on_map] : players.GetPlayers()){
-            for(auto [player_id, player] : players_on_map){
-                players_[map_id][player_id] = PlayerRepr{*player};
-                ++next_id;
-            }
+    // next_id - это следующий id собаки, а не число игроков: после ухода игроков они расходятся
+    explicit PlayersRepr(const players::Players& players)
+        : next_id(players.GetNextId()){
+        for(const auto& player : players.GetPlayers()){
+            players_[player.GetMapId()][player.GetPlayerId()] = PlayerRepr{player};
+        }
+    }
+
+    explicit PlayersRepr(const StateSnapshot& snapshot)
+        : next_id(snapshot.next_player_id){
+        for(const auto& player : snapshot.players){
+            players_[player.map_id][player.player_id] = PlayerRepr{player};
         }
     }
 
     [[nodiscard]] players::Players Restore(const model::Game& game){
         players::Players players;
 
-        for(auto [map_id, players_on_map] : players_){
-            for(auto [player_id, player] : players_on_map){
-                players.AddPlayer(map_id, player.GetToken(), player_id, player.Restore(game));
+        for(const auto& [map_id, players_on_map] : players_){
+            for(const auto& [player_id, player] : players_on_map){
+                player.Restore(game, player_id, players);
             }
         }
 
@@ -169,6 +322,15 @@ public:
         return players;
     }
 
+    void AppendTo(StateSnapshot& snapshot) const{
+        for(const auto& [map_id, players_on_map] : players_){
+            for(const auto& [player_id, player] : players_on_map){
+                snapshot.players.push_back(player.ToState(player_id));
+            }
+        }
+        snapshot.next_player_id = next_id;
+    }
+
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version){
         ar& players_;
@@ -190,7 +352,7 @@ public:
         , coords_(lost_obj.coords){
     }
 
-    [[nodiscard]] extra_data::LostObject Restore(){
+    [[nodiscard]] extra_data::LostObject Restore() const{
         return extra_data::LostObject{id_, type_, coords_};
     }
 
@@ -207,33 +369,84 @@ private:
     model::Coordinates coords_;
 };
 
+// Снимок в старом формате boost::archive (до snapshot_file). Остался для чтения
+// старых файлов и их перевода в новый формат
 template <typename Output>
-Output& MakeModelSerialize(Output& output
-                , const model::Game& game
-                , const players::Players& players
-                , const extra_data::LostObjectsOnMaps& lost_objects_on_map){
+Output& WriteStateSnapshot(Output& output, const StateSnapshot& snapshot){
     boost::archive::binary_oarchive ar{output};
 
     std::vector<serialization::GameSessionRepr> game_sessions_repr;
-    for(auto game_session : game.GetGameSession()){
-        game_sessions_repr.push_back(serialization::GameSessionRepr{*game_session});
+    game_sessions_repr.reserve(snapshot.sessions.size());
+    for(const auto& session : snapshot.sessions){
+        game_sessions_repr.push_back(serialization::GameSessionRepr{snapshot, session});
     }
 
-    serialization::PlayersRepr players_repr{players};
-    std::unordered_map<std::string, std::vector<extra_data::LostObject>> lost_objects = lost_objects_on_map.GetLostObjectsOnMaps();
+    serialization::PlayersRepr players_repr{snapshot};
+
     std::unordered_map<std::string, std::vector<serialization::LostObjectRepr>> lost_objects_repr;
-    for(auto [map_id, lost_obj] : lost_objects){
-        lost_objects_repr[map_id] = {};
-        for(auto object : lost_obj){
-            lost_objects_repr[map_id].push_back(LostObjectRepr{object});
+    for(const auto& [map_id, objects] : snapshot.lost_objects){
+        auto& objects_repr = lost_objects_repr[map_id];
+        objects_repr.reserve(objects.size());
+        for(const auto& object : objects){
+            objects_repr.push_back(LostObjectRepr{object});
         }
     }
 
     ar << game_sessions_repr;
     ar << players_repr;
     ar << lost_objects_repr;
+    // пишется последним: в файлах старых версий его просто нет
+    ar << snapshot.journal_segment;
 
     return output;
 }
 
+inline StateSnapshot ReadLegacyStateSnapshot(std::istream& input){
+    boost::archive::binary_iarchive ar{input};
+
+    std::vector<GameSessionRepr> game_sessions_repr;
+    PlayersRepr players_repr;
+    std::unordered_map<std::string, std::vector<LostObjectRepr>> lost_objects_repr;
+
+    ar >> game_sessions_repr;
+    ar >> players_repr;
+    ar >> lost_objects_repr;
+
+    StateSnapshot snapshot;
+    try{
+        ar >> snapshot.journal_segment;
+    }catch(const boost::archive::archive_exception&){
+        // снимок записан до появления журнала
+        snapshot.journal_segment = 0;
+    }
+
+    for(const auto& game_session_repr : game_sessions_repr){
+        game_session_repr.AppendTo(snapshot);
+    }
+    players_repr.AppendTo(snapshot);
+
+    // старый формат не хранил следующий id трофея: берем больше всех известных
+    for(const auto& item : snapshot.bag_items){
+        snapshot.next_loot_id = std::max(snapshot.next_loot_id, item.id + 1);
+    }
+    for(const auto& [map_id, objects_repr] : lost_objects_repr){
+        LostObjectsState lost_objects{map_id, {}};
+        for(const auto& object : objects_repr){
+            lost_objects.objects.push_back(object.Restore());
+            snapshot.next_loot_id = std::max(snapshot.next_loot_id, lost_objects.objects.back().id + 1);
+        }
+        snapshot.lost_objects.push_back(std::move(lost_objects));
+    }
+
+    return snapshot;
+}
+
+template <typename Output>
+Output& MakeModelSerialize(Output& output
+                , const model::Game& game
+                , const players::Players& players
+                , const extra_data::LostObjectsOnMaps& lost_objects_on_map){
+    return WriteStateSnapshot(output, CaptureState(game, players, lost_objects_on_map));
+}
+
 }  // namespace serialization
@@ -1,91 +1,104 @@
 #include "objects_collector.h"
-#include <set>
+#include <algorithm>
+#include <span>
 
 namespace objects_collector{
 
-struct Events{
-    std::vector<GatheringEvent> items_events;
-    std::vector<GatheringEvent> offices_events;
-};
-
-Events GetEventsOnMap(const std::vector<model::Office>& offices_on_map, 
-                                           const std::vector<extra_data::LostObject>& lost_objects, 
-                                           const std::unordered_map<int, model::MoveInfo>& moves_info){
-    std::vector<Gatherer> players;
-    for(auto [id, move_info] : moves_info){
-        players.push_back({geom::Point2D(move_info.start.x, move_info.start.y), geom::Point2D(move_info.end.x, move_info.end.y), 0.6});
+using namespace collision_detector;
+
+void FillEventsOnMap(const model::Map& map, 
+                     const extra_data::LostObjectsOnMaps& lost_objects_on_maps, 
+                     std::span<const model::MoveInfo> moves_info,
+                     CollectorBuffers& buffers){
+    const std::string& map_id = *map.GetId();
+    const extra_data::Loot& lost_objects = lost_objects_on_maps.GetLostObjects(map_id);
+
+    // Трофеев на карте не больше, чем собак, а событий - не больше пар предмет-собака.
+    // Запас под эти пределы берется сразу, и буферы растут только при входе игроков
+    size_t items_bound = std::max(lost_objects.size(), moves_info.size());
+    buffers.items_events.reserve(items_bound * moves_info.size());
+    buffers.offices_events.reserve(map.GetOffices().size() * moves_info.size());
+    buffers.is_collected.reserve(items_bound);
+    buffers.collected_items.reserve(items_bound);
+
+    buffers.gatherers.clear();
+    for(const auto& move_info : moves_info){
+        buffers.gatherers.push_back({geom::Point2D(move_info.start.x, move_info.start.y), geom::Point2D(move_info.end.x, move_info.end.y), 0.6});
     }
 
-    std::vector<Item> items;
-    for(auto lost_obj : lost_objects){
-        items.push_back({geom::Point2D(lost_obj.coords.x, lost_obj.coords.y), 0});
-    }
-
-    std::vector<Item> offices;
-    for(auto office : offices_on_map){
-        offices.push_back(Item(geom::Point2D(office.GetPosition().x, office.GetPosition().y), 0.5));
-    }
-
-    ItemPlayersProvider items_players_provider{items, players};
-    ItemPlayersProvider offices_players_provider{offices, players};
-
-    return {FindGatherEvents(items_players_provider),
-            FindGatherEvents(offices_players_provider)};
+    // трофеи и офисы уже лежат в пространственных хешах карты, проверяются только ячейки вдоль путей собак
+    FindGatherEvents(lost_objects_on_maps.GetLostObjectsIndex(map_id), buffers.gatherers, buffers.items_events);
+    FindGatherEvents(map.GetOfficesIndex(), buffers.gatherers, buffers.offices_events);
 }
 
-void CollectObjects(model::Game& game, extra_data::LostObjectsOnMaps& lost_objects_on_maps, const model::MapIdToMovesInfo& map_id_to_moves){
-    for(auto [map_id, moves_info] : map_id_to_moves){
-        Events events_on_map = GetEventsOnMap(game.FindMap(map_id)->GetOffices(), lost_objects_on_maps.GetLostObjects(*map_id), moves_info);
+void CollectObjects(model::Game& game, extra_data::LostObjectsOnMaps& lost_objects_on_maps, const model::SessionsMovesInfo& sessions_moves
+                  , CollectorBuffers& buffers){
+    for(const auto& [session_handle, moves_info] : sessions_moves){
+        model::GameSession* game_session = game.FindGameSession(session_handle);
+        if(game_session == nullptr){
+            continue;
+        }
+        const model::Map::Id& map_id = game_session->GetMap()->GetId();
+        FillEventsOnMap(*game_session->GetMap(), lost_objects_on_maps, moves_info, buffers);
+        const auto& items_events = buffers.items_events;
+        const auto& offices_events = buffers.offices_events;
 
-        auto dogs = game.FindGameSessionFromMapId(map_id)->GetDogs();
-        const std::vector<extra_data::LostObject>& lost_objects = lost_objects_on_maps.GetLostObjects(*map_id);
+        // gatherer_id - позиция собаки в GetDogs(), в том же порядке идут moves_info
+        auto& dogs = game_session->GetDogs();
+        const extra_data::Loot& lost_objects = lost_objects_on_maps.GetLostObjects(*map_id);
 
         // для проверки был ли данный предмет поднят ранее
-        std::set<int> collected_items;
+        buffers.is_collected.assign(lost_objects.size(), 0);
 
-        for(auto item_event_index = 0, office_event_index = 0; item_event_index < events_on_map.items_events.size() || office_event_index < events_on_map.offices_events.size();){
-            if(item_event_index < events_on_map.items_events.size()){
-                if(office_event_index < events_on_map.offices_events.size()){
-                    if(events_on_map.items_events[item_event_index].time > events_on_map.offices_events[office_event_index].time){
-                        GatheringEvent base_event = events_on_map.offices_events[office_event_index];
-                        auto dog = std::next(dogs.begin(), base_event.gatherer_id)->second;
+        for(auto item_event_index = 0, office_event_index = 0; item_event_index < items_events.size() || office_event_index < offices_events.size();){
+            if(item_event_index < items_events.size()){
+                if(office_event_index < offices_events.size()){
+                    if(items_events[item_event_index].time > offices_events[office_event_index].time){
+                        GatheringEvent base_event = offices_events[office_event_index];
+                        model::Dog& dog = dogs[base_event.gatherer_id];
 
-                        for(auto items_in_bag : dog->GetBag()){
-                            dog->AddScore(lost_objects_on_maps.GetObjectValue(*map_id, items_in_bag.type));
+                        for(auto items_in_bag : dog.GetBag()){
+                            dog.AddScore(lost_objects_on_maps.GetObjectValue(*map_id, items_in_bag.type));
                         }
-                        dog->ClearBag();
+                        dog.ClearBag();
 
                         ++office_event_index;
                         continue;
                     }
                 }
 
-                GatheringEvent collect_event = events_on_map.items_events[item_event_index];
+                GatheringEvent collect_event = items_events[item_event_index];
 
-                if(!collected_items.contains(collect_event.item_id) 
-                    && std::next(dogs.begin(), collect_event.gatherer_id)->second->GetBagSize() < game.FindMap(map_id)->GetBagCapacity())
+                if(!buffers.is_collected[collect_event.item_id] 
+                    && dogs[collect_event.gatherer_id].GetBagSize() < game_session->GetMap()->GetBagCapacity())
                 {
-                    std::next(dogs.begin(), collect_event.gatherer_id)->second->AddCollectedItemToBag(
-                                                                    {lost_objects.at(collect_event.item_id).id, lost_objects.at(collect_event.item_id).type});
-                    collected_items.insert(collect_event.item_id);
+                    dogs[collect_event.gatherer_id].AddCollectedItemToBag(
+                                                                    {lost_objects[collect_event.item_id].id, lost_objects[collect_event.item_id].type});
+                    buffers.is_collected[collect_event.item_id] = 1;
                 }
                 ++item_event_index;
             }
-            else if(office_event_index < events_on_map.offices_events.size()){
-                GatheringEvent base_event = events_on_map.offices_events[office_event_index];
-                auto dog = std::next(dogs.begin(), base_event.gatherer_id)->second;
+            else if(office_event_index < offices_events.size()){
+                GatheringEvent base_event = offices_events[office_event_index];
+                model::Dog& dog = dogs[base_event.gatherer_id];
 
-                for(auto items_in_bag : dog->GetBag()){
-                    dog->AddScore(lost_objects_on_maps.GetObjectValue(*map_id, items_in_bag.type));
+                for(auto items_in_bag : dog.GetBag()){
+                    dog.AddScore(lost_objects_on_maps.GetObjectValue(*map_id, items_in_bag.type));
                 }
-                dog->ClearBag();
+                dog.ClearBag();
 
                 ++office_event_index;
                 continue;   
             }
         }
 
-        lost_objects_on_maps.EraseLostObjectsOnMap(*map_id, collected_items.begin(), collected_items.end());
+        buffers.collected_items.clear();
+        for(size_t item_index = 0; item_index < buffers.is_collected.size(); ++item_index){
+            if(buffers.is_collected[item_index]){
+                buffers.collected_items.push_back(item_index);
+            }
+        }
+        lost_objects_on_maps.EraseLostObjectsOnMap(*map_id, buffers.collected_items.begin(), buffers.collected_items.end());
     }
 }
 
@@ -1,6 +1,6 @@
 #include "player.h"
 
-#include <iomanip>
+#include <algorithm>
 #include <random>
 
 namespace players{
@@ -10,85 +10,116 @@ namespace details{
     Token TokenGenerator::GenerateToken(){
         std::uint64_t num1 = generator1_();
         std::uint64_t num2 = generator2_();
-
-        std::stringstream ss1, ss2;
-        ss1 << std::setfill('0') << std::hex << std::setw(16) << num1 << std::setw(16) << num2;
-        return Token{ss1.str()};
+        return Token{num1, num2};
     }
     
 }
 
-Player::Player(const Player& other) 
-        : game_session_(other.game_session_)
-        , dog_(other.dog_)
-        , token_(other.token_){
-}
-
 Players::Players(const Players& other)
         : players_(other.players_)
         , token_to_player(other.token_to_player)
-        , next_id_(other.next_id_){
+        , map_id_to_players_(other.map_id_to_players_)
+        , next_id_(other.next_id_)
+        , game_time_(other.game_time_)
+        , afk_queue_(other.afk_queue_){
 }
 
 Players& Players::operator=(const Players& other){
     players_ = other.players_;
     token_to_player = other.token_to_player;
+    map_id_to_players_ = other.map_id_to_players_;
     next_id_ = other.next_id_;
+    game_time_ = other.game_time_;
+    afk_queue_ = other.afk_queue_;
     return *this;
 }
 
-void Players::AddPlayer(std::string map_id, std::string token, int player_id, const players::Player& player){
-    std::shared_ptr<players::Player> player_ptr = std::make_shared<players::Player>(player);
-    players_[map_id][player_id] = player_ptr;
-    token_to_player[players::Token{token}] = player_ptr;
+void Players::TrackAfk(PlayerHandle player, int afk_time){
+    afk_queue_.push(AfkDeadline{game_time_ - afk_time, player});
+}
+
+Player* Players::Insert(Player player, int afk_time){
+    std::string map_id = player.GetMapId();
+    int dog_id = player.GetId();
+    Token token = player.GetToken();
+
+    PlayerHandle handle = players_.Insert(std::move(player));
+    token_to_player[token] = handle;
+    map_id_to_players_[map_id][dog_id] = handle;
+    TrackAfk(handle, afk_time);
+    return players_.Find(handle);
+}
+
+Player* Players::AddPlayer(Token token, int player_id, const model::GameSession& game_session, int dog_id){
+    model::DogHandle dog = game_session.FindDogHandle(dog_id);
+    return Insert(Player{game_session.GetHandle(), dog, game_session.GetMapId(), player_id, dog_id, token}
+                , game_session.FindDog(dog)->GetAfkTime());
 }
 
 Player* Players::AddPlayer(std::string dog_name, model::GameSession* game_session){
     Token token = token_generator_.GenerateToken();
-    std::shared_ptr<Player> player = std::make_shared<Player>(game_session, game_session->AddDog(dog_name, next_id_), token);
-    token_to_player[token] = player;
-    players_[game_session->GetMapId()][next_id_++] = player;
-    return &*player;
+    model::DogHandle dog = game_session->AddDog(dog_name, next_id_);
+    Player* player = Insert(Player{game_session->GetHandle(), dog, game_session->GetMapId(), next_id_, next_id_, token}, 0);
+    ++next_id_;
+    return player;
+}
+
+Player* Players::RestorePlayer(std::string dog_name, model::GameSession* game_session, Token token, int player_id, model::Coordinates pos){
+    model::DogHandle dog = game_session->AddDog(player_id, model::Dog{player_id, std::move(dog_name), pos});
+    next_id_ = std::max(next_id_, player_id + 1);
+    return Insert(Player{game_session->GetHandle(), dog, game_session->GetMapId(), player_id, player_id, token}, 0);
 }
 
-Player* Players::FindByDogIdAndMapId(int dog_id, std::string map_id){
-    if(players_.find(map_id) != players_.end()){
-        if(players_[map_id].find(dog_id) != players_[map_id].end()){
-            return &*players_[map_id][dog_id];
+Player* Players::FindByDogIdAndMapId(int dog_id, const std::string& map_id){
+    if(auto map_it = map_id_to_players_.find(map_id); map_it != map_id_to_players_.end()){
+        if(auto it = map_it->second.find(dog_id); it != map_it->second.end()){
+            return players_.Find(it->second);
         }
     }
     return nullptr;
 }
 
-Player* Players::FindByToken(Token token){
-    if(token_to_player.find(token) != token_to_player.end()){
-        return &*token_to_player[token];
+Player* Players::FindByToken(const Token& token){
+    if(auto it = token_to_player.find(token); it != token_to_player.end()){
+        return players_.Find(it->second);
     }
     return nullptr;
 }
 
-std::unordered_map<std::string, std::vector<int>> Players::EraseRetiredPlayers(int retires_time){
-    std::unordered_map<std::string, std::vector<int>> retired_dogs_id;
+std::vector<model::DogRef> Players::EraseRetiredPlayers(const model::Game& game, int time_delta, int retires_time){
+    std::vector<model::DogRef> retired_dogs;
+    game_time_ += time_delta;
+
+    // простой растет вместе с игровым временем и только сбрасывается,
+    // поэтому настоящий afk_since не меньше записанного в очереди
+    while(!afk_queue_.empty() && afk_queue_.top().afk_since + retires_time <= game_time_){
+        PlayerHandle handle = afk_queue_.top().player;
+        afk_queue_.pop();
 
-    for(auto [map_id, players_on_map] : players_){
-        for(auto [player_id, player] : players_on_map){
-            if(player->IsRetired(retires_time)){
-                retired_dogs_id[map_id].push_back(player->GetId());
-                token_to_player.erase(player->GetToken());
-            }
+        const Player* player = players_.Find(handle);
+        if(player == nullptr){
+            continue;
+        }
+
+        const model::Dog* dog = game.FindDog(player->GetDogRef());
+        int afk_time = dog != nullptr ? dog->GetAfkTime() : retires_time;
+        if(afk_time < retires_time){
+            TrackAfk(handle, afk_time);
+            continue;
         }
-    }
 
-    for(auto [map_id, erased_players] : retired_dogs_id){
-        for(auto player_id : erased_players){
-            players_[map_id].erase(player_id);
+        retired_dogs.push_back(player->GetDogRef());
+        token_to_player.erase(player->GetToken());
+        if(auto map_it = map_id_to_players_.find(player->GetMapId()); map_it != map_id_to_players_.end()){
+            map_it->second.erase(player->GetId());
         }
+        players_.Erase(handle);
     }
 
-    return retired_dogs_id;
+    return retired_dogs;
 }
 
-const std::unordered_map<std::string, std::unordered_map<int, std::shared_ptr<Player>>>& Players::GetPlayers() const{
+const Players::PlayersStorage& Players::GetPlayers() const{
     return players_;
 }
 
@@ -1,21 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <queue>
 #include <unordered_set>
 #include <random>
 #include <sstream>
 #include <chrono>
 
 #include "model.h"
-#include "tagged.h"
+#include "slot_map.h"
+#include "token.h"
 
 namespace players{
 
 using namespace std::literals;
-struct TokenTag{
-};
-
-using Token = util::Tagged<std::string, TokenTag>;
 
 namespace details{
 
@@ -39,69 +39,108 @@ namespace details{
 class Player{
 public:
     Player() = default;
-    Player(const Player& other);
-    Player(model::GameSession* game_session, std::shared_ptr<model::Dog> dog, Token token)
-           : game_session_(game_session), dog_(dog), token_(std::move(token)){}
+    Player(model::GameSessionHandle game_session, model::DogHandle dog, std::string map_id, int player_id, int dog_id, Token token)
+           : game_session_(game_session), dog_(dog), map_id_(std::move(map_id))
+           , player_id_(player_id), dog_id_(dog_id), token_(std::move(token)){}
 
+    // id собаки игрока
     int GetId() const{
-        return dog_->GetId();
+        return dog_id_;
     }
 
-    std::string GetMapId() const{
-        return game_session_->GetMapId();
+    int GetPlayerId() const{
+        return player_id_;
     }
 
-    Token GetToken() const{
-        return token_;
+    const std::string& GetMapId() const{
+        return map_id_;
     }
 
-    void SetDogSpeed(const model::Speed& new_speed){
-        dog_->SetSpeed(new_speed);
+    const Token& GetToken() const{
+        return token_;
     }
 
-    void SetDogDir(const model::DirectionGeo& dir){
-        dog_->SetDir(dir);
+    model::GameSessionHandle GetGameSession() const{
+        return game_session_;
     }
 
-    const model::GameSession* GetGameSession() const{
-        return game_session_;
+    model::DogHandle GetDog() const{
+        return dog_;
     }
 
-    bool IsRetired(int retired_time) const{
-        return dog_->GetAfkTime() >= retired_time;
+    model::DogRef GetDogRef() const{
+        return model::DogRef{game_session_, dog_};
     }
 
 private:
-    model::GameSession* game_session_ = nullptr;
-    std::shared_ptr<model::Dog> dog_ = nullptr;
-    Token token_ = Token{""};
+    // сессия и собака хранятся ссылками в SlotMap игры, сами объекты достаются через model::Game
+    model::GameSessionHandle game_session_;
+    model::DogHandle dog_;
+    std::string map_id_;
+    int player_id_ = 0;
+    int dog_id_ = 0;
+    Token token_;
 };
 
+struct PlayerTag{};
+using PlayerHandle = util::Handle<PlayerTag>;
+
 class Players{
 public:
+    using PlayersStorage = util::SlotMap<Player, PlayerTag>;
+
     Players() = default;
 
     Players(const Players& other);
     Players& operator=(const Players& other);
 
-    void AddPlayer(std::string map_id, std::string token, int player_id, const players::Player& player);
+    // игрок из снимка: его собака уже есть в game_session
+    Player* AddPlayer(Token token, int player_id, const model::GameSession& game_session, int dog_id);
     void SetNextId(int next_id){
         next_id_ = next_id;
     }
 
+    int GetNextId() const{
+        return next_id_;
+    }
+
+    // Указатели на игроков действительны до следующего добавления или удаления игрока
     Player* AddPlayer(std::string dog_name, model::GameSession* game_session);
-    Player* FindByDogIdAndMapId(int dog_id, std::string map_id);
-    Player* FindByToken(Token token);
+    // повтор входа из журнала: токен, id и точка появления уже известны
+    Player* RestorePlayer(std::string dog_name, model::GameSession* game_session, Token token, int player_id, model::Coordinates pos);
+    Player* FindByDogIdAndMapId(int dog_id, const std::string& map_id);
+    Player* FindByToken(const Token& token);
 
-    // возвращает id собак удаленных игроков
-    std::unordered_map<std::string, std::vector<int>> EraseRetiredPlayers(int retires_time);
+    // Продвигает игровое время на time_delta (после хода собак) и удаляет игроков,
+    // простоявших retires_time. Возвращает собак удаленных игроков
+    std::vector<model::DogRef> EraseRetiredPlayers(const model::Game& game, int time_delta, int retires_time);
 
-    const std::unordered_map<std::string, std::unordered_map<int, std::shared_ptr<Player>>>& GetPlayers() const;
+    const PlayersStorage& GetPlayers() const;
 
 private:
-    std::unordered_map<std::string, std::unordered_map<int, std::shared_ptr<Player>>> players_;
-    std::unordered_map<Token, std::shared_ptr<Player>, util::TaggedHasher<Token>> token_to_player;
+    // Игрок в очереди на уход: с какого игрового времени (не позже) собака стоит.
+    // Очередь ленивая - сброс простоя ее не трогает, устаревшая запись при извлечении
+    // переставляется по текущему простою. Так за тик проверяются только игроки, чей срок мог выйти
+    struct AfkDeadline{
+        std::int64_t afk_since;
+        PlayerHandle player;
+
+        bool operator>(const AfkDeadline& other) const{
+            return afk_since > other.afk_since;
+        }
+    };
+    using AfkQueue = std::priority_queue<AfkDeadline, std::vector<AfkDeadline>, std::greater<AfkDeadline>>;
+
+    Player* Insert(Player player, int afk_time);
+    void TrackAfk(PlayerHandle player, int afk_time);
+
+    PlayersStorage players_;
+    std::unordered_map<Token, PlayerHandle, TokenHasher> token_to_player;
+    std::unordered_map<std::string, std::unordered_map<int, PlayerHandle>> map_id_to_players_;
     int next_id_ = 0;
+    // сумма дельт тиков
+    std::int64_t game_time_ = 0;
+    AfkQueue afk_queue_;
     details::TokenGenerator token_generator_;
 };
 
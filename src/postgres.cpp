@@ -2,30 +2,109 @@
 
 namespace postgres{
 
+using pqxx::operator"" _zv;
+
+namespace details{
+
+    constexpr auto INSERT_RECORD = "insert_record"_zv;
+    constexpr auto INSERT_RECORDS_CHUNK = "insert_records_chunk"_zv;
+    constexpr auto SELECT_RECORDS = "select_records"_zv;
+
+    constexpr auto SELECT_RECORDS_QUERY = R"(
+        SELECT id, name, score, play_time FROM retired_players ORDER BY score DESC, play_time, name LIMIT $1 OFFSET $2;
+    )";
+
+    std::string MakeChunkInsertQuery(size_t rows){
+        std::string query = "INSERT INTO retired_players VALUES ";
+        for(size_t row = 0; row < rows; ++row){
+            size_t first = row * 4;
+            query += (row == 0 ? "(" : ", (");
+            query += "$" + std::to_string(first + 1) + ", $" + std::to_string(first + 2)
+                    + ", $" + std::to_string(first + 3) + ", $" + std::to_string(first + 4) + ")";
+        }
+        query += " ON CONFLICT (id) DO NOTHING;";
+        return query;
+    }
+
+} // details
+
+void PrepareConnection(pqxx::connection& connection){
+    connection.prepare(details::INSERT_RECORD, R"(
+        INSERT INTO retired_players VALUES($1, $2, $3, $4) ON CONFLICT (id) DO NOTHING;
+    )");
+    connection.prepare(details::INSERT_RECORDS_CHUNK, details::MakeChunkInsertQuery(RecordRepositoryImpl::INSERT_CHUNK_SIZE));
+    connection.prepare(details::SELECT_RECORDS, details::SELECT_RECORDS_QUERY);
+
+    // временная таблица живет столько же, сколько соединение
+    pqxx::nontransaction work{connection};
+    work.exec(R"(
+        CREATE TEMP TABLE IF NOT EXISTS retired_players_stage (LIKE retired_players) ON COMMIT DELETE ROWS;
+    )");
+}
+
 void RecordRepositoryImpl::Save(const domain::Record& record, pqxx::work& work){
-    //доработать
-    work.exec_params(R"(
-        INSERT INTO retired_players VALUES($1, $2, $3, $4);
-    )", record.GetId().ToString(), record.GetDogName(), record.GetScore(), record.GetTime());
+    work.exec_prepared(details::INSERT_RECORD, record.GetId().ToString(), record.GetDogName(), record.GetScore(), record.GetTime());
 }
 
 void RecordRepositoryImpl::SaveRecords(const std::vector<domain::Record>& records) {
-    pqxx::work work{connection_};
+    if(records.empty()){
+        return;
+    }
+
+    pqxx::work work{*connection_};
 
-    for(auto record : records){
-        Save(record, work);
+    if(records.size() >= COPY_THRESHOLD){
+        CopyRecords(records, work);
+    }
+    else{
+        InsertRecords(records, work);
     }
 
     work.commit();
 }
 
+void RecordRepositoryImpl::InsertRecords(const std::vector<domain::Record>& records, pqxx::work& work){
+    size_t index = 0;
+    for(; index + INSERT_CHUNK_SIZE <= records.size(); index += INSERT_CHUNK_SIZE){
+        pqxx::params params;
+        params.reserve(INSERT_CHUNK_SIZE * 4);
+        for(size_t i = index; i < index + INSERT_CHUNK_SIZE; ++i){
+            params.append(records[i].GetId().ToString());
+            params.append(records[i].GetDogName());
+            params.append(records[i].GetScore());
+            params.append(records[i].GetTime());
+        }
+        work.exec_prepared(details::INSERT_RECORDS_CHUNK, params);
+    }
+
+    for(; index < records.size(); ++index){
+        Save(records[index], work);
+    }
+}
+
+void RecordRepositoryImpl::CopyRecords(const std::vector<domain::Record>& records, pqxx::work& work){
+    // COPY не умеет ON CONFLICT, поэтому сначала пишем во временную таблицу
+    {
+        auto stream = pqxx::stream_to::table(work, {"retired_players_stage"}, {"id", "name", "score", "play_time"});
+        for(const auto& record : records){
+            stream.write_values(record.GetId().ToString(), record.GetDogName(), record.GetScore(), record.GetTime());
+        }
+        stream.complete();
+    }
+
+    work.exec(R"(
+        INSERT INTO retired_players SELECT * FROM retired_players_stage ON CONFLICT (id) DO NOTHING;
+    )");
+    work.exec("TRUNCATE retired_players_stage;");
+}
+
 std::vector<domain::Record> RecordRepositoryImpl::GetRecords(int start, int count){
-    pqxx::work work{connection_};
+    pqxx::work work{*connection_};
     std::vector<domain::Record> records;
 
-    for(auto record : work.exec_params(R"(
-            SELECT * FROM retired_players ORDER BY score DESC, play_time, name LIMIT $1 OFFSET $2;
-        )", count, start)){
+    auto result = work.exec_prepared(details::SELECT_RECORDS, count, start);
+    records.reserve(result.size());
+    for(auto record : result){
         records.emplace_back(domain::RecordId::FromString(record[0].as<std::string>())
                             , record[1].as<std::string>()
                             , record[2].as<int>()
@@ -35,12 +114,34 @@ std::vector<domain::Record> RecordRepositoryImpl::GetRecords(int start, int coun
     return records;
 }
 
-Database::Database(size_t num_threads, const char* db_url) 
-    : connection_pool_(num_threads, [db_url]{
-            return std::make_shared<pqxx::connection>(db_url);
-        }){
-    auto conn = connection_pool_.GetConnection();
-    pqxx::work work{*conn};
+void AsyncRecordRepository::AsyncGetRecords(int start, int count, GetRecordsHandler handler){
+    connection_->AsyncQuery(details::SELECT_RECORDS_QUERY, {std::to_string(count), std::to_string(start)}
+                          , [handler = std::move(handler)](boost::system::error_code ec, async_pg::Result result){
+        std::vector<domain::Record> records;
+        if(ec){
+            handler(ec, std::move(records));
+            return;
+        }
+
+        try{
+            records.reserve(result.GetRowCount());
+            for(int row = 0; row < result.GetRowCount(); ++row){
+                records.emplace_back(domain::RecordId::FromString(std::string(result.GetValue(row, 0)))
+                                    , std::string(result.GetValue(row, 1))
+                                    , std::stoi(std::string(result.GetValue(row, 2)))
+                                    , std::stoi(std::string(result.GetValue(row, 3))));
+            }
+        }catch(const std::exception&){
+            handler(async_pg::Errc::QUERY_FAILED, {});
+            return;
+        }
+        handler({}, std::move(records));
+    });
+}
+
+std::string Database::CreateSchema(const std::string& db_url){
+    pqxx::connection conn{db_url};
+    pqxx::work work{conn};
 
     work.exec_params(R"(
         CREATE TABLE IF NOT EXISTS retired_players (
@@ -56,6 +157,15 @@ Database::Database(size_t num_threads, const char* db_url)
     )");
 
     work.commit();
+    return db_url;
+}
+
+Database::Database(net::io_context& ioc, PoolConfig pool_config, const std::string& db_url)
+    : connection_pool_(ioc, pool_config, [db_url = CreateSchema(db_url)]{
+            auto conn = std::make_shared<pqxx::connection>(db_url);
+            PrepareConnection(*conn);
+            return conn;
+        }){
 }
 
-} // postgres
\ No newline at end of file
+} // postgres
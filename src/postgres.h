@@ -2,6 +2,7 @@
 
 #include "records.h"
 #include "connection_pool.h"
+#include "async_pg.h"
 
 #include <pqxx/pqxx>
 #include <pqxx/connection>
@@ -12,28 +13,81 @@ namespace postgres{
 
 class RecordRepositoryImpl : public domain::RecordRepository{
 public:
-    RecordRepositoryImpl(pqxx::connection& connection) : connection_(connection){}
+    // начиная с какого размера пачки записи идут через COPY
+    static constexpr size_t COPY_THRESHOLD = 256;
+    // сколько строк вставляет один многострочный подготовленный INSERT
+    static constexpr size_t INSERT_CHUNK_SIZE = 32;
 
-    void Save(const domain::Record& record, pqxx::work& work) override;
+    explicit RecordRepositoryImpl(ConnectionPool::ConnectionWrapper&& connection) : connection_(std::move(connection)){}
+
+    void Save(const domain::Record& record, pqxx::work& work);
     void SaveRecords(const std::vector<domain::Record>& records) override;
     std::vector<domain::Record> GetRecords(int start, int count) override;
 
+    // многострочные INSERT через подготовленные запросы
+    void InsertRecords(const std::vector<domain::Record>& records, pqxx::work& work);
+    // COPY во временную таблицу и перенос в retired_players одним запросом
+    void CopyRecords(const std::vector<domain::Record>& records, pqxx::work& work);
+
+    pqxx::connection& GetConnection() const{
+        return *connection_;
+    }
+
 private:
-    pqxx::connection& connection_;
+    ConnectionPool::ConnectionWrapper connection_;
 };
 
+// Чтение рекордов через неблокирующее соединение: обработчик вызывается на io_context,
+// пока идет запрос, потоки io_context свободны
+class AsyncRecordRepository{
+public:
+    using GetRecordsHandler = std::function<void(boost::system::error_code ec, std::vector<domain::Record> records)>;
+
+    explicit AsyncRecordRepository(std::shared_ptr<async_pg::Connection> connection) : connection_(std::move(connection)){}
+
+    void AsyncGetRecords(int start, int count, GetRecordsHandler handler);
+
+private:
+    std::shared_ptr<async_pg::Connection> connection_;
+};
+
+// Вызывается один раз для каждого нового соединения пула
+void PrepareConnection(pqxx::connection& connection);
+
 class Database{
 public:
-    explicit Database(size_t num_threads, const char* db_url);
+    Database(net::io_context& ioc, PoolConfig pool_config, const std::string& db_url);
 
+    // блокирует вызывающий поток, нельзя вызывать из потоков io_context
     std::shared_ptr<RecordRepositoryImpl> GetRecordRepo() &{
-        auto conn = connection_pool_.GetConnection();
-        std::shared_ptr<RecordRepositoryImpl> record_repr = std::make_shared<RecordRepositoryImpl>(*conn);
-        return record_repr;
+        return std::make_shared<RecordRepositoryImpl>(connection_pool_.GetConnection());
+    }
+
+    // Сигнатура обработчика: void(boost::system::error_code, std::shared_ptr<RecordRepositoryImpl>)
+    template <typename CompletionToken>
+    auto AsyncGetRecordRepo(CompletionToken&& token) &{
+        return net::async_initiate<CompletionToken, void(boost::system::error_code, std::shared_ptr<RecordRepositoryImpl>)>(
+            [this](auto handler){
+                connection_pool_.AsyncGetConnection([handler = std::move(handler)](boost::system::error_code ec, ConnectionPool::ConnectionWrapper conn) mutable {
+                    std::shared_ptr<RecordRepositoryImpl> repo;
+                    if(!ec){
+                        repo = std::make_shared<RecordRepositoryImpl>(std::move(conn));
+                    }
+                    std::move(handler)(ec, std::move(repo));
+                });
+            },
+            token);
+    }
+
+    PoolStats GetPoolStats() const{
+        return connection_pool_.GetStats();
     }
 
 private:
+    // создает таблицы до того, как пул откроет соединения и подготовит запросы
+    static std::string CreateSchema(const std::string& db_url);
+
     ConnectionPool connection_pool_;
 };
 
-} //postgres
\ No newline at end of file
+} //postgres
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace random_gen {
+
+/*
+ * PCG32 (XSH-RR, 64 бита состояния, 32 бита результата).
+ * Генератор без общего состояния: у каждой сессии свой, поэтому тики разных сессий
+ * не мешают друг другу. При одинаковых seed и stream последовательность одна и та же
+ * на любой платформе, в отличие от rand().
+ */
+class Pcg32 {
+public:
+    using result_type = std::uint32_t;
+
+    // полное состояние, его хватает для продолжения последовательности после снимка
+    struct State {
+        std::uint64_t state = 0;
+        // всегда нечетный, 0 - состояние не задано
+        std::uint64_t increment = 0;
+
+        bool operator==(const State&) const = default;
+    };
+
+    Pcg32() {
+        Seed(0);
+    }
+
+    explicit Pcg32(std::uint64_t seed, std::uint64_t stream = 0) {
+        Seed(seed, stream);
+    }
+
+    // разные stream при одном seed дают независимые последовательности
+    void Seed(std::uint64_t seed, std::uint64_t stream = 0) {
+        state_ = 0;
+        increment_ = (stream << 1u) | 1u;
+        Next();
+        state_ += seed;
+        Next();
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        return Next();
+    }
+
+    // равномерно в [0, bound), без перекоса остатка от деления
+    std::uint32_t UniformInt(std::uint32_t bound) {
+        if (bound == 0) {
+            return 0;
+        }
+        const std::uint32_t threshold = (0u - bound) % bound;
+        for (;;) {
+            std::uint32_t value = Next();
+            if (value >= threshold) {
+                return value % bound;
+            }
+        }
+    }
+
+    // равномерно в [0, 1)
+    double UniformDouble() {
+        return Next() * 0x1p-32;
+    }
+
+    State GetState() const {
+        return State{state_, increment_};
+    }
+
+    void SetState(State state) {
+        state_ = state.state;
+        increment_ = state.increment | 1u;
+    }
+
+private:
+    std::uint32_t Next() {
+        std::uint64_t old_state = state_;
+        state_ = old_state * 6364136223846793005ULL + increment_;
+        auto xorshifted = static_cast<std::uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+        auto rot = static_cast<std::uint32_t>(old_state >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31u));
+    }
+
+    std::uint64_t state_ = 0;
+    std::uint64_t increment_ = 1;
+};
+
+// Номер потока по имени (FNV-1a). В отличие от std::hash, значение задано алгоритмом
+// и не зависит от стандартной библиотеки, поэтому журнал воспроизводится и другой сборкой
+constexpr std::uint64_t MakeStream(std::string_view name) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace random_gen
@@ -0,0 +1,234 @@
+#include "record_log.h"
+#include "binary_log.h"
+#include "log_utils.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+
+namespace record_log{
+
+namespace details{
+
+    constexpr std::array<char, 4> MAGIC = {'G', 'S', 'R', 'L'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = MAGIC.size() + sizeof(std::uint32_t);
+    // uuid + score + play_time
+    constexpr size_t FIXED_PAYLOAD_SIZE = 16 + 2 * sizeof(std::int32_t);
+    constexpr size_t MAX_PAYLOAD_SIZE = FIXED_PAYLOAD_SIZE + 4096;
+
+    using binary_log::GetU32;
+    using binary_log::PutU32;
+
+    void AppendEntry(std::vector<char>& out, const domain::Record& record){
+        std::vector<char> payload;
+        payload.reserve(FIXED_PAYLOAD_SIZE + record.GetDogName().size());
+        const auto& uuid = *record.GetId();
+        payload.insert(payload.end(), uuid.begin(), uuid.end());
+        PutU32(payload, static_cast<std::uint32_t>(record.GetScore()));
+        PutU32(payload, static_cast<std::uint32_t>(record.GetTime()));
+        payload.insert(payload.end(), record.GetDogName().begin(), record.GetDogName().end());
+        binary_log::AppendEntry(out, payload);
+    }
+
+    domain::Record ParsePayload(const char* data, size_t size){
+        util::detail::UUIDType uuid;
+        std::copy(data, data + 16, uuid.begin());
+        auto score = static_cast<std::int32_t>(GetU32(data + 16));
+        auto play_time = static_cast<std::int32_t>(GetU32(data + 20));
+        return domain::Record{domain::RecordId{uuid}, std::string(data + FIXED_PAYLOAD_SIZE, size - FIXED_PAYLOAD_SIZE), score, play_time};
+    }
+
+    std::vector<char> MakeHeader(){
+        std::vector<char> header(MAGIC.begin(), MAGIC.end());
+        PutU32(header, VERSION);
+        return header;
+    }
+
+    void LogRecoveryError(const std::string& text){
+        BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, log_data::MakeErrorData(0, text, "record log"))
+                                << "error";
+    }
+
+    [[noreturn]] void ThrowErrno(const std::string& what){
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+} // details
+
+RecordLog::RecordLog(LogConfig config, std::shared_ptr<leaderboard::Leaderboard> index)
+    : config_(std::move(config)), index_(std::move(index)){
+    try{
+        Recover();
+    }catch(...){
+        if(fd_ >= 0){
+            ::close(fd_);
+        }
+        throw;
+    }
+    last_sync_ = Clock::now();
+}
+
+RecordLog::~RecordLog(){
+    if(fd_ < 0){
+        return;
+    }
+    try{
+        Sync();
+    }catch(const std::exception& e){
+        details::LogRecoveryError(e.what());
+    }
+    ::close(fd_);
+}
+
+void RecordLog::Recover(){
+    std::vector<char> data;
+    {
+        std::ifstream file(config_.path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    fd_ = ::open(config_.path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if(fd_ < 0){
+        details::ThrowErrno("open " + config_.path.string());
+    }
+
+    if(data.size() < details::HEADER_SIZE){
+        // новый файл или файл, оборвавшийся на заголовке
+        auto header = details::MakeHeader();
+        if(::ftruncate(fd_, 0) != 0){
+            details::ThrowErrno("truncate " + config_.path.string());
+        }
+        file_size_ = 0;
+        WriteAll(header);
+        SyncLocked();
+        return;
+    }
+    if(!std::equal(details::MAGIC.begin(), details::MAGIC.end(), data.begin())
+        || details::GetU32(data.data() + details::MAGIC.size()) != details::VERSION){
+        throw std::runtime_error(config_.path.string() + " is not a record log");
+    }
+
+    std::vector<domain::Record> records;
+    size_t offset = binary_log::ReadEntries(data, details::HEADER_SIZE, details::MAX_PAYLOAD_SIZE, [&records](const char* payload, size_t size){
+        if(size < details::FIXED_PAYLOAD_SIZE){
+            return false;
+        }
+        records.push_back(details::ParsePayload(payload, size));
+        return true;
+    });
+
+    if(offset != data.size()){
+        recovery_info_.truncated_bytes = data.size() - offset;
+        details::LogRecoveryError("truncated broken tail of " + config_.path.string() + ": "
+                                  + std::to_string(recovery_info_.truncated_bytes) + " bytes");
+        if(::ftruncate(fd_, static_cast<off_t>(offset)) != 0){
+            details::ThrowErrno("truncate " + config_.path.string());
+        }
+        if(::fsync(fd_) != 0){
+            details::ThrowErrno("fsync " + config_.path.string());
+        }
+    }
+    file_size_ = offset;
+    if(::lseek(fd_, static_cast<off_t>(file_size_), SEEK_SET) < 0){
+        details::ThrowErrno("seek " + config_.path.string());
+    }
+
+    recovery_info_.records = records.size();
+    index_->Add(records);
+}
+
+void RecordLog::SaveRecords(const std::vector<domain::Record>& records){
+    if(records.empty()){
+        return;
+    }
+
+    std::lock_guard lock{mutex_};
+    // Повтор журнала игры после перезапуска отдает уже сохраненные записи, индекс их отсеивает.
+    // Проверка, запись и пополнение индекса идут под одной блокировкой
+    std::vector<domain::Record> fresh;
+    std::unordered_set<domain::RecordId, leaderboard::RecordIdHasher> batch_ids;
+    std::vector<char> data;
+    for(const auto& record : records){
+        if(index_->Contains(record.GetId()) || !batch_ids.insert(record.GetId()).second){
+            continue;
+        }
+        if(record.GetDogName().size() > details::MAX_PAYLOAD_SIZE - details::FIXED_PAYLOAD_SIZE){
+            throw std::invalid_argument("dog name is too long for record log");
+        }
+        details::AppendEntry(data, record);
+        fresh.push_back(record);
+    }
+    if(fresh.empty()){
+        return;
+    }
+
+    WriteAll(data);
+    // одна пачка - не больше одного fsync
+    if(config_.sync_interval.count() == 0 || Clock::now() - last_sync_ >= config_.sync_interval){
+        SyncLocked();
+    }
+    index_->Add(fresh);
+}
+
+std::vector<domain::Record> RecordLog::GetRecords(int start, int count){
+    if(start < 0 || count <= 0){
+        return {};
+    }
+    return index_->GetPage(static_cast<size_t>(start), static_cast<size_t>(count)).records;
+}
+
+void RecordLog::Sync(){
+    std::lock_guard lock{mutex_};
+    SyncLocked();
+}
+
+bool RecordLog::HasUnsynced(){
+    std::lock_guard lock{mutex_};
+    return dirty_;
+}
+
+void RecordLog::WriteAll(const std::vector<char>& data){
+    size_t written = 0;
+    while(written < data.size()){
+        ssize_t result = ::write(fd_, data.data() + written, data.size() - written);
+        if(result < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            int error = errno;
+            // не оставляем в файле половину пачки: следующая запись легла бы после мусора
+            if(::ftruncate(fd_, static_cast<off_t>(file_size_)) == 0){
+                ::lseek(fd_, static_cast<off_t>(file_size_), SEEK_SET);
+            }
+            errno = error;
+            details::ThrowErrno("write " + config_.path.string());
+        }
+        written += static_cast<size_t>(result);
+    }
+    file_size_ += data.size();
+    dirty_ = true;
+}
+
+void RecordLog::SyncLocked(){
+    if(!dirty_){
+        return;
+    }
+    if(::fdatasync(fd_) != 0){
+        details::ThrowErrno("fsync " + config_.path.string());
+    }
+    dirty_ = false;
+    last_sync_ = Clock::now();
+}
+
+} // record_log
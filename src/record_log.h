@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "records.h"
+#include "leaderboard.h"
+
+namespace record_log{
+
+using namespace std::chrono_literals;
+
+struct LogConfig{
+    std::filesystem::path path;
+    // 0 - fsync после каждой пачки, иначе не чаще одного раза за sync_interval
+    std::chrono::milliseconds sync_interval = 0ms;
+};
+
+struct RecoveryInfo{
+    size_t records = 0;
+    // столько байт оборванного или испорченного хвоста было отрезано
+    std::uintmax_t truncated_bytes = 0;
+};
+
+/*
+ * Хранилище рекордов без БД: журнал, в который записи только дописываются,
+ * и упорядоченный индекс в памяти (та же таблица рекордов, что отдает /records).
+ * Формат файла: заголовок "GSRL" + версия, дальше записи вида
+ * [u32 длина][u32 crc32][uuid, score, play_time, имя]. При открытии журнал
+ * читается целиком, хвост после первой испорченной записи отрезается.
+ */
+class RecordLog : public domain::RecordRepository{
+public:
+    RecordLog(LogConfig config, std::shared_ptr<leaderboard::Leaderboard> index);
+    ~RecordLog();
+
+    RecordLog(const RecordLog&) = delete;
+    RecordLog& operator=(const RecordLog&) = delete;
+
+    // записи попадают в индекс после записи в файл
+    void SaveRecords(const std::vector<domain::Record>& records) override;
+    // O(log n + count), данные из индекса
+    std::vector<domain::Record> GetRecords(int start, int count) override;
+
+    // сбрасывает на диск все, что было отложено из-за sync_interval
+    void Sync();
+    // есть записанное, но еще не сброшенное на диск
+    bool HasUnsynced();
+
+    const RecoveryInfo& GetRecoveryInfo() const{
+        return recovery_info_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Recover();
+    void WriteAll(const std::vector<char>& data);
+    void SyncLocked();
+
+    LogConfig config_;
+    std::shared_ptr<leaderboard::Leaderboard> index_;
+    RecoveryInfo recovery_info_;
+
+    std::mutex mutex_;
+    int fd_ = -1;
+    std::uintmax_t file_size_ = 0;
+    bool dirty_ = false;
+    Clock::time_point last_sync_;
+};
+
+} // record_log
@@ -0,0 +1,285 @@
+#include "record_writer.h"
+#include "log_utils.h"
+
+#include <boost/json.hpp>
+#include <cassert>
+#include <fstream>
+#include <iterator>
+
+namespace record_writer{
+
+namespace json = boost::json;
+
+namespace details{
+
+    void LogWriterError(const std::string& text){
+        BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, log_data::MakeErrorData(0, text, "records writer"))
+                                << "error";
+    }
+
+    std::string RecordToJson(const domain::Record& record){
+        json::object record_json;
+        record_json.insert(json::object::value_type("id", record.GetId().ToString()));
+        record_json.insert(json::object::value_type("name", record.GetDogName()));
+        record_json.insert(json::object::value_type("score", record.GetScore()));
+        record_json.insert(json::object::value_type("playTime", record.GetTime()));
+        return json::serialize(record_json);
+    }
+
+    domain::Record RecordFromJson(const std::string& line){
+        auto record_json = json::parse(line).as_object();
+        return domain::Record{domain::RecordId::FromString(std::string(record_json.at("id").as_string()))
+                            , std::string(record_json.at("name").as_string())
+                            , static_cast<int>(record_json.at("score").as_int64())
+                            , static_cast<int>(record_json.at("playTime").as_int64())};
+    }
+
+} // details
+
+RecordWriter::RecordWriter(SaveFunc save, WriterConfig config)
+    : save_(std::move(save)), config_(std::move(config)){
+}
+
+RecordWriter::~RecordWriter(){
+    Stop();
+}
+
+void RecordWriter::Enqueue(std::vector<domain::Record>&& records){
+    {
+        std::lock_guard lock{mutex_};
+        for(auto& record : records){
+            queue_.push_back(std::move(record));
+        }
+    }
+    cond_var_.notify_one();
+}
+
+void RecordWriter::Start(){
+    assert(!worker_.joinable());
+    if(!config_.spill_path.empty()){
+        // записи, не сохраненные в прошлый запуск
+        has_spilled_ = std::filesystem::exists(config_.spill_path) || std::filesystem::exists(GetPendingPath());
+    }
+    worker_ = std::thread([this]{
+        Run();
+    });
+}
+
+void RecordWriter::Stop(){
+    {
+        std::lock_guard lock{mutex_};
+        if(stopping_){
+            return;
+        }
+        stopping_ = true;
+    }
+    cond_var_.notify_one();
+    if(worker_.joinable()){
+        worker_.join();
+        return;
+    }
+
+    // поток не запускался, другого потока у очереди нет
+    if(queue_.empty()){
+        return;
+    }
+    std::vector<domain::Record> records{std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end())};
+    queue_.clear();
+    if(config_.spill_path.empty()){
+        details::LogWriterError("records are lost: " + std::to_string(records.size()));
+        return;
+    }
+    Spill(records);
+}
+
+void RecordWriter::Run(){
+    if(has_spilled_){
+        ReloadSpilled();
+    }
+
+    auto has_work = [this]{
+        return stopping_ || !queue_.empty();
+    };
+    std::unique_lock lock{mutex_};
+    while(true){
+        if(!unflushed_){
+            cond_var_.wait(lock, has_work);
+        }
+        else if(!cond_var_.wait_until(lock, flush_deadline_, has_work)){
+            // новых записей нет, а отложенный хвост пора сбросить
+            lock.unlock();
+            Flush();
+            lock.lock();
+            continue;
+        }
+        if(queue_.empty()){
+            // stopping_ и все записано
+            lock.unlock();
+            if(unflushed_){
+                Flush();
+            }
+            return;
+        }
+
+        // даем накопиться пачке, если это не остановка
+        if(!stopping_ && queue_.size() < config_.max_batch_size){
+            cond_var_.wait_for(lock, config_.batch_delay, [this]{
+                return stopping_ || queue_.size() >= config_.max_batch_size;
+            });
+        }
+
+        auto batch = TakeBatch(lock);
+        lock.unlock();
+        HandleBatch(std::move(batch));
+        lock.lock();
+    }
+}
+
+std::vector<domain::Record> RecordWriter::TakeBatch(std::unique_lock<std::mutex>& lock){
+    assert(lock.owns_lock());
+    size_t batch_size = std::min(queue_.size(), config_.max_batch_size);
+    std::vector<domain::Record> batch;
+    batch.reserve(batch_size);
+    for(size_t i = 0; i < batch_size; ++i){
+        batch.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+    }
+    return batch;
+}
+
+bool RecordWriter::TrySave(const std::vector<domain::Record>& batch){
+    auto backoff = config_.retry_backoff;
+    for(int attempt = 1; attempt <= config_.max_attempts; ++attempt){
+        try{
+            save_(batch);
+            return true;
+        }catch(const std::exception& e){
+            details::LogWriterError(e.what());
+        }
+
+        if(attempt != config_.max_attempts){
+            std::unique_lock lock{mutex_};
+            // при остановке не ждем, а сразу сбрасываем в файл после последней попытки
+            if(cond_var_.wait_for(lock, backoff, [this]{ return stopping_; })){
+                backoff = 0ms;
+            }
+            backoff *= 2;
+        }
+    }
+    return false;
+}
+
+void RecordWriter::HandleBatch(std::vector<domain::Record>&& batch){
+    const size_t batch_size = batch.size();
+
+    if(TrySave(batch)){
+        if(config_.flush && !unflushed_){
+            unflushed_ = true;
+            flush_deadline_ = std::chrono::steady_clock::now() + config_.flush_interval;
+        }
+        OnPendingHandled(batch_size);
+        // БД снова доступна - возвращаем в очередь то, что сбросили раньше
+        if(has_spilled_ && pending_left_ == 0){
+            ReloadSpilled();
+        }
+        return;
+    }
+
+    if(config_.spill_path.empty()){
+        // сбросить некуда - возвращаем записи в начало очереди
+        std::lock_guard lock{mutex_};
+        if(stopping_){
+            details::LogWriterError("records are lost: " + std::to_string(batch_size));
+            return;
+        }
+        for(auto it = batch.rbegin(); it != batch.rend(); ++it){
+            queue_.push_front(std::move(*it));
+        }
+        return;
+    }
+
+    Spill(batch);
+    OnPendingHandled(batch_size);
+}
+
+void RecordWriter::Flush(){
+    try{
+        config_.flush();
+        unflushed_ = false;
+    }catch(const std::exception& e){
+        details::LogWriterError(std::string("failed to flush records: ") + e.what());
+        // записи уже в хранилище, повторяем только сброс
+        flush_deadline_ = std::chrono::steady_clock::now() + config_.flush_interval;
+    }
+}
+
+void RecordWriter::Spill(const std::vector<domain::Record>& batch){
+    std::ofstream spill_file(config_.spill_path, std::ios::app);
+    for(const auto& record : batch){
+        spill_file << details::RecordToJson(record) << '\n';
+    }
+    spill_file.flush();
+    if(!spill_file){
+        details::LogWriterError("failed to spill records to " + config_.spill_path.string());
+        return;
+    }
+    has_spilled_ = true;
+}
+
+void RecordWriter::ReloadSpilled(){
+    std::filesystem::path pending_path = GetPendingPath();
+    // незавершенный перенос с прошлого раза имеет приоритет
+    if(!std::filesystem::exists(pending_path)){
+        std::error_code ec;
+        std::filesystem::rename(config_.spill_path, pending_path, ec);
+        if(ec){
+            has_spilled_ = false;
+            return;
+        }
+    }
+    has_spilled_ = std::filesystem::exists(config_.spill_path);
+
+    std::vector<domain::Record> records;
+    std::ifstream pending_file(pending_path);
+    std::string line;
+    while(std::getline(pending_file, line)){
+        if(line.empty()){
+            continue;
+        }
+        try{
+            records.push_back(details::RecordFromJson(line));
+        }catch(const std::exception& e){
+            details::LogWriterError(std::string("skipped broken spilled record: ") + e.what());
+        }
+    }
+    pending_file.close();
+
+    if(records.empty()){
+        std::filesystem::remove(pending_path);
+        return;
+    }
+
+    pending_left_ = records.size();
+    std::lock_guard lock{mutex_};
+    for(auto it = records.rbegin(); it != records.rend(); ++it){
+        queue_.push_front(std::move(*it));
+    }
+}
+
+void RecordWriter::OnPendingHandled(size_t count){
+    if(pending_left_ == 0){
+        return;
+    }
+    // записи из pending-файла стоят в начале очереди, значит уходят первыми
+    pending_left_ -= std::min(pending_left_, count);
+    if(pending_left_ == 0){
+        std::filesystem::remove(GetPendingPath());
+    }
+}
+
+std::filesystem::path RecordWriter::GetPendingPath() const{
+    return config_.spill_path.string() + ".pending";
+}
+
+} // record_writer
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "records.h"
+
+namespace record_writer{
+
+using namespace std::chrono_literals;
+
+struct WriterConfig{
+    size_t max_batch_size = 512;
+    // сколько ждать накопления пачки после появления первой записи
+    std::chrono::milliseconds batch_delay = 100ms;
+    int max_attempts = 3;
+    std::chrono::milliseconds retry_backoff = 200ms;
+    // куда сбрасывать записи, если БД недоступна; пустой путь - держать в памяти
+    std::filesystem::path spill_path;
+    // Досброс на диск того, что хранилище отложило (пакетный fsync). Поток записи вызывает его
+    // не позже flush_interval после первой несброшенной пачки, даже если новых записей нет.
+    // Пусто - хранилище сбрасывает все само
+    std::function<void()> flush;
+    std::chrono::milliseconds flush_interval = 0ms;
+};
+
+/*
+ * Фоновая запись результатов ушедших игроков.
+ * Enqueue только кладет записи в очередь, сохранение идет в отдельном потоке
+ * пачками с повторными попытками. Если сохранить не удалось, пачка дописывается
+ * в spill-файл и будет повторно отправлена после восстановления БД или при следующем запуске.
+ * Поток запускает Start, когда хранилище открыто; до этого записи только копятся в очереди.
+ */
+class RecordWriter{
+public:
+    // должна бросать исключение, если сохранить записи не удалось
+    using SaveFunc = std::function<void(const std::vector<domain::Record>& records)>;
+
+    RecordWriter(SaveFunc save, WriterConfig config);
+    ~RecordWriter();
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    void Enqueue(std::vector<domain::Record>&& records);
+
+    // запускает поток записи; вызывается один раз, после открытия хранилища
+    void Start();
+
+    // Дописывает оставшиеся записи и останавливает поток.
+    // Без Start хранилище не открыто: очередь сбрасывается в spill-файл, если он задан
+    void Stop();
+
+private:
+    void Run();
+    std::vector<domain::Record> TakeBatch(std::unique_lock<std::mutex>& lock);
+    bool TrySave(const std::vector<domain::Record>& batch);
+    void HandleBatch(std::vector<domain::Record>&& batch);
+    void Flush();
+
+    void Spill(const std::vector<domain::Record>& batch);
+    // переносит записи из spill-файла в начало очереди
+    void ReloadSpilled();
+    void OnPendingHandled(size_t count);
+
+    std::filesystem::path GetPendingPath() const;
+
+    SaveFunc save_;
+    WriterConfig config_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+    std::deque<domain::Record> queue_;
+    bool stopping_ = false;
+
+    // доступны только из потока записи
+    bool has_spilled_ = false;
+    size_t pending_left_ = 0;
+    bool unflushed_ = false;
+    std::chrono::steady_clock::time_point flush_deadline_;
+
+    std::thread worker_;
+};
+
+} // record_writer
@@ -1,6 +1,6 @@
 #pragma once
 #include <string>
-#include <pqxx/pqxx>
+#include <vector>
 
 #include "tagged_uuid.h"
 
@@ -44,7 +44,6 @@ private:
 
 class RecordRepository{ 
 public:
-    virtual void Save(const Record& record, pqxx::work& work) = 0;
     virtual void SaveRecords(const std::vector<Record>& records) = 0;
     virtual std::vector<Record> GetRecords(int start, int count) = 0;
 
@@ -9,6 +9,9 @@ using value_type = json::object::value_type;
 
 namespace details{
 
+    // через сколько секунд клиенту стоит повторить запрос, пока сервер запускается
+    constexpr std::string_view RETRY_AFTER_SECONDS = "1"sv;
+
     int HexToDec(std::string num){
         unsigned dec;
         sscanf(num.c_str(), "%x", &dec);
@@ -36,6 +39,27 @@ FileResponse RequestHandler::MakeFileResponse(http::status status, http::file_bo
     return response;
 }
 
+StringResponse RequestHandler::MakeHealthResponse(bool is_ok, unsigned http_version, bool keep_alive){
+    json::object status;
+    status.insert(value_type("status", is_ok ? "ok" : "starting"));
+    auto response = request_handle_utils::MakeStringResponse(is_ok ? http::status::ok : http::status::service_unavailable, json::serialize(status)
+                                                            , http_version, keep_alive, ContentType::APPLICATION_JSON);
+    response.set(http::field::cache_control, "no-cache");
+    if(!is_ok){
+        response.set(http::field::retry_after, details::RETRY_AFTER_SECONDS);
+    }
+    return response;
+}
+
+StringResponse RequestHandler::MakeUnavailableResponse(unsigned http_version, bool keep_alive){
+    auto response = request_handle_utils::MakeStringResponse(http::status::service_unavailable
+                                                            , request_handle_utils::MakeErrorMessage("serverStarting", "Server is starting, retry later")
+                                                            , http_version, keep_alive, ContentType::APPLICATION_JSON);
+    response.set(http::field::cache_control, "no-cache");
+    response.set(http::field::retry_after, details::RETRY_AFTER_SECONDS);
+    return response;
+}
+
 std::string RequestHandler::DecodingURI(std::string_view uri){
     std::string decoding_uri;
     
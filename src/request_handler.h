@@ -5,6 +5,7 @@
 #include "log_utils.h"
 #include "api_request_handler.h"
 
+#include <atomic>
 #include <iostream>
 #include <filesystem>
 #include <variant>
@@ -83,9 +84,12 @@ public:
                         , int milliseconds
                         , bool is_random_generate
                         , serializing_listener::ApplicationListener* app_listener
-                        , std::shared_ptr<postgres::Database> db
-                        , int retired_time)
-                : api_request_handler_(game, lost_objects, milliseconds, is_random_generate, app_listener, db, retired_time)
+                        , std::shared_ptr<leaderboard::Leaderboard> leaderboard
+                        , std::shared_ptr<record_writer::RecordWriter> record_writer
+                        , int retired_time
+                        , std::shared_ptr<journal::Journal> journal = nullptr)
+                : api_request_handler_(game, lost_objects, milliseconds, is_random_generate, app_listener, leaderboard, record_writer, retired_time
+                                     , std::move(journal))
                 , root_(std::move(root)), api_strand_(api_strand) {}
 
     RequestHandler(const RequestHandler&) = delete;
@@ -108,10 +112,29 @@ public:
             }
             return SendResponse(std::move(response), std::forward<Send>(send));
         }
+        //Проверки живости и готовности отвечают сразу, не дожидаясь strand'а
+        else if(target == "/health/live"s || target == "/health/ready"s){
+            Response response;
+            {
+                LoggingRequestHandle logger_(response);
+                response = MakeHealthResponse(target == "/health/live"s || IsReady(), request.version(), request.keep_alive());
+            }
+            return SendResponse(std::move(response), std::forward<Send>(send));
+        }
         //Обработка Api запросов
         else if(api::details::IsSubPath(target, "/api"s)){
             target = target.substr(target.find_first_of('/', 1));
 
+            //Пока восстанавливается состояние и прогревается хранилище, игра недоступна
+            if(!IsReady()){
+                Response response;
+                {
+                    LoggingRequestHandle logger_(response);
+                    response = MakeUnavailableResponse(request.version(), request.keep_alive());
+                }
+                return SendResponse(std::move(response), std::forward<Send>(send));
+            }
+
             auto handler = [self = shared_from_this(), request, target, send = std::forward<Send>(send)] {
                 Response response;
                 {
@@ -155,6 +178,20 @@ public:
         api_request_handler_.Tick(delta);
     }
 
+    // Восстановление состояния при запуске, до SetReady
+    void Restore(){
+        api_request_handler_.Restore();
+    }
+
+    // После вызова API начинает обрабатывать запросы, до него отвечает 503
+    void SetReady(){
+        is_ready_.store(true, std::memory_order_release);
+    }
+
+    bool IsReady() const{
+        return is_ready_.load(std::memory_order_acquire);
+    }
+
     const model::Game& GetGame(){
         return api_request_handler_.GetGame();
     }
@@ -171,6 +208,8 @@ private:
     FileResponse MakeFileResponse(http::status status, http::file_body::value_type body, unsigned http_version, 
                                       bool active_alive, std::string_view content_type);
     std::string DecodingURI(std::string_view uri);
+    StringResponse MakeHealthResponse(bool is_ok, unsigned http_version, bool keep_alive);
+    StringResponse MakeUnavailableResponse(unsigned http_version, bool keep_alive);
     
     template <typename Send>
     void SendResponse(Response&& response, Send&& send){
@@ -184,6 +223,7 @@ private:
     api::ApiRequestHandler api_request_handler_;
     Strand api_strand_;
     fs::path root_;
+    std::atomic<bool> is_ready_{false};
 };
 
 }  // namespace http_handler
@@ -1,7 +1,58 @@
 #include "serializing_listener.h"
+#include "log_utils.h"
+#include "snapshot_shards.h"
 
 namespace serializing_listener{
-    
+
+namespace details{
+
+    using Clock = std::chrono::steady_clock;
+
+    std::chrono::microseconds ElapsedSince(Clock::time_point start){
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+    }
+
+    void LogSnapshotError(const std::string& text){
+        BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                << logging::add_value(additional_data, log_data::MakeErrorData(0, text, "snapshot"))
+                                << "error";
+    }
+
+} // details
+
+boost::json::value MakeSnapshotStatsData(const SnapshotStats& stats){
+    boost::json::object answer;
+    answer.insert(boost::json::object::value_type{"snapshots", stats.snapshots});
+    answer.insert(boost::json::object::value_type{"skipped", stats.skipped});
+    answer.insert(boost::json::object::value_type{"failed", stats.failed});
+    answer.insert(boost::json::object::value_type{"last_capture_us", stats.last_capture.count()});
+    answer.insert(boost::json::object::value_type{"max_capture_us", stats.max_capture.count()});
+    answer.insert(boost::json::object::value_type{"last_write_us", stats.last_write.count()});
+    answer.insert(boost::json::object::value_type{"last_write_cpu_us", stats.last_write_cpu.count()});
+    answer.insert(boost::json::object::value_type{"last_shards", stats.last_shards});
+    answer.insert(boost::json::object::value_type{"last_raw_bytes", stats.last_raw_bytes});
+    answer.insert(boost::json::object::value_type{"last_file_bytes", stats.last_file_bytes});
+    return answer;
+}
+
+SerializingListener::SerializingListener(std::chrono::milliseconds save_period, const std::filesystem::path& snapshoot_path, int compression_level)
+    : save_period_(save_period), snapshoot_path_(snapshoot_path), compression_level_(compression_level){
+    worker_ = std::thread([this]{
+        Run();
+    });
+}
+
+SerializingListener::~SerializingListener(){
+    {
+        std::unique_lock lock{mutex_};
+        // начатый снимок дописывается до конца
+        WaitIdle(lock);
+        stopping_ = true;
+    }
+    cond_var_.notify_all();
+    worker_.join();
+}
+
 void SerializingListener::OnTick(std::chrono::milliseconds time_delta
             , const model::Game& game
             , const players::Players& players
@@ -11,16 +62,113 @@ void SerializingListener::OnTick(std::chrono::milliseconds time_delta
         return;
     }
 
-    if(time_since_save_ + time_delta >= save_period_){
-        std::filesystem::path temp_path = std::filesystem::weakly_canonical(snapshoot_path_.string() + "/../temp");
-        std::ofstream temp_file(temp_path, std::ios::binary);
-        serialization::MakeModelSerialize(temp_file, game, players, lost_objects_on_map);
-        std::filesystem::rename(temp_path, snapshoot_path_);
-        time_since_save_ = 0ms;
+    if(time_since_save_ + time_delta < save_period_){
+        time_since_save_ += time_delta;
+        return;
+    }
+    time_since_save_ = 0ms;
+
+    {
+        std::lock_guard lock{mutex_};
+        if(pending_.has_value()){
+            ++stats_.skipped;
+            return;
+        }
+    }
+
+    auto start = details::Clock::now();
+    auto snapshot = serialization::CaptureState(game, players, lost_objects_on_map);
+    if(journal_){
+        snapshot.journal_segment = journal_->Rotate();
+    }
+    auto capture_time = details::ElapsedSince(start);
+
+    {
+        std::lock_guard lock{mutex_};
+        pending_ = std::move(snapshot);
+        stats_.last_capture = capture_time;
+        stats_.max_capture = std::max(stats_.max_capture, capture_time);
+    }
+    cond_var_.notify_all();
+}
+
+void SerializingListener::Save(const model::Game& game
+            , const players::Players& players
+            , const extra_data::LostObjectsOnMaps& lost_objects_on_map){
+    {
+        // оба снимка пишутся в одни и те же файлы частей
+        std::unique_lock lock{mutex_};
+        WaitIdle(lock);
+    }
+    auto snapshot = serialization::CaptureState(game, players, lost_objects_on_map);
+    if(journal_){
+        snapshot.journal_segment = journal_->Rotate();
+    }
+    WriteSnapshot(snapshot);
+}
+
+SnapshotStats SerializingListener::GetStats() const{
+    std::lock_guard lock{mutex_};
+    return stats_;
+}
+
+void SerializingListener::Run(){
+    std::unique_lock lock{mutex_};
+    while(true){
+        cond_var_.wait(lock, [this]{
+            return stopping_ || (pending_.has_value() && !writing_);
+        });
+        if(stopping_){
+            return;
+        }
+
+        writing_ = true;
+        lock.unlock();
+        WriteSnapshot(*pending_);
+        lock.lock();
+        pending_.reset();
+        writing_ = false;
+        cond_var_.notify_all();
+    }
+}
+
+void SerializingListener::WriteSnapshot(const serialization::StateSnapshot& snapshot){
+    auto start = details::Clock::now();
+    bool is_ok = true;
+    snapshot_shards::WriteResult result;
+    try{
+        result = snapshot_shards::WriteShardedSnapshot(snapshoot_path_, snapshot, compression_level_);
+    }catch(const std::exception& e){
+        details::LogSnapshotError(e.what());
+        is_ok = false;
+    }
+    auto write_time = details::ElapsedSince(start);
+
+    if(is_ok && journal_ && snapshot.journal_segment != 0){
+        // события до снимка больше не нужны для восстановления
+        journal_->DropSegmentsBefore(snapshot.journal_segment);
+    }
+
+    std::lock_guard lock{mutex_};
+    if(is_ok){
+        ++stats_.snapshots;
     }
     else{
-        time_since_save_ += time_delta;
+        ++stats_.failed;
+    }
+    stats_.last_write = write_time;
+    if(is_ok){
+        stats_.last_write_cpu = result.cpu_time;
+        stats_.last_shards = result.shards;
+        stats_.last_raw_bytes = result.raw_bytes;
+        stats_.last_file_bytes = result.file_bytes;
     }
 }
 
-}
\ No newline at end of file
+void SerializingListener::WaitIdle(std::unique_lock<std::mutex>& lock){
+    cond_var_.wait(lock, [this]{
+        return !pending_.has_value();
+    });
+}
+
+}
@@ -1,7 +1,18 @@
+#pragma once
+
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <boost/json.hpp>
 
+#include "journal.h"
 #include "model_serialization.h"
 
 namespace serializing_listener{
@@ -16,24 +27,84 @@ public:
                 , const extra_data::LostObjectsOnMaps& lost_objects_on_map) = 0;
 };
 
+struct SnapshotStats{
+    std::uint64_t snapshots = 0;
+    // пропущены, потому что предыдущий снимок еще писался
+    std::uint64_t skipped = 0;
+    std::uint64_t failed = 0;
+    // сколько strand был занят снятием состояния
+    std::chrono::microseconds last_capture{0};
+    std::chrono::microseconds max_capture{0};
+    // кодирование и запись файла в фоне
+    std::chrono::microseconds last_write{0};
+    // процессорное время всех потоков записи, в основном кодирование и сжатие
+    std::chrono::microseconds last_write_cpu{0};
+    // файлов-частей в последнем снимке (по одной на карту)
+    std::uint64_t last_shards = 0;
+    std::uint64_t last_raw_bytes = 0;
+    std::uint64_t last_file_bytes = 0;
+};
+
+boost::json::value MakeSnapshotStatsData(const SnapshotStats& stats);
+
+/*
+ * Периодическое сохранение состояния игры.
+ * На strand'е снимается только плоская копия состояния (StateSnapshot),
+ * кодирование и запись идут в отдельном потоке. Снимок пишется частями по картам
+ * (snapshot_shards), по пути снимка лежит манифест. Пока предыдущий снимок
+ * пишется, новые не снимаются.
+ * Если ведется журнал, снимок запоминает сегмент, с которого начинаются
+ * события после него, а после записи более старые сегменты удаляются.
+ */
 class SerializingListener : public ApplicationListener{
 public:
-    SerializingListener(std::chrono::milliseconds save_period, const std::filesystem::path& snapshoot_path)
-        : save_period_(save_period), snapshoot_path_(snapshoot_path){}
+    // compression_level 1-9 - снимок сжимается gzip, 0 - пишется как есть и читается через mmap
+    SerializingListener(std::chrono::milliseconds save_period, const std::filesystem::path& snapshoot_path, int compression_level = 0);
+    ~SerializingListener();
+
+    SerializingListener(const SerializingListener&) = delete;
+    SerializingListener& operator=(const SerializingListener&) = delete;
 
     void OnTick(std::chrono::milliseconds time_delta
                 , const model::Game& game
                 , const players::Players& players
                 , const extra_data::LostObjectsOnMaps& lost_objects_on_map) override;
 
+    // синхронное сохранение (при остановке сервера): дожидается фоновой записи
+    void Save(const model::Game& game
+            , const players::Players& players
+            , const extra_data::LostObjectsOnMaps& lost_objects_on_map);
+
+    void SetJournal(std::shared_ptr<journal::Journal> journal){
+        journal_ = std::move(journal);
+    }
+
     const std::filesystem::path& GetPath() const{
         return snapshoot_path_;
     }
 
+    SnapshotStats GetStats() const;
+
 private:
+    void Run();
+    void WriteSnapshot(const serialization::StateSnapshot& snapshot);
+    void WaitIdle(std::unique_lock<std::mutex>& lock);
+
     std::chrono::milliseconds time_since_save_ = 0ms;
     std::chrono::milliseconds save_period_;
     std::filesystem::path snapshoot_path_;
+    int compression_level_;
+    std::shared_ptr<journal::Journal> journal_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_var_;
+    // снимок, который ждет записи или пишется сейчас
+    std::optional<serialization::StateSnapshot> pending_;
+    bool writing_ = false;
+    bool stopping_ = false;
+    SnapshotStats stats_;
+
+    std::thread worker_;
 };
 
-} //serializing_listener
\ No newline at end of file
+} //serializing_listener
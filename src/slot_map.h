@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <compare>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ * Ссылка на элемент SlotMap: номер слота и его поколение.
+ * При удалении элемента поколение слота растет, и старые ссылки перестают его находить.
+ * Tag, как и в Tagged, не дает перепутать ссылки на разные типы.
+ */
+template <typename Tag>
+struct Handle {
+    static constexpr std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t index = INVALID_INDEX;
+    std::uint32_t generation = 0;
+
+    bool IsValid() const {
+        return index != INVALID_INDEX;
+    }
+
+    auto operator<=>(const Handle<Tag>&) const = default;
+};
+
+template <typename HandleType>
+struct HandleHasher {
+    size_t operator()(const HandleType& handle) const {
+        return std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(handle.generation) << 32 | handle.index);
+    }
+};
+
+/*
+ * Хранилище с доступом по Handle за O(1) и проверкой, что элемент еще жив.
+ * Элементы лежат подряд в одном векторе (обход без разыменований указателей),
+ * удаление переносит последний элемент на место удаленного. Поэтому адреса
+ * и позиции элементов меняются при вставке и удалении - между вызовами хранятся только Handle.
+ */
+template <typename T, typename Tag>
+class SlotMap {
+public:
+    using HandleType = Handle<Tag>;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    template <typename... Args>
+    HandleType Emplace(Args&&... args) {
+        std::uint32_t slot_index;
+        if (!free_slots_.empty()) {
+            slot_index = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot_index = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back(Slot{});
+        }
+
+        values_.emplace_back(std::forward<Args>(args)...);
+        value_slots_.push_back(slot_index);
+        slots_[slot_index].position = static_cast<std::uint32_t>(values_.size() - 1);
+        return HandleType{slot_index, slots_[slot_index].generation};
+    }
+
+    HandleType Insert(T value) {
+        return Emplace(std::move(value));
+    }
+
+    // false, если элемента уже нет
+    bool Erase(HandleType handle) {
+        if (!Contains(handle)) {
+            return false;
+        }
+        Slot& slot = slots_[handle.index];
+        std::uint32_t position = slot.position;
+        std::uint32_t last = static_cast<std::uint32_t>(values_.size() - 1);
+        if (position != last) {
+            values_[position] = std::move(values_[last]);
+            value_slots_[position] = value_slots_[last];
+            slots_[value_slots_[position]].position = position;
+        }
+        values_.pop_back();
+        value_slots_.pop_back();
+
+        slot.position = FREE_POSITION;
+        ++slot.generation;
+        free_slots_.push_back(handle.index);
+        return true;
+    }
+
+    bool Contains(HandleType handle) const {
+        return handle.index < slots_.size() && slots_[handle.index].generation == handle.generation
+            && slots_[handle.index].position != FREE_POSITION;
+    }
+
+    T* Find(HandleType handle) {
+        return Contains(handle) ? &values_[slots_[handle.index].position] : nullptr;
+    }
+
+    const T* Find(HandleType handle) const {
+        return Contains(handle) ? &values_[slots_[handle.index].position] : nullptr;
+    }
+
+    // Handle элемента на позиции position при обходе
+    HandleType GetHandle(size_t position) const {
+        std::uint32_t slot_index = value_slots_[position];
+        return HandleType{slot_index, slots_[slot_index].generation};
+    }
+
+    T& operator[](size_t position) {
+        return values_[position];
+    }
+
+    const T& operator[](size_t position) const {
+        return values_[position];
+    }
+
+    size_t size() const {
+        return values_.size();
+    }
+
+    bool empty() const {
+        return values_.empty();
+    }
+
+    void reserve(size_t count) {
+        values_.reserve(count);
+        value_slots_.reserve(count);
+        slots_.reserve(count);
+        // свободных слотов не больше, чем слотов: удаление тоже не выделяет память
+        free_slots_.reserve(count);
+    }
+
+    iterator begin() {
+        return values_.begin();
+    }
+
+    iterator end() {
+        return values_.end();
+    }
+
+    const_iterator begin() const {
+        return values_.begin();
+    }
+
+    const_iterator end() const {
+        return values_.end();
+    }
+
+private:
+    static constexpr std::uint32_t FREE_POSITION = std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot {
+        // позиция элемента в values_, FREE_POSITION - слот свободен
+        std::uint32_t position = FREE_POSITION;
+        std::uint32_t generation = 0;
+    };
+
+    std::vector<T> values_;
+    // слот каждого элемента values_
+    std::vector<std::uint32_t> value_slots_;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+};
+
+}  // namespace util
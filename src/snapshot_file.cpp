@@ -0,0 +1,406 @@
+#include "snapshot_file.h"
+#include "binary_log.h"
+
+#include <boost/iostreams/close.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace snapshot_file{
+
+namespace details{
+
+    constexpr size_t TABLE_ALIGNMENT = 8;
+
+    class Builder{
+    public:
+        Builder() : data_(sizeof(FileHeader)){}
+
+        template <typename Record>
+        TableRef AddTable(const std::vector<Record>& records){
+            Align();
+            TableRef table{data_.size(), records.size()};
+            const char* begin = reinterpret_cast<const char*>(records.data());
+            data_.insert(data_.end(), begin, begin + records.size() * sizeof(Record));
+            return table;
+        }
+
+        TableRef AddStrings(const std::vector<char>& strings){
+            Align();
+            TableRef table{data_.size(), strings.size()};
+            data_.insert(data_.end(), strings.begin(), strings.end());
+            return table;
+        }
+
+        std::vector<char> Finish(FileHeader header){
+            header.header_size = sizeof(FileHeader);
+            header.body_size = data_.size() - sizeof(FileHeader);
+            header.body_crc = binary_log::Crc32(data_.data() + sizeof(FileHeader), header.body_size);
+            std::memcpy(data_.data(), &header, sizeof(header));
+            return std::move(data_);
+        }
+
+    private:
+        void Align(){
+            data_.resize((data_.size() + TABLE_ALIGNMENT - 1) / TABLE_ALIGNMENT * TABLE_ALIGNMENT);
+        }
+
+        std::vector<char> data_;
+    };
+
+    StringRef AddString(std::vector<char>& strings, std::string_view str){
+        StringRef ref{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(str.size())};
+        strings.insert(strings.end(), str.begin(), str.end());
+        return ref;
+    }
+
+    [[noreturn]] void ThrowBroken(const std::string& what){
+        throw std::runtime_error("broken state snapshot: " + what);
+    }
+
+    template <typename Record>
+    std::span<const Record> GetTable(const char* data, size_t size, const TableRef& table, const char* name){
+        if(table.offset % alignof(Record) != 0 || table.offset > size
+            || table.count > (size - table.offset) / sizeof(Record)){
+            ThrowBroken(std::string("table ") + name + " is out of file");
+        }
+        return {reinterpret_cast<const Record*>(data + table.offset), static_cast<size_t>(table.count)};
+    }
+
+    bool IsRange(std::uint64_t begin, std::uint64_t count, size_t size){
+        return begin <= size && count <= size - begin;
+    }
+
+} // details
+
+std::vector<char> EncodeSnapshot(const serialization::StateSnapshot& snapshot){
+    std::vector<MapRecord> maps;
+    std::vector<DogRecord> dogs;
+    std::vector<BagItemRecord> bag_items;
+    std::vector<PlayerRecord> players;
+    std::vector<LootRecord> loot;
+    std::vector<char> strings;
+
+    std::unordered_map<std::string_view, const serialization::LostObjectsState*> lost_objects;
+    for(const auto& objects : snapshot.lost_objects){
+        lost_objects[objects.map_id] = &objects;
+    }
+
+    std::unordered_map<std::string_view, std::uint32_t> map_indexes;
+    auto add_map = [&](std::string_view map_id){
+        map_indexes[map_id] = static_cast<std::uint32_t>(maps.size());
+        MapRecord map{};
+        map.map_id = details::AddString(strings, map_id);
+        map.dogs_begin = static_cast<std::uint32_t>(dogs.size());
+        map.loot_begin = static_cast<std::uint32_t>(loot.size());
+        if(auto it = lost_objects.find(map_id); it != lost_objects.end()){
+            for(const auto& object : it->second->objects){
+                loot.push_back(LootRecord{object.coords.x, object.coords.y, object.id, object.type});
+            }
+            map.loot_count = static_cast<std::uint32_t>(it->second->objects.size());
+            lost_objects.erase(it);
+        }
+        maps.push_back(map);
+        return &maps.back();
+    };
+
+    dogs.reserve(snapshot.dogs.size());
+    bag_items.reserve(snapshot.bag_items.size());
+    for(const auto& session : snapshot.sessions){
+        MapRecord* map = add_map(session.map_id);
+        map->has_session = 1;
+        map->dogs_count = static_cast<std::uint32_t>(session.dogs_count);
+        for(size_t i = session.dogs_begin; i < session.dogs_begin + session.dogs_count; ++i){
+            const auto& dog = snapshot.dogs[i];
+            DogRecord record{};
+            record.x = dog.pos.x;
+            record.y = dog.pos.y;
+            record.speed_x = dog.speed.horizontal;
+            record.speed_y = dog.speed.vertical;
+            record.id = static_cast<std::uint32_t>(dog.id);
+            record.score = dog.score;
+            record.name = details::AddString(strings, dog.name);
+            record.direction = static_cast<std::uint32_t>(dog.direction);
+            record.bag_begin = static_cast<std::uint32_t>(bag_items.size());
+            record.bag_size = static_cast<std::uint32_t>(dog.bag_size);
+            record.afk_time = dog.afk_time;
+            record.play_time = dog.play_time;
+            for(size_t j = dog.bag_begin; j < dog.bag_begin + dog.bag_size; ++j){
+                bag_items.push_back(BagItemRecord{snapshot.bag_items[j].id, snapshot.bag_items[j].type});
+            }
+            dogs.push_back(record);
+        }
+    }
+    // трофеи на картах, где сейчас никто не играет
+    for(const auto& objects : snapshot.lost_objects){
+        if(lost_objects.contains(objects.map_id)){
+            add_map(objects.map_id);
+        }
+    }
+
+    players.reserve(snapshot.players.size());
+    for(const auto& player : snapshot.players){
+        auto it = map_indexes.find(player.map_id);
+        if(it == map_indexes.end()){
+            add_map(player.map_id);
+            it = map_indexes.find(player.map_id);
+        }
+        PlayerRecord record{};
+        record.map_index = it->second;
+        record.player_id = static_cast<std::uint32_t>(player.player_id);
+        record.dog_id = static_cast<std::uint32_t>(player.dog_id);
+        auto token = player.token.ToChars();
+        record.token = details::AddString(strings, std::string_view(token.data(), token.size()));
+        players.push_back(record);
+    }
+
+    FileHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.journal_segment = snapshot.journal_segment;
+    header.next_player_id = static_cast<std::uint32_t>(snapshot.next_player_id);
+    header.next_loot_id = snapshot.next_loot_id;
+    header.time_without_loot_ms = snapshot.time_without_loot.count();
+    header.random_state = snapshot.random.state;
+    header.random_increment = snapshot.random.increment;
+
+    details::Builder builder;
+    header.maps = builder.AddTable(maps);
+    header.dogs = builder.AddTable(dogs);
+    header.bag_items = builder.AddTable(bag_items);
+    header.players = builder.AddTable(players);
+    header.loot = builder.AddTable(loot);
+    header.strings = builder.AddStrings(strings);
+    return builder.Finish(header);
+}
+
+size_t WriteSnapshot(std::ostream& output, const serialization::StateSnapshot& snapshot, int compression_level){
+    auto data = EncodeSnapshot(snapshot);
+    WriteSnapshotData(output, data, compression_level);
+    return data.size();
+}
+
+void WriteSnapshotData(std::ostream& output, const std::vector<char>& data, int compression_level){
+    auto write_chunks = [&data](std::ostream& stream){
+        for(size_t offset = 0; offset < data.size(); offset += WRITE_CHUNK_SIZE){
+            size_t size = std::min(WRITE_CHUNK_SIZE, data.size() - offset);
+            stream.write(data.data() + offset, static_cast<std::streamsize>(size));
+        }
+    };
+
+    if(compression_level <= 0){
+        write_chunks(output);
+    }
+    else{
+        boost::iostreams::filtering_ostream compressed;
+        compressed.push(boost::iostreams::gzip_compressor(boost::iostreams::gzip_params(std::min(compression_level, 9))), WRITE_CHUNK_SIZE);
+        compressed.push(output, WRITE_CHUNK_SIZE);
+        write_chunks(compressed);
+        // gzip дописывает хвост только при закрытии цепочки
+        boost::iostreams::close(compressed);
+    }
+
+    if(!output){
+        throw std::runtime_error("failed to write state snapshot");
+    }
+}
+
+SnapshotView SnapshotView::Parse(const char* data, size_t size){
+    if(size < VERSION_1_HEADER_SIZE || !std::equal(MAGIC.begin(), MAGIC.end(), data)){
+        details::ThrowBroken("not a state snapshot");
+    }
+    if(reinterpret_cast<std::uintptr_t>(data) % alignof(FileHeader) != 0){
+        details::ThrowBroken("misaligned buffer");
+    }
+
+    SnapshotView view;
+    FileHeader& header = view.header_;
+    std::memcpy(&header, data, VERSION_1_HEADER_SIZE);
+    if(header.version != VERSION && header.version != 1){
+        details::ThrowBroken("unsupported version " + std::to_string(header.version));
+    }
+    const size_t header_size = header.version == VERSION ? sizeof(FileHeader) : VERSION_1_HEADER_SIZE;
+    if(header.header_size != header_size || size < header_size || header.body_size != size - header_size){
+        details::ThrowBroken("unexpected size");
+    }
+    std::memcpy(&header, data, header_size);
+    if(binary_log::Crc32(data + header_size, header.body_size) != header.body_crc){
+        details::ThrowBroken("checksum mismatch");
+    }
+
+    view.maps_ = details::GetTable<MapRecord>(data, size, header.maps, "maps");
+    view.dogs_ = details::GetTable<DogRecord>(data, size, header.dogs, "dogs");
+    view.bag_items_ = details::GetTable<BagItemRecord>(data, size, header.bag_items, "bag items");
+    view.players_ = details::GetTable<PlayerRecord>(data, size, header.players, "players");
+    view.loot_ = details::GetTable<LootRecord>(data, size, header.loot, "loot");
+    auto strings = details::GetTable<char>(data, size, header.strings, "strings");
+    view.strings_ = std::string_view(strings.data(), strings.size());
+
+    // после проверки ссылок RestoreState может им доверять
+    auto check_string = [&view](StringRef ref){
+        if(!details::IsRange(ref.offset, ref.size, view.strings_.size())){
+            details::ThrowBroken("string is out of table");
+        }
+    };
+    for(const auto& map : view.maps_){
+        check_string(map.map_id);
+        if(!details::IsRange(map.dogs_begin, map.dogs_count, view.dogs_.size())
+            || !details::IsRange(map.loot_begin, map.loot_count, view.loot_.size())){
+            details::ThrowBroken("map refers to missing records");
+        }
+    }
+    for(const auto& dog : view.dogs_){
+        check_string(dog.name);
+        if(!details::IsRange(dog.bag_begin, dog.bag_size, view.bag_items_.size())){
+            details::ThrowBroken("dog refers to missing bag items");
+        }
+    }
+    for(const auto& player : view.players_){
+        check_string(player.token);
+        if(player.map_index >= view.maps_.size()){
+            details::ThrowBroken("player refers to missing map");
+        }
+        if(!players::Token::Parse(view.GetString(player.token))){
+            details::ThrowBroken("invalid player token");
+        }
+    }
+
+    return view;
+}
+
+bool IsSnapshotFile(const std::filesystem::path& path){
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, MAGIC.size()> magic{};
+    file.read(magic.data(), magic.size());
+    return file && magic == MAGIC;
+}
+
+bool IsCompressedFile(const std::filesystem::path& path){
+    std::ifstream file(path, std::ios::binary);
+    std::array<unsigned char, 2> magic{};
+    file.read(reinterpret_cast<char*>(magic.data()), magic.size());
+    return file && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+std::vector<char> ReadCompressedSnapshot(const std::filesystem::path& path){
+    std::ifstream file(path, std::ios::binary);
+    boost::iostreams::filtering_istream decompressed;
+    decompressed.push(boost::iostreams::gzip_decompressor(), WRITE_CHUNK_SIZE);
+    decompressed.push(file, WRITE_CHUNK_SIZE);
+
+    std::vector<char> data;
+    data.reserve(static_cast<size_t>(std::filesystem::file_size(path)) * 4);
+    std::array<char, WRITE_CHUNK_SIZE> chunk;
+    while(decompressed.read(chunk.data(), chunk.size()) || decompressed.gcount() > 0){
+        data.insert(data.end(), chunk.data(), chunk.data() + decompressed.gcount());
+    }
+    if(decompressed.bad()){
+        throw std::runtime_error("failed to decompress state snapshot " + path.string());
+    }
+    return data;
+}
+
+MappedSnapshot::MappedSnapshot(const std::filesystem::path& path)
+    : file_(path.c_str(), boost::interprocess::read_only)
+    , region_(file_, boost::interprocess::read_only)
+    , view_(SnapshotView::Parse(static_cast<const char*>(region_.get_address()), region_.get_size())){
+    // таблицы читаются один раз от начала до конца
+    region_.advise(boost::interprocess::mapped_region::advice_sequential);
+}
+
+PreparedState PrepareState(const SnapshotView& view, const model::Game& game){
+    PreparedState state;
+
+    for(const auto& map : view.GetMaps()){
+        std::string map_id{view.GetString(map.map_id)};
+        const model::Map* game_map = game.FindMap(model::Map::Id{map_id});
+        if(game_map == nullptr){
+            details::ThrowBroken("unknown map " + map_id);
+        }
+
+        if(map.has_session){
+            model::GameSession game_session{game_map, game.IsRandomGenerate()};
+            for(const auto& record : view.GetDogs().subspan(map.dogs_begin, map.dogs_count)){
+                model::Dog dog{static_cast<int>(record.id), std::string(view.GetString(record.name)), model::Coordinates{record.x, record.y}};
+                dog.SetSpeed(model::Speed{record.speed_x, record.speed_y});
+                dog.SetDir(static_cast<model::DirectionGeo>(record.direction));
+                dog.AddScore(record.score);
+                dog.AddAfkTime(record.afk_time);
+                dog.AddPlayTime(record.play_time);
+                for(const auto& item : view.GetBagItems().subspan(record.bag_begin, record.bag_size)){
+                    dog.AddCollectedItemToBag(model::CollectedItem{item.id, item.type});
+                }
+                game_session.AddDog(record.id, dog);
+            }
+            state.sessions.push_back(std::move(game_session));
+        }
+
+        std::vector<extra_data::LostObject> objects;
+        objects.reserve(map.loot_count);
+        for(const auto& record : view.GetLoot().subspan(map.loot_begin, map.loot_count)){
+            objects.push_back(extra_data::LostObject{record.id, record.type, model::Coordinates{record.x, record.y}});
+        }
+        state.lost_objects.emplace_back(std::move(map_id), std::move(objects));
+    }
+
+    state.players.reserve(view.GetPlayers().size());
+    for(const auto& record : view.GetPlayers()){
+        state.players.push_back(PreparedState::PlayerInfo{std::string(view.GetString(view.GetMaps()[record.map_index].map_id))
+                                                        , *players::Token::Parse(view.GetString(record.token))
+                                                        , static_cast<int>(record.player_id)
+                                                        , static_cast<int>(record.dog_id)});
+    }
+
+    return state;
+}
+
+void ApplyState(PreparedState&& state
+              , model::Game& game
+              , players::Players& players
+              , extra_data::LostObjectsOnMaps& lost_objects){
+    for(auto& game_session : state.sessions){
+        game.AddGameSession(std::move(game_session));
+    }
+
+    for(auto& [map_id, objects] : state.lost_objects){
+        lost_objects.SetLostObjects(map_id, std::move(objects));
+    }
+
+    for(const auto& player : state.players){
+        model::GameSession* game_session = game.FindGameSessionFromMapId(model::Map::Id{player.map_id});
+        if(game_session == nullptr){
+            details::ThrowBroken("player without game session on " + player.map_id);
+        }
+        if(game_session->FindDogById(player.dog_id) == nullptr){
+            details::ThrowBroken("player without dog " + std::to_string(player.dog_id));
+        }
+        players.AddPlayer(player.token, player.player_id, *game_session, player.dog_id);
+    }
+}
+
+void RestoreState(const SnapshotView& view
+                , model::Game& game
+                , players::Players& players
+                , extra_data::LostObjectsOnMaps& lost_objects){
+    ApplyState(PrepareState(view, game), game, players, lost_objects);
+
+    const FileHeader& header = view.GetHeader();
+    players.SetNextId(std::max(players.GetNextId(), static_cast<int>(header.next_player_id)));
+    lost_objects.GetPossibleLoot().SetNextId(header.next_loot_id);
+    lost_objects.GetPossibleLoot().SetTimeWithoutLoot(std::chrono::milliseconds{header.time_without_loot_ms});
+    if(header.random_increment != 0){
+        game.SetRandomState(random_gen::Pcg32::State{header.random_state, header.random_increment});
+    }
+}
+
+std::vector<char> ConvertLegacySnapshot(std::istream& input){
+    return EncodeSnapshot(serialization::ReadLegacyStateSnapshot(input));
+}
+
+} // snapshot_file
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "model_serialization.h"
+
+/*
+ * Плоский формат снимка состояния.
+ * Заголовок фиксированного размера, за ним таблицы записей фиксированного размера
+ * и таблица строк. Таблицы выровнены по 8 байт и читаются прямо из отображенного
+ * в память файла, без промежуточных копий. Собаки и трофеи одной карты лежат
+ * подряд, карта хранит начало и длину своих отрезков.
+ * Тело после заголовка защищено crc32, номер версии меняется при любом изменении записей.
+ */
+namespace snapshot_file{
+
+static_assert(std::endian::native == std::endian::little, "snapshot file stores numbers in little-endian");
+
+constexpr std::array<char, 4> MAGIC = {'G', 'S', 'S', 'N'};
+constexpr std::uint32_t VERSION = 2;
+// в первой версии заголовок кончался на strings, генератора в нем не было
+constexpr std::uint32_t VERSION_1_HEADER_SIZE = 144;
+
+struct StringRef{
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+struct TableRef{
+    // от начала файла
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+struct FileHeader{
+    std::array<char, 4> magic;
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t body_crc;
+    std::uint64_t body_size;
+    std::uint64_t journal_segment;
+    std::uint32_t next_player_id;
+    std::uint32_t next_loot_id;
+    std::int64_t time_without_loot_ms;
+    TableRef maps;
+    TableRef dogs;
+    TableRef bag_items;
+    TableRef players;
+    TableRef loot;
+    TableRef strings;
+    std::uint64_t random_state;
+    std::uint64_t random_increment;
+};
+
+// карта с сессией и/или трофеями
+struct MapRecord{
+    StringRef map_id;
+    std::uint32_t has_session;
+    std::uint32_t dogs_begin;
+    std::uint32_t dogs_count;
+    std::uint32_t loot_begin;
+    std::uint32_t loot_count;
+    std::uint32_t reserved;
+};
+
+struct DogRecord{
+    double x;
+    double y;
+    double speed_x;
+    double speed_y;
+    std::uint32_t id;
+    std::int32_t score;
+    StringRef name;
+    std::uint32_t direction;
+    std::uint32_t bag_begin;
+    std::uint32_t bag_size;
+    std::int32_t afk_time;
+    std::int32_t play_time;
+    std::uint32_t reserved;
+};
+
+struct BagItemRecord{
+    std::uint32_t id;
+    std::uint32_t type;
+};
+
+struct PlayerRecord{
+    std::uint32_t map_index;
+    std::uint32_t player_id;
+    std::uint32_t dog_id;
+    std::uint32_t reserved;
+    StringRef token;
+};
+
+struct LootRecord{
+    double x;
+    double y;
+    std::uint32_t id;
+    std::uint32_t type;
+};
+
+static_assert(std::is_trivially_copyable_v<FileHeader> && sizeof(FileHeader) == 160);
+static_assert(std::is_trivially_copyable_v<MapRecord> && sizeof(MapRecord) == 32);
+static_assert(std::is_trivially_copyable_v<DogRecord> && sizeof(DogRecord) == 72);
+static_assert(std::is_trivially_copyable_v<BagItemRecord> && sizeof(BagItemRecord) == 8);
+static_assert(std::is_trivially_copyable_v<PlayerRecord> && sizeof(PlayerRecord) == 24);
+static_assert(std::is_trivially_copyable_v<LootRecord> && sizeof(LootRecord) == 24);
+
+std::vector<char> EncodeSnapshot(const serialization::StateSnapshot& snapshot);
+
+// снимок уходит в поток (и в gzip) кусками такого размера
+constexpr size_t WRITE_CHUNK_SIZE = 64 * 1024;
+
+// Пишет снимок в output, при compression_level 1-9 сжимая его gzip на лету.
+// Возвращает размер несжатого снимка.
+size_t WriteSnapshot(std::ostream& output, const serialization::StateSnapshot& snapshot, int compression_level = 0);
+// то же для уже закодированного снимка
+void WriteSnapshotData(std::ostream& output, const std::vector<char>& data, int compression_level = 0);
+
+// Проверенный снимок поверх чужих байтов (отображенного файла или буфера).
+// Parse бросает std::runtime_error, если данные не снимок, другой версии или испорчены.
+class SnapshotView{
+public:
+    SnapshotView() = default;
+
+    static SnapshotView Parse(const char* data, size_t size);
+
+    // заголовок старой версии дополнен нулями
+    const FileHeader& GetHeader() const{
+        return header_;
+    }
+
+    std::span<const MapRecord> GetMaps() const{
+        return maps_;
+    }
+
+    std::span<const DogRecord> GetDogs() const{
+        return dogs_;
+    }
+
+    std::span<const BagItemRecord> GetBagItems() const{
+        return bag_items_;
+    }
+
+    std::span<const PlayerRecord> GetPlayers() const{
+        return players_;
+    }
+
+    std::span<const LootRecord> GetLoot() const{
+        return loot_;
+    }
+
+    std::string_view GetString(StringRef ref) const{
+        return strings_.substr(ref.offset, ref.size);
+    }
+
+private:
+    FileHeader header_{};
+    std::span<const MapRecord> maps_;
+    std::span<const DogRecord> dogs_;
+    std::span<const BagItemRecord> bag_items_;
+    std::span<const PlayerRecord> players_;
+    std::span<const LootRecord> loot_;
+    std::string_view strings_;
+};
+
+bool IsSnapshotFile(const std::filesystem::path& path);
+bool IsCompressedFile(const std::filesystem::path& path);
+
+// Сжатый снимок нельзя отобразить в память, он распаковывается в буфер для SnapshotView::Parse
+std::vector<char> ReadCompressedSnapshot(const std::filesystem::path& path);
+
+// Снимок, отображенный в память. Живет, пока используется его SnapshotView.
+class MappedSnapshot{
+public:
+    explicit MappedSnapshot(const std::filesystem::path& path);
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    const SnapshotView& GetView() const{
+        return view_;
+    }
+
+private:
+    boost::interprocess::file_mapping file_;
+    boost::interprocess::mapped_region region_;
+    SnapshotView view_;
+};
+
+// Состояние снимка, собранное вне модели. PrepareState только читает game,
+// поэтому части снимка можно готовить параллельно, а в модель их переносит ApplyState
+struct PreparedState{
+    struct PlayerInfo{
+        std::string map_id;
+        players::Token token;
+        int player_id;
+        int dog_id;
+    };
+
+    std::vector<model::GameSession> sessions;
+    std::vector<std::pair<std::string, std::vector<extra_data::LostObject>>> lost_objects;
+    std::vector<PlayerInfo> players;
+};
+
+PreparedState PrepareState(const SnapshotView& view, const model::Game& game);
+
+void ApplyState(PreparedState&& state
+              , model::Game& game
+              , players::Players& players
+              , extra_data::LostObjectsOnMaps& lost_objects);
+
+// Переводит состояние из снимка в модель. Сессии и игроки добавляются к уже существующим
+void RestoreState(const SnapshotView& view
+                , model::Game& game
+                , players::Players& players
+                , extra_data::LostObjectsOnMaps& lost_objects);
+
+// Перевод файла старого формата (boost::archive) в плоский
+std::vector<char> ConvertLegacySnapshot(std::istream& input);
+
+} // snapshot_file
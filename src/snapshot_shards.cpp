@@ -0,0 +1,417 @@
+#include "snapshot_shards.h"
+#include "binary_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace snapshot_shards{
+
+namespace details{
+
+    constexpr std::array<char, 4> MAGIC = {'G', 'S', 'S', 'M'};
+    constexpr size_t HEADER_SIZE = MAGIC.size() + sizeof(std::uint32_t);
+    constexpr size_t MAX_PAYLOAD_SIZE = 1 << 24;
+
+    std::chrono::microseconds GetThreadCpuTime(){
+        timespec time{};
+        ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return std::chrono::seconds{time.tv_sec} + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds{time.tv_nsec});
+    }
+
+    // Выполняет fn(i) для всех i из [0, count) на нескольких потоках, включая текущий.
+    // Первое исключение пробрасывается после завершения всех потоков.
+    // Возвращает процессорное время запущенных потоков (без текущего).
+    template <typename Fn>
+    std::chrono::microseconds ParallelFor(size_t count, const Fn& fn){
+        std::atomic<size_t> next_index{0};
+        std::atomic<std::int64_t> workers_cpu{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        auto run = [&]{
+            for(size_t i = next_index++; i < count; i = next_index++){
+                try{
+                    fn(i);
+                }catch(...){
+                    std::lock_guard lock{error_mutex};
+                    if(!error){
+                        error = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        size_t num_threads = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(num_threads > 0 ? num_threads - 1 : 0);
+            for(size_t i = 1; i < num_threads; ++i){
+                workers.emplace_back([&]{
+                    auto cpu_start = GetThreadCpuTime();
+                    run();
+                    workers_cpu += (GetThreadCpuTime() - cpu_start).count();
+                });
+            }
+            run();
+        }
+
+        if(error){
+            std::rethrow_exception(error);
+        }
+        return std::chrono::microseconds{workers_cpu.load()};
+    }
+
+    void SyncFile(const std::filesystem::path& path){
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0 || ::fsync(fd) != 0){
+            int error = errno;
+            if(fd >= 0){
+                ::close(fd);
+            }
+            throw std::system_error(error, std::generic_category(), "fsync " + path.string());
+        }
+        ::close(fd);
+    }
+
+    std::string MakeShardName(const std::filesystem::path& manifest_path, std::uint64_t generation, size_t index){
+        return manifest_path.filename().string() + "." + std::to_string(generation) + "." + std::to_string(index);
+    }
+
+    // <манифест>.<поколение>.<номер>
+    bool IsShardName(const std::string& name, const std::string& manifest_name){
+        if(name.size() <= manifest_name.size() + 1 || name.compare(0, manifest_name.size(), manifest_name) != 0
+            || name[manifest_name.size()] != '.'){
+            return false;
+        }
+        auto suffix = std::string_view(name).substr(manifest_name.size() + 1);
+        auto dot = suffix.find('.');
+        if(dot == std::string_view::npos || dot == 0 || dot + 1 == suffix.size()){
+            return false;
+        }
+        return std::all_of(suffix.begin(), suffix.end(), [](char c){
+            return c == '.' || (c >= '0' && c <= '9');
+        });
+    }
+
+    std::vector<char> ReadFile(const std::filesystem::path& path){
+        std::ifstream file(path, std::ios::binary);
+        if(!file){
+            throw std::runtime_error("cannot open " + path.string());
+        }
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    [[noreturn]] void ThrowInconsistent(const std::string& what){
+        throw std::runtime_error("inconsistent sharded snapshot: " + what);
+    }
+
+} // details
+
+std::vector<char> EncodeManifest(const Manifest& manifest){
+    std::vector<char> payload;
+    binary_log::PutU64(payload, manifest.generation);
+    binary_log::PutU64(payload, manifest.journal_segment);
+    binary_log::PutU32(payload, manifest.next_player_id);
+    binary_log::PutU32(payload, manifest.next_loot_id);
+    binary_log::PutU64(payload, static_cast<std::uint64_t>(manifest.time_without_loot_ms));
+    binary_log::PutU32(payload, static_cast<std::uint32_t>(manifest.shards.size()));
+    for(const auto& shard : manifest.shards){
+        binary_log::PutString(payload, shard.file_name);
+        binary_log::PutU64(payload, shard.file_size);
+        binary_log::PutU32(payload, shard.body_crc);
+    }
+    binary_log::PutU64(payload, manifest.random.state);
+    binary_log::PutU64(payload, manifest.random.increment);
+
+    std::vector<char> data(details::MAGIC.begin(), details::MAGIC.end());
+    binary_log::PutU32(data, MANIFEST_VERSION);
+    binary_log::AppendEntry(data, payload);
+    return data;
+}
+
+Manifest ParseManifest(const std::vector<char>& data){
+    if(data.size() < details::HEADER_SIZE || !std::equal(details::MAGIC.begin(), details::MAGIC.end(), data.begin())){
+        throw std::runtime_error("not a snapshot manifest");
+    }
+    const std::uint32_t version = binary_log::GetU32(data.data() + details::MAGIC.size());
+    if(version != MANIFEST_VERSION && version != 1){
+        throw std::runtime_error("unsupported snapshot manifest version");
+    }
+
+    std::optional<Manifest> manifest;
+    size_t offset = binary_log::ReadEntries(data, details::HEADER_SIZE, details::MAX_PAYLOAD_SIZE, [&manifest, version](const char* payload, size_t size){
+        binary_log::Reader reader(payload, size);
+        Manifest result;
+        auto generation = reader.GetU64();
+        auto journal_segment = reader.GetU64();
+        auto next_player_id = reader.GetU32();
+        auto next_loot_id = reader.GetU32();
+        auto time_without_loot = reader.GetU64();
+        auto count = reader.GetU32();
+        if(reader.IsFailed()){
+            return false;
+        }
+        result.generation = *generation;
+        result.journal_segment = *journal_segment;
+        result.next_player_id = *next_player_id;
+        result.next_loot_id = *next_loot_id;
+        result.time_without_loot_ms = static_cast<std::int64_t>(*time_without_loot);
+
+        for(std::uint32_t i = 0; i < *count; ++i){
+            auto file_name = reader.GetString();
+            auto file_size = reader.GetU64();
+            auto body_crc = reader.GetU32();
+            if(reader.IsFailed()){
+                return false;
+            }
+            result.shards.push_back(ShardInfo{std::move(*file_name), *file_size, *body_crc});
+        }
+        if(version != 1){
+            auto random_state = reader.GetU64();
+            auto random_increment = reader.GetU64();
+            if(reader.IsFailed()){
+                return false;
+            }
+            result.random = random_gen::Pcg32::State{*random_state, *random_increment};
+        }
+        if(reader.GetRemaining() != 0 || manifest.has_value()){
+            return false;
+        }
+        manifest = std::move(result);
+        return true;
+    });
+
+    // ровно одна целая запись до конца файла
+    if(!manifest.has_value() || offset != data.size()){
+        throw std::runtime_error("broken snapshot manifest");
+    }
+    return *manifest;
+}
+
+bool IsManifestFile(const std::filesystem::path& path){
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, details::MAGIC.size()> magic{};
+    file.read(magic.data(), magic.size());
+    return file && magic == details::MAGIC;
+}
+
+Manifest ReadManifest(const std::filesystem::path& path){
+    return ParseManifest(details::ReadFile(path));
+}
+
+std::vector<serialization::StateSnapshot> SplitByMap(const serialization::StateSnapshot& snapshot){
+    std::vector<serialization::StateSnapshot> shards;
+    std::unordered_map<std::string_view, size_t> shard_by_map;
+    auto get_shard = [&shards, &shard_by_map](const std::string& map_id) -> serialization::StateSnapshot& {
+        auto [it, inserted] = shard_by_map.try_emplace(map_id, shards.size());
+        if(inserted){
+            shards.emplace_back();
+        }
+        return shards[it->second];
+    };
+
+    for(const auto& session : snapshot.sessions){
+        auto& shard = get_shard(session.map_id);
+        shard.sessions.push_back(serialization::SessionState{session.map_id, shard.dogs.size(), session.dogs_count});
+        for(size_t i = session.dogs_begin; i < session.dogs_begin + session.dogs_count; ++i){
+            serialization::DogState dog = snapshot.dogs[i];
+            auto bag = std::span{snapshot.bag_items}.subspan(dog.bag_begin, dog.bag_size);
+            dog.bag_begin = shard.bag_items.size();
+            shard.bag_items.insert(shard.bag_items.end(), bag.begin(), bag.end());
+            shard.dogs.push_back(std::move(dog));
+        }
+    }
+    for(const auto& player : snapshot.players){
+        get_shard(player.map_id).players.push_back(player);
+    }
+    for(const auto& objects : snapshot.lost_objects){
+        get_shard(objects.map_id).lost_objects.push_back(objects);
+    }
+
+    return shards;
+}
+
+WriteResult WriteShardedSnapshot(const std::filesystem::path& manifest_path
+                               , const serialization::StateSnapshot& snapshot
+                               , int compression_level){
+    auto cpu_start = details::GetThreadCpuTime();
+    const auto dir = manifest_path.parent_path();
+
+    Manifest manifest;
+    manifest.generation = 1;
+    if(IsManifestFile(manifest_path)){
+        try{
+            manifest.generation = ReadManifest(manifest_path).generation + 1;
+        }catch(const std::exception&){
+            // испорченный манифест все равно не восстановить, начинаем поколения заново
+        }
+    }
+    manifest.journal_segment = snapshot.journal_segment;
+    manifest.next_player_id = static_cast<std::uint32_t>(snapshot.next_player_id);
+    manifest.next_loot_id = snapshot.next_loot_id;
+    manifest.time_without_loot_ms = snapshot.time_without_loot.count();
+    manifest.random = snapshot.random;
+
+    auto shards = SplitByMap(snapshot);
+    manifest.shards.resize(shards.size());
+    std::vector<std::uint64_t> raw_sizes(shards.size());
+
+    auto workers_cpu = details::ParallelFor(shards.size(), [&](size_t i){
+        auto data = snapshot_file::EncodeSnapshot(shards[i]);
+        snapshot_file::FileHeader header;
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        auto& info = manifest.shards[i];
+        info.file_name = details::MakeShardName(manifest_path, manifest.generation, i);
+        info.body_crc = header.body_crc;
+        raw_sizes[i] = data.size();
+
+        auto path = dir / info.file_name;
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            snapshot_file::WriteSnapshotData(file, data, compression_level);
+            file.close();
+            // иначе манифест сослался бы на недописанную часть, а части прошлого поколения удалились бы
+            if(!file){
+                throw std::runtime_error("failed to write " + path.string());
+            }
+        }
+        info.file_size = std::filesystem::file_size(path);
+        details::SyncFile(path);
+    });
+
+    // манифест заменяется только когда все его части на диске
+    auto temp_path = dir / (manifest_path.filename().string() + ".tmp");
+    {
+        auto data = EncodeManifest(manifest);
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if(!file.flush()){
+            throw std::runtime_error("failed to write " + temp_path.string());
+        }
+    }
+    details::SyncFile(temp_path);
+    std::filesystem::rename(temp_path, manifest_path);
+    // переименование и новые части надежны только после fsync каталога; без него после сбоя питания
+    // мог бы остаться старый манифест, чьи части уже удалены ниже
+    details::SyncFile(dir.empty() ? std::filesystem::path{"."} : dir);
+
+    // части прошлых поколений и оборванных записей
+    std::unordered_set<std::string> current;
+    for(const auto& shard : manifest.shards){
+        current.insert(shard.file_name);
+    }
+    const auto manifest_name = manifest_path.filename().string();
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(dir.empty() ? "." : dir, ec)){
+        auto name = entry.path().filename().string();
+        if(details::IsShardName(name, manifest_name) && !current.contains(name)){
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    WriteResult result;
+    result.shards = shards.size();
+    for(size_t i = 0; i < shards.size(); ++i){
+        result.raw_bytes += raw_sizes[i];
+        result.file_bytes += manifest.shards[i].file_size;
+    }
+    result.cpu_time = details::GetThreadCpuTime() - cpu_start + workers_cpu;
+    return result;
+}
+
+Manifest RestoreShardedSnapshot(const std::filesystem::path& manifest_path
+                              , model::Game& game
+                              , players::Players& players
+                              , extra_data::LostObjectsOnMaps& lost_objects){
+    Manifest manifest = ReadManifest(manifest_path);
+    const auto dir = manifest_path.parent_path();
+
+    // чтение, проверка и сборка сессий идут параллельно, в модель части переносятся по очереди
+    std::vector<snapshot_file::PreparedState> prepared(manifest.shards.size());
+    details::ParallelFor(manifest.shards.size(), [&](size_t i){
+        const auto& shard = manifest.shards[i];
+        auto path = dir / shard.file_name;
+        if(!std::filesystem::exists(path) || std::filesystem::file_size(path) != shard.file_size){
+            details::ThrowInconsistent(shard.file_name + " is missing or has another size");
+        }
+
+        auto prepare = [&](const snapshot_file::SnapshotView& view){
+            if(view.GetHeader().body_crc != shard.body_crc){
+                details::ThrowInconsistent(shard.file_name + " belongs to another snapshot");
+            }
+            prepared[i] = snapshot_file::PrepareState(view, game);
+        };
+
+        if(snapshot_file::IsCompressedFile(path)){
+            auto data = snapshot_file::ReadCompressedSnapshot(path);
+            prepare(snapshot_file::SnapshotView::Parse(data.data(), data.size()));
+        }
+        else{
+            snapshot_file::MappedSnapshot mapped{path};
+            prepare(mapped.GetView());
+        }
+    });
+
+    for(auto& state : prepared){
+        snapshot_file::ApplyState(std::move(state), game, players, lost_objects);
+    }
+
+    players.SetNextId(std::max(players.GetNextId(), static_cast<int>(manifest.next_player_id)));
+    lost_objects.GetPossibleLoot().SetNextId(manifest.next_loot_id);
+    lost_objects.GetPossibleLoot().SetTimeWithoutLoot(std::chrono::milliseconds{manifest.time_without_loot_ms});
+    if(manifest.random.increment != 0){
+        game.SetRandomState(manifest.random);
+    }
+    return manifest;
+}
+
+std::uint64_t RestoreSnapshot(const std::filesystem::path& path
+                            , model::Game& game
+                            , players::Players& players
+                            , extra_data::LostObjectsOnMaps& lost_objects){
+    if(IsManifestFile(path)){
+        return RestoreShardedSnapshot(path, game, players, lost_objects).journal_segment;
+    }
+
+    // снимок одним файлом от прошлых версий сервера
+    if(snapshot_file::IsSnapshotFile(path)){
+        snapshot_file::MappedSnapshot snapshot{path};
+        snapshot_file::RestoreState(snapshot.GetView(), game, players, lost_objects);
+        return snapshot.GetView().GetHeader().journal_segment;
+    }
+
+    if(snapshot_file::IsCompressedFile(path)){
+        auto data = snapshot_file::ReadCompressedSnapshot(path);
+        auto view = snapshot_file::SnapshotView::Parse(data.data(), data.size());
+        snapshot_file::RestoreState(view, game, players, lost_objects);
+        return view.GetHeader().journal_segment;
+    }
+
+    // файл старого формата переводится в памяти, следующий снимок запишется уже в новом
+    std::ifstream in_file(path, std::ios::binary | std::ios::in);
+    auto data = snapshot_file::ConvertLegacySnapshot(in_file);
+    auto view = snapshot_file::SnapshotView::Parse(data.data(), data.size());
+    snapshot_file::RestoreState(view, game, players, lost_objects);
+    return view.GetHeader().journal_segment;
+}
+
+} // snapshot_shards
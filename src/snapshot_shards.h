@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "snapshot_file.h"
+
+/*
+ * Снимок, разбитый на части по игровым сессиям.
+ * Каждая карта (ее собаки, игроки и трофеи) пишется отдельным файлом в формате
+ * snapshot_file. Части кодируются, пишутся и восстанавливаются параллельно.
+ * Манифест по пути снимка перечисляет части текущего поколения с их размером и crc,
+ * он переписывается последним, поэтому набор частей всегда согласован.
+ */
+namespace snapshot_shards{
+
+constexpr std::uint32_t MANIFEST_VERSION = 2;
+
+struct ShardInfo{
+    // относительно каталога манифеста
+    std::string file_name;
+    std::uint64_t file_size = 0;
+    // body_crc из заголовка части
+    std::uint32_t body_crc = 0;
+};
+
+struct Manifest{
+    std::uint64_t generation = 0;
+    std::uint64_t journal_segment = 0;
+    std::uint32_t next_player_id = 0;
+    std::uint32_t next_loot_id = 0;
+    std::int64_t time_without_loot_ms = 0;
+    std::vector<ShardInfo> shards;
+    // с версии 2, в манифестах первой версии пустое
+    random_gen::Pcg32::State random;
+};
+
+std::vector<char> EncodeManifest(const Manifest& manifest);
+// бросает std::runtime_error, если данные не манифест или испорчены
+Manifest ParseManifest(const std::vector<char>& data);
+
+bool IsManifestFile(const std::filesystem::path& path);
+Manifest ReadManifest(const std::filesystem::path& path);
+
+// Делит снимок на части по картам. Общие счетчики остаются в манифесте
+std::vector<serialization::StateSnapshot> SplitByMap(const serialization::StateSnapshot& snapshot);
+
+struct WriteResult{
+    size_t shards = 0;
+    std::uint64_t raw_bytes = 0;
+    std::uint64_t file_bytes = 0;
+    // процессорное время всех потоков записи
+    std::chrono::microseconds cpu_time{0};
+};
+
+// Пишет части на диск (с fsync), затем атомарно заменяет манифест и удаляет части прошлого поколения
+WriteResult WriteShardedSnapshot(const std::filesystem::path& manifest_path
+                               , const serialization::StateSnapshot& snapshot
+                               , int compression_level);
+
+// Восстанавливает части параллельно и переносит их в модель. Возвращает манифест
+Manifest RestoreShardedSnapshot(const std::filesystem::path& manifest_path
+                              , model::Game& game
+                              , players::Players& players
+                              , extra_data::LostObjectsOnMaps& lost_objects);
+
+// Восстанавливает снимок любого формата: манифест частей, плоский файл, сжатый файл или архив
+// старых версий. Возвращает сегмент журнала, с которого продолжаются события
+std::uint64_t RestoreSnapshot(const std::filesystem::path& path
+                            , model::Game& game
+                            , players::Players& players
+                            , extra_data::LostObjectsOnMaps& lost_objects);
+
+} // snapshot_shards
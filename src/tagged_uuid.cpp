@@ -8,7 +8,9 @@ namespace util {
 namespace detail {
 
 UUIDType NewUUID() {
-    return boost::uuids::random_generator()();
+    // генератор дорог в создании (читает random_device), поэтому один на поток
+    thread_local boost::uuids::random_generator generator;
+    return generator();
 }
 
 std::string UUIDToString(const UUIDType& uuid) {
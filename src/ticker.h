@@ -0,0 +1,256 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "log_utils.h"
+
+namespace ticker{
+
+namespace net = boost::asio;
+using namespace std::literals;
+
+// Что делать, если тик сработал позже своего дедлайна больше чем на период
+enum class CatchUpPolicy{
+    MULTI_STEP, // догоняем несколькими шагами длины period, но не больше max_steps за раз
+    CLAMP,      // один шаг, дельта ограничена max_steps * period
+    SKIP        // пропущенные тики отбрасываются, один шаг длины period
+};
+
+inline std::optional<CatchUpPolicy> ParseCatchUpPolicy(std::string_view name){
+    if(name == "multi-step"sv){
+        return CatchUpPolicy::MULTI_STEP;
+    }
+    if(name == "clamp"sv){
+        return CatchUpPolicy::CLAMP;
+    }
+    if(name == "skip"sv){
+        return CatchUpPolicy::SKIP;
+    }
+    return std::nullopt;
+}
+
+struct TickStats{
+    std::uint64_t ticks = 0;          // количество шагов, выданных расписанием
+    std::uint64_t skipped_ticks = 0;  // периоды, отброшенные политикой догона
+    std::uint64_t failed_ticks = 0;   // вызовы handler, завершившиеся исключением
+    std::chrono::microseconds last_lag{0};
+    std::chrono::microseconds max_lag{0};
+    // сглаженные значения опоздания и джиттера (как в RFC 3550, коэффициент 1/16)
+    double mean_lag_us = 0;
+    double jitter_us = 0;
+};
+
+inline boost::json::value MakeTickStatsData(const TickStats& stats){
+    boost::json::object answer;
+    answer.insert(boost::json::object::value_type{"ticks", stats.ticks});
+    answer.insert(boost::json::object::value_type{"skipped_ticks", stats.skipped_ticks});
+    answer.insert(boost::json::object::value_type{"failed_ticks", stats.failed_ticks});
+    answer.insert(boost::json::object::value_type{"last_lag_us", stats.last_lag.count()});
+    answer.insert(boost::json::object::value_type{"max_lag_us", stats.max_lag.count()});
+    answer.insert(boost::json::object::value_type{"mean_lag_us", stats.mean_lag_us});
+    answer.insert(boost::json::object::value_type{"jitter_us", stats.jitter_us});
+    return answer;
+}
+
+/*
+ * Расписание тиков с фиксированным шагом.
+ * Дедлайны абсолютные: следующий дедлайн считается от предыдущего, а не от момента
+ * окончания обработки, поэтому длительность обработчика не сдвигает частоту тиков.
+ * Не зависит от asio, часы передаются параметром шаблона (для тестов - фиктивные).
+ */
+template <typename Clock>
+class TickScheduler{
+public:
+    using TimePoint = typename Clock::time_point;
+    using Duration = std::chrono::milliseconds;
+
+    // handler нужно вызвать count раз, каждый раз с дельтой delta
+    struct Steps{
+        unsigned count = 0;
+        Duration delta{0};
+    };
+
+    TickScheduler(Duration period, CatchUpPolicy policy, unsigned max_steps)
+        : period_(period)
+        , policy_(policy)
+        , max_steps_(std::max(1u, max_steps)){
+    }
+
+    void Start(TimePoint now){
+        next_deadline_ = now + period_;
+    }
+
+    TimePoint GetDeadline() const{
+        return next_deadline_;
+    }
+
+    Steps OnTimer(TimePoint now){
+        using namespace std::chrono;
+
+        auto lag = now > next_deadline_ ? duration_cast<microseconds>(now - next_deadline_) : 0us;
+        UpdateLagStats(lag);
+
+        // сколько периодов прошло с дедлайна, включая текущий
+        const std::uint64_t missed = 1 + static_cast<std::uint64_t>(lag / period_);
+        next_deadline_ += period_ * missed;
+
+        Steps steps;
+        std::uint64_t covered = 1; // сколько периодов покрывают выполненные шаги
+        switch (policy_){
+        case CatchUpPolicy::MULTI_STEP:
+            covered = std::min<std::uint64_t>(missed, max_steps_);
+            steps.count = static_cast<unsigned>(covered);
+            steps.delta = period_;
+            break;
+        case CatchUpPolicy::CLAMP:
+            covered = std::min<std::uint64_t>(missed, max_steps_);
+            steps.count = 1;
+            steps.delta = period_ * covered;
+            break;
+        case CatchUpPolicy::SKIP:
+            steps.count = 1;
+            steps.delta = period_;
+            break;
+        }
+
+        stats_.ticks += steps.count;
+        stats_.skipped_ticks += missed - covered;
+        return steps;
+    }
+
+    TickStats& GetStats(){
+        return stats_;
+    }
+
+    const TickStats& GetStats() const{
+        return stats_;
+    }
+
+private:
+    void UpdateLagStats(std::chrono::microseconds lag){
+        const double lag_us = static_cast<double>(lag.count());
+        if(timer_fires_++ == 0){
+            stats_.mean_lag_us = lag_us;
+        }
+        else{
+            stats_.jitter_us += (std::abs(lag_us - static_cast<double>(stats_.last_lag.count())) - stats_.jitter_us) / 16.;
+            stats_.mean_lag_us += (lag_us - stats_.mean_lag_us) / 16.;
+        }
+        stats_.last_lag = lag;
+        stats_.max_lag = std::max(stats_.max_lag, lag);
+    }
+
+    Duration period_;
+    CatchUpPolicy policy_;
+    unsigned max_steps_;
+    TimePoint next_deadline_{};
+    std::uint64_t timer_fires_ = 0;
+    TickStats stats_;
+};
+
+class Ticker : public std::enable_shared_from_this<Ticker> {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+    using Handler = std::function<void(std::chrono::milliseconds delta)>;
+    using StatsHandler = std::function<void(const TickStats& stats)>;
+
+    // Функция handler будет вызываться внутри strand с интервалом period
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler
+          , CatchUpPolicy policy = CatchUpPolicy::MULTI_STEP, unsigned max_steps = 5)
+        : strand_{strand}
+        , scheduler_{period, policy, max_steps}
+        , handler_{std::move(handler)} {
+    }
+
+    // Функция stats_handler будет вызываться внутри strand не чаще, чем раз в period
+    void SetStatsHandler(std::chrono::milliseconds period, StatsHandler stats_handler){
+        stats_period_ = period;
+        stats_handler_ = std::move(stats_handler);
+    }
+
+    void Start() {
+        net::dispatch(strand_, [self = shared_from_this()] {
+            self->scheduler_.Start(Clock::now());
+            self->last_stats_ = Clock::now();
+            self->ScheduleTick();
+        });
+    }
+
+    // Вызывать только внутри strand
+    const TickStats& GetStats() const{
+        return scheduler_.GetStats();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void ScheduleTick() {
+        assert(strand_.running_in_this_thread());
+        timer_.expires_at(scheduler_.GetDeadline());
+        timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+            self->OnTick(ec);
+        });
+    }
+
+    void OnTick(boost::system::error_code ec) {
+        assert(strand_.running_in_this_thread());
+
+        if (!ec) {
+            auto now = Clock::now();
+            auto steps = scheduler_.OnTimer(now);
+            for(unsigned i = 0; i < steps.count; ++i){
+                RunHandler(steps.delta);
+            }
+            ReportStats(now);
+            ScheduleTick();
+        }
+    }
+
+    void RunHandler(std::chrono::milliseconds delta){
+        auto& stats = scheduler_.GetStats();
+        try {
+            handler_(delta);
+        } catch (const std::exception& e) {
+            ++stats.failed_ticks;
+            BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                    << logging::add_value(additional_data, log_data::MakeErrorData(0, e.what(), "tick"))
+                                    << "error";
+        } catch (...) {
+            ++stats.failed_ticks;
+            BOOST_LOG_TRIVIAL(error) << logging::add_value(timestamp, boost::posix_time::second_clock::local_time())
+                                    << logging::add_value(additional_data, log_data::MakeErrorData(0, "unknown exception", "tick"))
+                                    << "error";
+        }
+    }
+
+    void ReportStats(Clock::time_point now){
+        if(!stats_handler_ || now - last_stats_ < stats_period_){
+            return;
+        }
+        last_stats_ = now;
+        stats_handler_(scheduler_.GetStats());
+    }
+
+    Strand strand_;
+    TickScheduler<Clock> scheduler_;
+    net::steady_timer timer_{strand_};
+    Handler handler_;
+    StatsHandler stats_handler_;
+    std::chrono::milliseconds stats_period_{0};
+    Clock::time_point last_stats_;
+};
+
+} // ticker
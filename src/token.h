@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace players{
+
+/*
+ * Токен игрока - 128 случайных бит.
+ * Клиенту и в файлы снимков и журнала он уходит строкой из 32 шестнадцатеричных
+ * символов. Разбор и печать идут по таблицам, без выделения памяти.
+ */
+class Token{
+public:
+    static constexpr size_t HEX_SIZE = 32;
+    using HexChars = std::array<char, HEX_SIZE>;
+
+    constexpr Token() = default;
+    constexpr Token(std::uint64_t high, std::uint64_t low) : high_(high), low_(low){}
+
+    // nullopt, если строка не из 32 шестнадцатеричных символов (регистр не важен)
+    static constexpr std::optional<Token> Parse(std::string_view hex) noexcept{
+        if(hex.size() != HEX_SIZE){
+            return std::nullopt;
+        }
+        std::uint64_t half[2] = {0, 0};
+        for(size_t i = 0; i < HEX_SIZE; ++i){
+            std::uint8_t digit = HEX_DIGITS[static_cast<unsigned char>(hex[i])];
+            if(digit == INVALID_DIGIT){
+                return std::nullopt;
+            }
+            half[i / 16] = half[i / 16] << 4 | digit;
+        }
+        return Token{half[0], half[1]};
+    }
+
+    // 32 символа в нижнем регистре, по паре символов на байт
+    constexpr HexChars ToChars() const noexcept{
+        HexChars chars{};
+        for(int i = 0; i < 8; ++i){
+            const auto* high = HEX_PAIRS[(high_ >> (56 - 8 * i)) & 0xFF];
+            const auto* low = HEX_PAIRS[(low_ >> (56 - 8 * i)) & 0xFF];
+            chars[2 * i] = high[0];
+            chars[2 * i + 1] = high[1];
+            chars[16 + 2 * i] = low[0];
+            chars[16 + 2 * i + 1] = low[1];
+        }
+        return chars;
+    }
+
+    std::string ToString() const{
+        auto chars = ToChars();
+        return std::string(chars.data(), chars.size());
+    }
+
+    constexpr std::uint64_t GetHigh() const noexcept{
+        return high_;
+    }
+
+    constexpr std::uint64_t GetLow() const noexcept{
+        return low_;
+    }
+
+    constexpr auto operator<=>(const Token&) const = default;
+
+private:
+    static constexpr std::uint8_t INVALID_DIGIT = 0xFF;
+
+    static constexpr std::array<std::uint8_t, 256> HEX_DIGITS = []{
+        std::array<std::uint8_t, 256> digits{};
+        digits.fill(INVALID_DIGIT);
+        for(int i = 0; i < 10; ++i){
+            digits['0' + i] = static_cast<std::uint8_t>(i);
+        }
+        for(int i = 0; i < 6; ++i){
+            digits['a' + i] = static_cast<std::uint8_t>(10 + i);
+            digits['A' + i] = static_cast<std::uint8_t>(10 + i);
+        }
+        return digits;
+    }();
+
+    static constexpr std::array<char[2], 256> HEX_PAIRS = []{
+        constexpr char alphabet[] = "0123456789abcdef";
+        std::array<char[2], 256> pairs{};
+        for(int i = 0; i < 256; ++i){
+            pairs[i][0] = alphabet[i >> 4];
+            pairs[i][1] = alphabet[i & 0xF];
+        }
+        return pairs;
+    }();
+
+    std::uint64_t high_ = 0;
+    std::uint64_t low_ = 0;
+};
+
+// Токены случайны, поэтому достаточно перемешать половины, чтобы все биты влияли на корзину
+struct TokenHasher{
+    size_t operator()(const Token& token) const noexcept{
+        std::uint64_t hash = token.GetHigh() ^ (token.GetLow() * 0x9E3779B97F4A7C15ull);
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+} // players
@@ -0,0 +1,59 @@
+#include "view_grid.h"
+
+#include <algorithm>
+
+namespace view_grid{
+
+namespace {
+
+void FindNear(const collision_detector::SpatialHash& index, geom::Point2D center, double radius, std::vector<size_t>& found){
+    found.clear();
+    index.ForEachNear(center, center, radius, [&](size_t id, geom::Point2D position){
+        const double dx = position.x - center.x;
+        const double dy = position.y - center.y;
+        if(dx * dx + dy * dy <= radius * radius){
+            found.push_back(id);
+        }
+    });
+    std::sort(found.begin(), found.end());
+}
+
+} // namespace
+
+ViewGrid::ViewGrid(double view_radius)
+    : view_radius_(view_radius)
+    , dogs_(view_radius, dogs_bucket_count_)
+    , loot_(view_radius, loot_bucket_count_){
+}
+
+void ViewGrid::Reset(collision_detector::SpatialHash& index, size_t& bucket_count, size_t count) const{
+    if(count <= bucket_count){
+        index.Clear();
+        return;
+    }
+    bucket_count = count;
+    index = collision_detector::SpatialHash{view_radius_, bucket_count};
+}
+
+void ViewGrid::Rebuild(const model::GameSession::Dogs& dogs, const extra_data::Loot& loot){
+    Reset(dogs_, dogs_bucket_count_, dogs.size());
+    dogs_.Reserve(dogs.size());
+    for(size_t position = 0; position < dogs.size(); ++position){
+        const model::Coordinates coords = dogs[position].GetCoords();
+        dogs_.Insert(position, geom::Point2D(coords.x, coords.y));
+    }
+
+    Reset(loot_, loot_bucket_count_, loot.size());
+    loot_.Reserve(loot.size());
+    for(size_t position = 0; position < loot.size(); ++position){
+        loot_.Insert(position, geom::Point2D(loot[position].coords.x, loot[position].coords.y));
+    }
+}
+
+void ViewGrid::FindVisible(model::Coordinates center, Visible& visible) const{
+    const geom::Point2D point(center.x, center.y);
+    FindNear(dogs_, point, view_radius_, visible.dogs);
+    FindNear(loot_, point, view_radius_, visible.loot);
+}
+
+} // view_grid
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "collision_detector.h"
+#include "extra_data.h"
+#include "model.h"
+
+namespace view_grid{
+
+// Что видно игроку: позиции в GetDogs() сессии и в трофеях карты, по возрастанию
+struct Visible{
+    std::vector<size_t> dogs;
+    std::vector<size_t> loot;
+};
+
+/*
+ * Сетка обзора одной карты: собаки и трофеи в пространственных хешах с ячейкой в радиус обзора.
+ * Круг обзора задевает не больше 3x3 ячеек, поэтому запрос зависит от плотности рядом
+ * с игроком, а не от размера сессии. Позиции не отслеживаются - после изменения мира сетка перестраивается
+ */
+class ViewGrid{
+public:
+    explicit ViewGrid(double view_radius);
+
+    void Rebuild(const model::GameSession::Dogs& dogs, const extra_data::Loot& loot);
+
+    // собаки и трофеи в круге радиуса обзора вокруг center
+    void FindVisible(model::Coordinates center, Visible& visible) const;
+
+    double GetViewRadius() const{
+        return view_radius_;
+    }
+
+private:
+    // корзин не меньше, чем предметов, иначе списки в корзинах растут вместе с сессией
+    void Reset(collision_detector::SpatialHash& index, size_t& bucket_count, size_t count) const;
+
+    double view_radius_;
+    size_t dogs_bucket_count_ = collision_detector::SpatialHash::DEFAULT_BUCKET_COUNT;
+    size_t loot_bucket_count_ = collision_detector::SpatialHash::DEFAULT_BUCKET_COUNT;
+    collision_detector::SpatialHash dogs_;
+    collision_detector::SpatialHash loot_;
+};
+
+} // view_grid
@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "../src/collision_detector.h"
+
+using namespace collision_detector;
+
+namespace {
+
+class VectorProvider : public ItemGathererProvider {
+public:
+    VectorProvider(const std::vector<Item>& items, const std::vector<Gatherer>& gatherers)
+        : items_(items)
+        , gatherers_(gatherers) {
+    }
+
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+
+    Item GetItem(size_t idx) const override {
+        return items_[idx];
+    }
+
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+
+    Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_[idx];
+    }
+
+private:
+    const std::vector<Item>& items_;
+    const std::vector<Gatherer>& gatherers_;
+};
+
+// порядок событий с равным временем не задан, сравниваем как множества
+std::vector<std::tuple<size_t, size_t>> Pairs(const std::vector<GatheringEvent>& events) {
+    std::vector<std::tuple<size_t, size_t>> pairs;
+    for (const auto& event : events) {
+        pairs.emplace_back(event.item_id, event.gatherer_id);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+}  // namespace
+
+SCENARIO("Spatial hash gathering") {
+    std::mt19937 generator{7};
+    std::uniform_real_distribution<double> coord{0, 50};
+    std::uniform_real_distribution<double> step{-6, 6};
+
+    std::vector<Item> items;
+    SpatialHash hash;
+    for (size_t id = 0; id < 200; ++id) {
+        geom::Point2D position{coord(generator), coord(generator)};
+        items.push_back(Item{position, 0});
+        hash.Insert(id, position);
+    }
+
+    std::vector<Gatherer> gatherers;
+    for (int i = 0; i < 100; ++i) {
+        geom::Point2D start{coord(generator), coord(generator)};
+        // как собаки на дорогах: движение по одной оси
+        geom::Point2D end = i % 2 == 0 ? geom::Point2D{start.x + step(generator), start.y}
+                                       : geom::Point2D{start.x, start.y + step(generator)};
+        gatherers.push_back(Gatherer{start, end, 0.6});
+    }
+    // путь длиннее числа корзин - перебор всех предметов
+    gatherers.push_back(Gatherer{{0, 25}, {1000, 25}, 0.6});
+
+    WHEN("gathering events are searched through the hash") {
+        std::vector<GatheringEvent> events;
+        FindGatherEvents(hash, gatherers, events);
+
+        THEN("they match the brute-force search") {
+            auto expected = FindGatherEvents(VectorProvider{items, gatherers});
+            REQUIRE(!expected.empty());
+            CHECK(Pairs(events) == Pairs(expected));
+            CHECK(std::is_sorted(events.begin(), events.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.time < rhs.time;
+            }));
+        }
+    }
+
+    WHEN("items are removed and others take their ids") {
+        for (size_t id = 0; id < items.size(); id += 3) {
+            hash.Erase(id);
+            items[id].position = {coord(generator), coord(generator)};
+            hash.Insert(id, items[id].position);
+        }
+        for (size_t id = 1; id < items.size(); id += 3) {
+            hash.Erase(id);
+            // далеко за пределами путей: в переборе предмет тоже не найдется
+            items[id].position = {-1000, -1000};
+        }
+
+        THEN("the hash follows the changes") {
+            CHECK(hash.Size() == items.size() - (items.size() + 1) / 3);
+            std::vector<GatheringEvent> events;
+            FindGatherEvents(hash, gatherers, events);
+            CHECK(Pairs(events) == Pairs(FindGatherEvents(VectorProvider{items, gatherers})));
+        }
+    }
+}
@@ -0,0 +1,219 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include "../src/game_tick.h"
+#include "../src/journal.h"
+#include "test_world.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+namespace {
+
+struct TempJournalDir {
+    TempJournalDir()
+        : path{fs::temp_directory_path() / ("journal-test-"s + domain::RecordId::New().ToString())} {
+    }
+
+    ~TempJournalDir() {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    fs::path path;
+};
+
+journal::JournalConfig MakeConfig(const fs::path& dir) {
+    journal::JournalConfig config;
+    config.dir = dir;
+    config.commit_interval = 1ms;
+    return config;
+}
+
+std::vector<journal::Event> ReplayAll(const fs::path& dir, std::uint64_t first_segment = 0) {
+    std::vector<journal::Event> events;
+    journal::Journal{MakeConfig(dir)}.Replay(first_segment, [&events](const journal::Event& event) {
+        events.push_back(event);
+    });
+    return events;
+}
+
+// Мир для повтора журнала: дорога с офисом посередине и трофеями одного вида
+struct ReplayWorld {
+    model::Game game = test_world::MakeRoadGame(30, true);
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = test_world::MakePossibleLoot(1s, {{"map1"s, 1}});
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+    objects_collector::CollectorBuffers buffers;
+};
+
+// собаки и трофеи мира в порядке обхода
+std::vector<double> Snapshot(const ReplayWorld& world) {
+    std::vector<double> values;
+    for (const auto& session : world.game.GetGameSession()) {
+        for (const auto& dog : session.GetDogs()) {
+            values.insert(values.end(), {dog.GetCoords().x, dog.GetCoords().y, double(dog.GetScore()), double(dog.GetBag().size())});
+        }
+    }
+    for (const auto& object : world.lost_objects.GetLostObjects("map1"s)) {
+        values.insert(values.end(), {double(object.id), object.coords.x, object.coords.y});
+    }
+    return values;
+}
+
+}  // namespace
+
+SCENARIO("Journal replays appended events in order") {
+    TempJournalDir dir;
+    auto record_id = domain::RecordId::New();
+    const players::Token token{0x0123456789abcdefull, 0xfedcba9876543210ull};
+
+    GIVEN("a journal with events of every kind") {
+        {
+            journal::Journal journal{MakeConfig(dir.path)};
+            journal.Start();
+            journal.Append(journal::JoinEvent{"map1"s, "Rex"s, token, 3, model::Coordinates{1.5, -2.25}});
+            journal.Append(journal::MoveEvent{token, 'L'});
+            journal.Append(std::vector<journal::Event>{journal::TickEvent{50, 42u},
+                                                       journal::RetireEvent{{domain::Record{record_id, "Rex"s, 7, 1500}}}});
+            journal.Append(journal::MoveEvent{token, '\0'});
+            journal.Flush();
+
+            THEN("flushed events are counted in stats") {
+                CHECK(journal.GetStats().events == 5);
+                CHECK(journal.GetStats().failed_commits == 0);
+            }
+        }
+
+        WHEN("the journal is replayed") {
+            auto events = ReplayAll(dir.path);
+
+            THEN("all fields survive the round trip") {
+                REQUIRE(events.size() == 5);
+
+                const auto& join = std::get<journal::JoinEvent>(events[0]);
+                CHECK(join.map_id == "map1"s);
+                CHECK(join.dog_name == "Rex"s);
+                CHECK(join.token == token);
+                CHECK(join.player_id == 3);
+                CHECK(join.pos.x == 1.5);
+                CHECK(join.pos.y == -2.25);
+
+                CHECK(std::get<journal::MoveEvent>(events[1]).token == token);
+                CHECK(std::get<journal::MoveEvent>(events[1]).direction == 'L');
+
+                const auto& tick = std::get<journal::TickEvent>(events[2]);
+                CHECK(tick.delta == 50);
+                CHECK(tick.seed == 42u);
+
+                const auto& retire = std::get<journal::RetireEvent>(events[3]);
+                REQUIRE(retire.records.size() == 1);
+                CHECK(retire.records[0].GetId() == record_id);
+                CHECK(retire.records[0].GetDogName() == "Rex"s);
+                CHECK(retire.records[0].GetScore() == 7);
+                CHECK(retire.records[0].GetTime() == 1500);
+
+                CHECK(std::get<journal::MoveEvent>(events[4]).direction == '\0');
+            }
+        }
+    }
+}
+
+SCENARIO("Journal segments follow snapshots") {
+    TempJournalDir dir;
+    journal::Journal journal{MakeConfig(dir.path)};
+    journal.Start();
+    journal.Append(journal::TickEvent{10, 1u});
+
+    GIVEN("a rotation taken together with a snapshot") {
+        auto segment = journal.Rotate();
+        journal.Append(journal::TickEvent{20, 2u});
+        journal.Flush();
+
+        THEN("replay from the marker skips events already in the snapshot") {
+            auto events = ReplayAll(dir.path, segment);
+            REQUIRE(events.size() == 1);
+            CHECK(std::get<journal::TickEvent>(events[0]).delta == 20);
+        }
+
+        WHEN("old segments are dropped") {
+            journal.DropSegmentsBefore(segment);
+
+            THEN("only events after the snapshot remain") {
+                CHECK(ReplayAll(dir.path).size() == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Journal skips a torn tail") {
+    TempJournalDir dir;
+    {
+        journal::Journal journal{MakeConfig(dir.path)};
+        journal.Start();
+        journal.Append(journal::TickEvent{10, 1u});
+        journal.Append(journal::TickEvent{20, 2u});
+    }
+    auto segment_path = dir.path / "journal-1.log";
+    REQUIRE(fs::exists(segment_path));
+    fs::resize_file(segment_path, fs::file_size(segment_path) - 1);
+
+    GIVEN("a restart after the crash") {
+        {
+            journal::Journal journal{MakeConfig(dir.path)};
+            CHECK(journal.Replay(0, [](const journal::Event&) {}) == 1);
+            journal.Start();
+            journal.Append(journal::TickEvent{30, 3u});
+        }
+
+        THEN("events written after the restart are replayed too") {
+            auto events = ReplayAll(dir.path);
+            REQUIRE(events.size() == 2);
+            CHECK(std::get<journal::TickEvent>(events[0]).delta == 10);
+            CHECK(std::get<journal::TickEvent>(events[1]).delta == 30);
+        }
+    }
+}
+
+SCENARIO("Journal replay repeats the game") {
+    constexpr int retired_time = 60000;
+    ReplayWorld live;
+    live.game.SetRandomSeed(11);
+    std::vector<journal::Event> events;
+
+    // то же, что делает ApiRequestHandler: входы, действия и тики с seed'ами
+    auto* session = live.game.AddGameSession("map1"s);
+    for (const auto& name : {"Rex"s, "Buddy"s}) {
+        const auto* player = live.players.AddPlayer(name, session);
+        const auto* dog = session->FindDog(player->GetDog());
+        events.push_back(journal::JoinEvent{"map1"s, name, player->GetToken(), player->GetPlayerId(), dog->GetCoords()});
+    }
+    std::vector<players::Token> tokens;
+    for (const auto& player : live.players.GetPlayers()) {
+        tokens.push_back(player.GetToken());
+    }
+    for (int tick = 0; tick < 200; ++tick) {
+        if (tick % 25 == 0) {
+            for (size_t i = 0; i < tokens.size(); ++i) {
+                char direction = (tick / 25 + i) % 2 == 0 ? 'R' : 'L';
+                game_tick::ApplyMove(live.game, *live.players.FindByToken(tokens[i]), direction);
+                events.push_back(journal::MoveEvent{tokens[i], direction});
+            }
+        }
+        std::uint32_t seed = live.game.NextTickSeed();
+        game_tick::Simulate(live.game, live.players, live.lost_objects, live.buffers, 100, retired_time);
+        events.push_back(journal::TickEvent{100, seed});
+    }
+
+    WHEN("the events are applied to an empty game") {
+        ReplayWorld replay;
+        for (const auto& event : events) {
+            game_tick::ApplyEvent(replay.game, replay.players, replay.lost_objects, replay.buffers, retired_time, event);
+        }
+
+        THEN("dogs and loot end up in the same state") {
+            CHECK(!live.lost_objects.GetLostObjects("map1"s).empty());
+            CHECK(Snapshot(replay) == Snapshot(live));
+        }
+    }
+}
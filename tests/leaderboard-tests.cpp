@@ -0,0 +1,215 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../src/leaderboard.h"
+
+using namespace std::literals;
+namespace {
+
+domain::Record MakeRecord(const std::string& name, int score, int play_time) {
+    return domain::Record{domain::RecordId::New(), name, score, play_time};
+}
+
+std::vector<std::string> GetNames(const std::vector<domain::Record>& records) {
+    std::vector<std::string> names;
+    for (const auto& record : records) {
+        names.push_back(record.GetDogName());
+    }
+    return names;
+}
+
+// вся таблица, пройденная по курсорам страницами по page_size
+std::vector<domain::Record> ReadByCursor(const leaderboard::Leaderboard& leaderboard, size_t page_size) {
+    auto page = leaderboard.GetPage(0, page_size);
+    std::vector<domain::Record> records = page.records;
+    while (page.next_cursor) {
+        auto cursor = leaderboard::DecodeCursor(*page.next_cursor);
+        REQUIRE(cursor);
+        page = leaderboard.GetPageAfter(*cursor, page_size);
+        records.insert(records.end(), page.records.begin(), page.records.end());
+    }
+    return records;
+}
+
+}  // namespace
+
+SCENARIO("Leaderboard keeps records sorted") {
+    leaderboard::Leaderboard leaderboard;
+
+    GIVEN("records added in several batches") {
+        leaderboard.Add({MakeRecord("Rex"s, 10, 5000), MakeRecord("Buddy"s, 30, 7000)});
+        leaderboard.Add({MakeRecord("Max"s, 20, 1000), MakeRecord("Bella"s, 30, 2000), MakeRecord("Ace"s, 10, 5000)});
+        leaderboard.Add({MakeRecord("Zed"s, 40, 9000)});
+
+        THEN("they are ordered by score desc, then play time, then name") {
+            auto page = leaderboard.GetPage(0, 100);
+            CHECK(GetNames(page.records) == std::vector{"Zed"s, "Bella"s, "Buddy"s, "Max"s, "Ace"s, "Rex"s});
+            CHECK(leaderboard.GetSize() == 6);
+            CHECK_FALSE(page.next_cursor);
+        }
+
+        THEN("pages by offset are slices of the table") {
+            CHECK(GetNames(leaderboard.GetPage(2, 2).records) == std::vector{"Buddy"s, "Max"s});
+            CHECK(leaderboard.GetPage(6, 2).records.empty());
+        }
+    }
+
+    GIVEN("a large unsorted batch after a sorted one") {
+        std::vector<domain::Record> first;
+        std::vector<domain::Record> second;
+        for (int i = 0; i < 500; ++i) {
+            first.push_back(MakeRecord("dog "s + std::to_string(i), i, 100));
+            second.push_back(MakeRecord("dog "s + std::to_string(i), (i * 37) % 500, i));
+        }
+        leaderboard.Add(first);
+        leaderboard.Add(second);
+
+        THEN("the merged table is fully sorted") {
+            auto records = leaderboard.GetPage(0, 1000).records;
+            REQUIRE(records.size() == 1000);
+            bool sorted = true;
+            for (size_t i = 1; i < records.size(); ++i) {
+                const auto& prev = records[i - 1];
+                const auto& cur = records[i];
+                if (prev.GetScore() < cur.GetScore() || (prev.GetScore() == cur.GetScore() && prev.GetTime() > cur.GetTime())) {
+                    sorted = false;
+                }
+            }
+            CHECK(sorted);
+        }
+    }
+}
+
+SCENARIO("Leaderboard ignores repeated records") {
+    leaderboard::Leaderboard leaderboard;
+    auto rex = MakeRecord("Rex"s, 10, 5000);
+    auto max = MakeRecord("Max"s, 20, 1000);
+
+    GIVEN("a table with two records") {
+        leaderboard.Add({rex, max});
+        const auto version = leaderboard.GetVersion();
+
+        WHEN("the same records are added again") {
+            leaderboard.Add({max, rex});
+
+            THEN("the table and its version do not change") {
+                CHECK(leaderboard.GetSize() == 2);
+                CHECK(leaderboard.GetVersion() == version);
+                CHECK(leaderboard.Contains(rex.GetId()));
+            }
+        }
+
+        WHEN("a batch repeats a new record") {
+            auto buddy = MakeRecord("Buddy"s, 30, 7000);
+            leaderboard.Add({buddy, rex, buddy});
+
+            THEN("it is added once and the version changes") {
+                CHECK(GetNames(leaderboard.GetPage(0, 10).records) == std::vector{"Buddy"s, "Max"s, "Rex"s});
+                CHECK(leaderboard.GetVersion() != version);
+            }
+        }
+    }
+}
+
+SCENARIO("Leaderboard cursors") {
+    GIVEN("a record with dots and non-ASCII characters in the name") {
+        auto record = MakeRecord("Mr. Dog.\xD0\xA8\xD0\xB0\xD1\x80\xD0\xB8\xD0\xBA"s, -5, 123);
+
+        WHEN("its cursor is encoded and decoded") {
+            auto cursor = leaderboard::DecodeCursor(leaderboard::EncodeCursor(record));
+
+            THEN("the full sort key is restored") {
+                REQUIRE(cursor);
+                CHECK(cursor->score == -5);
+                CHECK(cursor->play_time == 123);
+                CHECK(cursor->name == record.GetDogName());
+                CHECK(cursor->id == record.GetId());
+            }
+        }
+    }
+
+    GIVEN("a record with an empty name") {
+        auto record = MakeRecord(""s, 0, 0);
+
+        THEN("its cursor is decoded too") {
+            auto cursor = leaderboard::DecodeCursor(leaderboard::EncodeCursor(record));
+            REQUIRE(cursor);
+            CHECK(cursor->name.empty());
+        }
+    }
+
+    GIVEN("malformed cursors") {
+        const std::string id = domain::RecordId::New().ToString();
+
+        THEN("they are rejected") {
+            CHECK_FALSE(leaderboard::DecodeCursor(""sv));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20"sv));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20." + id));
+            CHECK_FALSE(leaderboard::DecodeCursor("x10.20." + id + ".52"));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20abc." + id + ".52"));
+            CHECK_FALSE(leaderboard::DecodeCursor("99999999999.20." + id + ".52"));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20.not-a-uuid.52"sv));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20." + id + ".5"));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20." + id + ".zz"));
+            CHECK_FALSE(leaderboard::DecodeCursor("10.20." + id + ".52.53"));
+        }
+    }
+
+    GIVEN("a table with equal scores") {
+        leaderboard::Leaderboard leaderboard;
+        std::vector<domain::Record> records;
+        for (int i = 0; i < 23; ++i) {
+            records.push_back(MakeRecord("dog"s, i % 3, i % 2));
+        }
+        leaderboard.Add(records);
+
+        THEN("walking by cursors returns the same records as one big page") {
+            CHECK(GetNames(ReadByCursor(leaderboard, 5)) == GetNames(leaderboard.GetPage(0, 100).records));
+            auto by_cursor = ReadByCursor(leaderboard, 4);
+            auto whole = leaderboard.GetPage(0, 100).records;
+            REQUIRE(by_cursor.size() == whole.size());
+            bool same_ids = true;
+            for (size_t i = 0; i < whole.size(); ++i) {
+                same_ids = same_ids && by_cursor[i].GetId() == whole[i].GetId();
+            }
+            CHECK(same_ids);
+        }
+
+        WHEN("records are added before the cursor position") {
+            auto page = leaderboard.GetPage(0, 10);
+            REQUIRE(page.next_cursor);
+            leaderboard.Add({MakeRecord("top"s, 100, 0)});
+            auto cursor = leaderboard::DecodeCursor(*page.next_cursor);
+            REQUIRE(cursor);
+
+            THEN("the next page continues right after the last seen record") {
+                auto next = leaderboard.GetPageAfter(*cursor, 10);
+                auto expected = leaderboard.GetPage(11, 10);
+                REQUIRE(next.records.size() == expected.records.size());
+                CHECK(next.records.front().GetId() == expected.records.front().GetId());
+                CHECK(next.version == leaderboard.GetVersion());
+            }
+        }
+    }
+}
+
+SCENARIO("Leaderboard ETags") {
+    GIVEN("two tables with the same version, as after a restart") {
+        leaderboard::Leaderboard before_restart;
+        leaderboard::Leaderboard after_restart;
+        REQUIRE(before_restart.GetVersion() == after_restart.GetVersion());
+
+        THEN("their ETags differ") {
+            CHECK(before_restart.MakeETag(before_restart.GetVersion()) != after_restart.MakeETag(after_restart.GetVersion()));
+        }
+
+        THEN("the ETag of a table changes only with its version") {
+            const auto etag = before_restart.MakeETag(before_restart.GetVersion());
+            CHECK(before_restart.MakeETag(before_restart.GetVersion()) == etag);
+            before_restart.Add({MakeRecord("Rex"s, 10, 5000)});
+            CHECK(before_restart.MakeETag(before_restart.GetVersion()) != etag);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "../src/extra_data.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<unsigned> LootIds(const extra_data::Loot& loot) {
+    std::vector<unsigned> ids;
+    for (const auto& object : loot) {
+        ids.push_back(object.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+}  // namespace
+
+SCENARIO("Lost objects removal") {
+    extra_data::PossibleLootOnMapsToGenerate possible_loot{5s, 0.5};
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+
+    std::vector<extra_data::LostObject> objects;
+    for (unsigned id = 0; id < 6; ++id) {
+        objects.push_back(extra_data::LostObject{id, id % 2, {static_cast<double>(id), 0}});
+    }
+    lost_objects.SetLostObjects("map1"s, std::move(objects));
+
+    WHEN("several objects are picked up in one tick") {
+        // позиции по возрастанию, как их собирает CollectObjects
+        std::vector<size_t> positions{0, 2, 5};
+        lost_objects.EraseLostObjectsOnMap("map1"s, positions.begin(), positions.end());
+
+        THEN("exactly those objects are gone and the rest keep their ids") {
+            const auto& loot = lost_objects.GetLostObjects("map1"s);
+            CHECK(loot.size() == 3);
+            CHECK(LootIds(loot) == std::vector<unsigned>{1, 3, 4});
+            for (const auto& object : loot) {
+                CHECK(object.coords.x == static_cast<double>(object.id));
+            }
+        }
+
+        THEN("the spatial index follows the moved objects") {
+            const auto& loot = lost_objects.GetLostObjects("map1"s);
+            const auto& index = lost_objects.GetLostObjectsIndex("map1"s);
+            CHECK(index.Size() == loot.size());
+            for (size_t position = 0; position < loot.size(); ++position) {
+                geom::Point2D point{loot[position].coords.x, loot[position].coords.y};
+                bool is_found = false;
+                index.ForEachNear(point, point, 0.1, [&](size_t id, geom::Point2D found) {
+                    is_found = is_found || (id == position && found == point);
+                });
+                CHECK(is_found);
+            }
+        }
+
+        AND_WHEN("the remaining objects are picked up") {
+            std::vector<size_t> rest{0, 1, 2};
+            lost_objects.EraseLostObjectsOnMap("map1"s, rest.begin(), rest.end());
+
+            THEN("the map is empty") {
+                CHECK(lost_objects.GetLostObjects("map1"s).empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/player.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+// тик без движения: простой всех собак растет на delta
+void IdleTick(GameSession& session, int delta) {
+    for (auto& dog : session.GetDogs()) {
+        dog.AddAfkTime(delta);
+    }
+}
+
+}  // namespace
+
+SCENARIO("AFK players retirement") {
+    Game game;
+    game.AddMap(Map{Map::Id{"map1"s}, "Map 1"s, 1.0, 3});
+    game.SetRandomGenerate(false);
+    auto* session = game.AddGameSession("map1"s);
+
+    players::Players players;
+    // указатели на игроков живут до следующего добавления, дальше нужны только токены и id
+    const auto rex_token = players.AddPlayer("Rex"s, session)->GetToken();
+    const auto* buddy = players.AddPlayer("Buddy"s, session);
+    const auto buddy_token = buddy->GetToken();
+    const int buddy_id = buddy->GetId();
+    constexpr int retired_time = 1000;
+
+    GIVEN("players idle for less than the retirement time") {
+        IdleTick(*session, 600);
+        THEN("nobody retires") {
+            CHECK(players.EraseRetiredPlayers(game, 600, retired_time).empty());
+        }
+    }
+
+    GIVEN("one player who moved in the middle") {
+        IdleTick(*session, 600);
+        players.EraseRetiredPlayers(game, 600, retired_time);
+        session->FindDogById(buddy_id)->ClearAfkTime();
+
+        WHEN("the retirement time since the first join passes") {
+            IdleTick(*session, 400);
+            auto retired = players.EraseRetiredPlayers(game, 400, retired_time);
+
+            THEN("only the idle player retires") {
+                REQUIRE(retired.size() == 1);
+                CHECK(retired[0].session == session->GetHandle());
+                CHECK(game.FindDog(retired[0])->GetId() == 0);
+                CHECK(players.FindByToken(rex_token) == nullptr);
+                CHECK(players.FindByToken(buddy_token) != nullptr);
+            }
+
+            AND_WHEN("the player who moved stays idle for the full time") {
+                IdleTick(*session, 500);
+                players.EraseRetiredPlayers(game, 500, retired_time);
+                CHECK(players.FindByToken(buddy_token) != nullptr);
+
+                IdleTick(*session, 100);
+                auto later = players.EraseRetiredPlayers(game, 100, retired_time);
+                THEN("it retires too") {
+                    REQUIRE(later.size() == 1);
+                    CHECK(game.FindDog(later[0])->GetId() == buddy_id);
+                    CHECK(players.GetPlayers().empty());
+                }
+            }
+        }
+    }
+
+    GIVEN("a player restored with accumulated idle time") {
+        Dog dog{5, "Old"s, {0, 0}};
+        dog.AddAfkTime(900);
+        session->AddDog(5, dog);
+        players.AddPlayer(players::Token{7, 7}, 5, *session, 5);
+
+        THEN("it retires once the rest of the time passes") {
+            IdleTick(*session, 100);
+            auto retired = players.EraseRetiredPlayers(game, 100, retired_time);
+            REQUIRE(retired.size() == 1);
+            CHECK(game.FindDog(retired[0])->GetId() == 5);
+            CHECK(players.FindByToken(players::Token{7, 7}) == nullptr);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+std::vector<std::uint32_t> Take(random_gen::Pcg32& random, size_t count) {
+    std::vector<std::uint32_t> values;
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(random());
+    }
+    return values;
+}
+
+Game MakeGame() {
+    Game game;
+    Map map1{Map::Id{"map1"s}, "Map 1"s, 1.0, 3};
+    map1.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 40});
+    Map map2{Map::Id{"map2"s}, "Map 2"s, 1.0, 3};
+    map2.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 40});
+    game.AddMap(std::move(map1));
+    game.AddMap(std::move(map2));
+    game.SetRandomGenerate(true);
+    return game;
+}
+
+}  // namespace
+
+SCENARIO("Session random generator") {
+    GIVEN("generators with the same seed") {
+        random_gen::Pcg32 first{42, 1};
+        random_gen::Pcg32 second{42, 1};
+
+        THEN("they give the same sequence") {
+            CHECK(Take(first, 16) == Take(second, 16));
+        }
+
+        WHEN("the state is saved and restored") {
+            Take(first, 5);
+            random_gen::Pcg32 restored;
+            restored.SetState(first.GetState());
+
+            THEN("the sequence continues") {
+                CHECK(Take(restored, 16) == Take(first, 16));
+            }
+        }
+    }
+
+    GIVEN("generators of different streams") {
+        random_gen::Pcg32 first{42, 1};
+        random_gen::Pcg32 second{42, 2};
+
+        THEN("their sequences differ") {
+            CHECK(Take(first, 16) != Take(second, 16));
+        }
+    }
+
+    GIVEN("stream numbers made from map names") {
+        THEN("they follow FNV-1a and do not depend on the standard library") {
+            STATIC_REQUIRE(random_gen::MakeStream(""sv) == 0xcbf29ce484222325ull);
+            STATIC_REQUIRE(random_gen::MakeStream("a"sv) == 0xaf63dc4c8601ec8cull);
+            CHECK(random_gen::MakeStream("map1"sv) != random_gen::MakeStream("map2"sv));
+        }
+    }
+
+    GIVEN("a bounded draw") {
+        random_gen::Pcg32 random{7};
+        std::vector<int> counts(3);
+        for (int i = 0; i < 3000; ++i) {
+            std::uint32_t value = random.UniformInt(3);
+            REQUIRE(value < 3);
+            ++counts[value];
+        }
+
+        THEN("every value occurs") {
+            for (int count : counts) {
+                CHECK(count > 800);
+            }
+        }
+    }
+}
+
+SCENARIO("Tick seeds") {
+    Game game = MakeGame();
+    game.SetRandomSeed(5);
+    auto* session1 = game.AddGameSession("map1"s);
+    auto* session2 = game.AddGameSession("map2"s);
+
+    WHEN("a tick seed is drawn") {
+        Game replay = MakeGame();
+        replay.SetRandomSeed(5);
+        auto* replay1 = replay.AddGameSession("map1"s);
+
+        std::uint32_t seed = game.NextTickSeed();
+        replay.UseTickSeed(seed);
+
+        THEN("sessions of different maps get different sequences") {
+            CHECK(Take(session1->GetRandom(), 8) != Take(session2->GetRandom(), 8));
+        }
+
+        THEN("the replayed seed gives the same dogs and the same next seed") {
+            session1->AddDog("Rex"s, 0);
+            replay1->AddDog("Rex"s, 0);
+            CHECK(session1->FindDogById(0)->GetCoords() == replay1->FindDogById(0)->GetCoords());
+            CHECK(game.NextTickSeed() == replay.NextTickSeed());
+        }
+    }
+}
+
+SCENARIO("Spawn points along roads") {
+    Map map{Map::Id{"map1"s}, "Map 1"s, 1.0, 3};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 90});
+    map.AddRoad(Road{Road::VERTICAL, Point{0, 10}, 20});
+    map.AddRoad(Road{Road::HORIZONTAL, Point{5, 30}, 5});
+    Game game;
+    game.AddMap(std::move(map));
+    const Map& added = game.GetMaps().front();
+
+    WHEN("many points are generated") {
+        random_gen::Pcg32 random{3};
+        int on_long_road = 0;
+        int on_short_road = 0;
+        constexpr int count = 20000;
+        for (int i = 0; i < count; ++i) {
+            Coordinates point = generate_coords::GenerateRandomPointOnMap(added, random);
+            if (point.y == 0 && 0 <= point.x && point.x < 90) {
+                ++on_long_road;
+            } else if (point.x == 0 && 10 <= point.y && point.y < 20) {
+                ++on_short_road;
+            }
+        }
+
+        THEN("roads are chosen by their length and the point road is never chosen") {
+            CHECK(on_long_road + on_short_road == count);
+            CHECK(std::abs(on_long_road / double(count) - 0.9) < 0.02);
+        }
+    }
+}
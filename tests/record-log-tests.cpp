@@ -0,0 +1,150 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include "../src/record_log.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+namespace {
+
+struct TempLogFile {
+    TempLogFile()
+        : path{fs::temp_directory_path() / ("record-log-test-"s + domain::RecordId::New().ToString())} {
+    }
+
+    ~TempLogFile() {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+
+    fs::path path;
+};
+
+record_log::LogConfig MakeConfig(const fs::path& path) {
+    record_log::LogConfig config;
+    config.path = path;
+    return config;
+}
+
+std::vector<domain::Record> MakeRecords() {
+    return {domain::Record{domain::RecordId::New(), "Rex"s, 10, 5000},
+            domain::Record{domain::RecordId::New(), "Buddy"s, 30, 7000},
+            domain::Record{domain::RecordId::New(), "Max"s, 20, 1000}};
+}
+
+}  // namespace
+
+SCENARIO("Record log keeps records across restarts") {
+    TempLogFile file;
+    auto records = MakeRecords();
+
+    GIVEN("a log with saved records") {
+        {
+            record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+            log.SaveRecords(records);
+
+            THEN("records are served sorted by score") {
+                auto saved = log.GetRecords(0, 10);
+                REQUIRE(saved.size() == 3);
+                CHECK(saved[0].GetDogName() == "Buddy"s);
+                CHECK(saved[1].GetDogName() == "Max"s);
+                CHECK(saved[2].GetDogName() == "Rex"s);
+            }
+        }
+
+        WHEN("the log is reopened") {
+            auto index = std::make_shared<leaderboard::Leaderboard>();
+            record_log::RecordLog log{MakeConfig(file.path), index};
+
+            THEN("all records are recovered into the index") {
+                CHECK(log.GetRecoveryInfo().records == 3);
+                CHECK(log.GetRecoveryInfo().truncated_bytes == 0);
+                CHECK(index->GetSize() == 3);
+
+                auto page = log.GetRecords(1, 1);
+                REQUIRE(page.size() == 1);
+                CHECK(page[0].GetDogName() == "Max"s);
+                CHECK(page[0].GetScore() == 20);
+                CHECK(page[0].GetTime() == 1000);
+                CHECK(page[0].GetId() == records[2].GetId());
+            }
+        }
+
+        WHEN("the same records are saved again") {
+            const auto size_before = fs::file_size(file.path);
+            {
+                record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+                log.SaveRecords(records);
+                log.SaveRecords({records[0], records[0]});
+
+                THEN("they are not duplicated") {
+                    CHECK(log.GetRecords(0, 10).size() == 3);
+                }
+            }
+
+            THEN("the file does not grow") {
+                CHECK(fs::file_size(file.path) == size_before);
+                record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+                CHECK(log.GetRecoveryInfo().records == 3);
+            }
+        }
+    }
+}
+
+SCENARIO("Record log recovers from a torn tail") {
+    TempLogFile file;
+    auto records = MakeRecords();
+    {
+        record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+        log.SaveRecords(records);
+    }
+    const auto full_size = fs::file_size(file.path);
+
+    GIVEN("a log whose last record was only partially written") {
+        fs::resize_file(file.path, full_size - 3);
+
+        WHEN("the log is reopened") {
+            record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+
+            THEN("the broken record is dropped and the file is truncated") {
+                CHECK(log.GetRecoveryInfo().records == 2);
+                CHECK(log.GetRecoveryInfo().truncated_bytes > 0);
+                CHECK(fs::file_size(file.path) < full_size - 3);
+            }
+
+            AND_WHEN("new records are appended") {
+                log.SaveRecords({domain::Record{domain::RecordId::New(), "Bim"s, 50, 100}});
+
+                THEN("they survive the next restart") {
+                    record_log::RecordLog reopened{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+                    CHECK(reopened.GetRecoveryInfo().records == 3);
+                    CHECK(reopened.GetRecoveryInfo().truncated_bytes == 0);
+                    CHECK(reopened.GetRecords(0, 1)[0].GetDogName() == "Bim"s);
+                }
+            }
+        }
+    }
+
+    GIVEN("a log with a corrupted record in the tail") {
+        {
+            std::fstream stream(file.path, std::ios::in | std::ios::out | std::ios::binary);
+            stream.seekp(static_cast<std::streamoff>(full_size - 1));
+            stream.put('\xFF');
+        }
+
+        THEN("the checksum mismatch is detected") {
+            record_log::RecordLog log{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()};
+            CHECK(log.GetRecoveryInfo().records == 2);
+        }
+    }
+}
+
+SCENARIO("Record log rejects foreign files") {
+    TempLogFile file;
+    {
+        std::ofstream stream(file.path, std::ios::binary);
+        stream << "definitely not a record log";
+    }
+    CHECK_THROWS(record_log::RecordLog{MakeConfig(file.path), std::make_shared<leaderboard::Leaderboard>()});
+}
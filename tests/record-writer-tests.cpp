@@ -0,0 +1,379 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "../src/record_log.h"
+#include "../src/record_writer.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+namespace {
+
+struct TempSpillFile {
+    TempSpillFile()
+        : path{fs::temp_directory_path() / ("record-writer-test-"s + domain::RecordId::New().ToString())} {
+    }
+
+    ~TempSpillFile() {
+        std::error_code ec;
+        fs::remove(path, ec);
+        fs::remove(GetPendingPath(), ec);
+    }
+
+    fs::path GetPendingPath() const {
+        return path.string() + ".pending";
+    }
+
+    fs::path path;
+};
+
+// Хранилище, которое можно "уронить" или заставить отказать несколько раз подряд
+class FakeStorage {
+public:
+    record_writer::RecordWriter::SaveFunc MakeSaveFunc() {
+        return [this](const std::vector<domain::Record>& records) {
+            Save(records);
+        };
+    }
+
+    void SetDown(bool down) {
+        down_ = down;
+    }
+
+    void FailNext(int count) {
+        std::lock_guard lock{mutex_};
+        failures_left_ = count;
+    }
+
+    int GetCalls() const {
+        std::lock_guard lock{mutex_};
+        return calls_;
+    }
+
+    int GetFlushes() const {
+        std::lock_guard lock{mutex_};
+        return flushes_;
+    }
+
+    void Flush() {
+        std::lock_guard lock{mutex_};
+        ++flushes_;
+    }
+
+    std::vector<size_t> GetBatchSizes() const {
+        std::lock_guard lock{mutex_};
+        return batch_sizes_;
+    }
+
+    // сколько раз сохранена каждая запись
+    std::map<std::string, int> GetSaveCounts() const {
+        std::lock_guard lock{mutex_};
+        return save_counts_;
+    }
+
+private:
+    void Save(const std::vector<domain::Record>& records) {
+        std::lock_guard lock{mutex_};
+        ++calls_;
+        if (down_) {
+            throw std::runtime_error("storage is down");
+        }
+        if (failures_left_ > 0) {
+            --failures_left_;
+            throw std::runtime_error("temporary failure");
+        }
+        batch_sizes_.push_back(records.size());
+        for (const auto& record : records) {
+            ++save_counts_[record.GetId().ToString()];
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> down_ = false;
+    int failures_left_ = 0;
+    int calls_ = 0;
+    int flushes_ = 0;
+    std::vector<size_t> batch_sizes_;
+    std::map<std::string, int> save_counts_;
+};
+
+record_writer::WriterConfig MakeConfig(const fs::path& spill_path = {}) {
+    record_writer::WriterConfig config;
+    config.max_batch_size = 4;
+    config.batch_delay = 1ms;
+    config.max_attempts = 3;
+    config.retry_backoff = 1ms;
+    config.spill_path = spill_path;
+    return config;
+}
+
+std::vector<domain::Record> MakeRecords(size_t count) {
+    std::vector<domain::Record> records;
+    for (size_t i = 0; i < count; ++i) {
+        records.emplace_back(domain::RecordId::New(), "dog "s + std::to_string(i), static_cast<int>(i), static_cast<int>(i) * 1000);
+    }
+    return records;
+}
+
+// каждая запись сохранена ровно один раз и ничего лишнего
+bool IsDeliveredOnce(const FakeStorage& storage, const std::vector<domain::Record>& records) {
+    const auto counts = storage.GetSaveCounts();
+    if (counts.size() != records.size()) {
+        return false;
+    }
+    for (const auto& record : records) {
+        auto it = counts.find(record.GetId().ToString());
+        if (it == counts.end() || it->second != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Predicate>
+bool WaitFor(Predicate predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+}  // namespace
+
+SCENARIO("Record writer saves records in batches") {
+    FakeStorage storage;
+
+    GIVEN("records enqueued before the writer starts") {
+        auto records = MakeRecords(10);
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig()};
+        writer.Enqueue(std::vector<domain::Record>{records});
+
+        WHEN("the writer is started and stopped") {
+            writer.Start();
+            writer.Stop();
+
+            THEN("records are split into batches of the configured size") {
+                CHECK(storage.GetBatchSizes() == std::vector<size_t>{4, 4, 2});
+                CHECK(IsDeliveredOnce(storage, records));
+            }
+        }
+    }
+
+    GIVEN("a writer with a long batch delay") {
+        auto config = MakeConfig();
+        config.batch_delay = 1h;
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), config};
+        writer.Start();
+
+        WHEN("it is stopped right after an incomplete batch is enqueued") {
+            auto records = MakeRecords(3);
+            const auto start = std::chrono::steady_clock::now();
+            writer.Enqueue(std::vector<domain::Record>{records});
+            writer.Stop();
+
+            THEN("the batch is flushed without waiting for the delay") {
+                CHECK(std::chrono::steady_clock::now() - start < 5s);
+                CHECK(IsDeliveredOnce(storage, records));
+            }
+        }
+    }
+}
+
+SCENARIO("Record writer retries failed saves") {
+    FakeStorage storage;
+    TempSpillFile spill;
+    auto records = MakeRecords(3);
+
+    GIVEN("storage that fails twice and then recovers") {
+        storage.FailNext(2);
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+        writer.Start();
+        writer.Enqueue(std::vector<domain::Record>{records});
+        writer.Stop();
+
+        THEN("records are saved on the third attempt and nothing is spilled") {
+            CHECK(storage.GetCalls() == 3);
+            CHECK(IsDeliveredOnce(storage, records));
+            CHECK_FALSE(fs::exists(spill.path));
+        }
+    }
+
+    GIVEN("storage that is down and no spill file") {
+        storage.SetDown(true);
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig()};
+        writer.Start();
+        writer.Enqueue(std::vector<domain::Record>{records});
+        REQUIRE(WaitFor([&] {
+            return storage.GetCalls() > 3;
+        }));
+
+        WHEN("storage comes back") {
+            storage.SetDown(false);
+
+            THEN("records kept in memory are saved once") {
+                // при остановке недоставленные записи теряются, поэтому сначала ждем сохранения
+                CHECK(WaitFor([&] {
+                    return IsDeliveredOnce(storage, records);
+                }));
+                writer.Stop();
+                CHECK(IsDeliveredOnce(storage, records));
+            }
+        }
+    }
+}
+
+SCENARIO("Record writer spills records while storage is down") {
+    FakeStorage storage;
+    TempSpillFile spill;
+    auto records = MakeRecords(6);
+
+    GIVEN("records spilled by a writer that could not reach storage") {
+        storage.SetDown(true);
+        {
+            record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+            writer.Start();
+            writer.Enqueue(std::vector<domain::Record>{records});
+            writer.Stop();
+        }
+        REQUIRE(fs::exists(spill.path));
+        REQUIRE(storage.GetSaveCounts().empty());
+
+        WHEN("the writer is restarted with working storage") {
+            storage.SetDown(false);
+            {
+                record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+                writer.Start();
+                writer.Stop();
+            }
+
+            THEN("every spilled record is saved exactly once and the files are removed") {
+                CHECK(IsDeliveredOnce(storage, records));
+                CHECK_FALSE(fs::exists(spill.path));
+                CHECK_FALSE(fs::exists(spill.GetPendingPath()));
+            }
+        }
+
+        WHEN("the previous run crashed while resending spilled records") {
+            // перенос в pending-файл сделан, а записи так и не сохранены
+            fs::rename(spill.path, spill.GetPendingPath());
+            auto later_records = MakeRecords(2);
+            {
+                // остановка без запуска: хранилище так и не открылось
+                record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+                writer.Enqueue(std::vector<domain::Record>{later_records});
+                writer.Stop();
+            }
+            REQUIRE(fs::exists(spill.path));
+
+            storage.SetDown(false);
+            {
+                record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+                writer.Start();
+                writer.Stop();
+            }
+
+            THEN("both the pending and the spilled records are saved exactly once") {
+                auto all_records = records;
+                all_records.insert(all_records.end(), later_records.begin(), later_records.end());
+                CHECK(IsDeliveredOnce(storage, all_records));
+                CHECK_FALSE(fs::exists(spill.path));
+                CHECK_FALSE(fs::exists(spill.GetPendingPath()));
+            }
+        }
+    }
+
+    GIVEN("a running writer that spilled records") {
+        storage.SetDown(true);
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), MakeConfig(spill.path)};
+        writer.Start();
+        writer.Enqueue(std::vector<domain::Record>{records});
+        REQUIRE(WaitFor([&] {
+            return fs::exists(spill.path);
+        }));
+
+        WHEN("storage recovers and a new record is saved") {
+            storage.SetDown(false);
+            auto later_records = MakeRecords(1);
+            writer.Enqueue(std::vector<domain::Record>{later_records});
+            writer.Stop();
+
+            THEN("spilled records are resent without a restart") {
+                auto all_records = records;
+                all_records.insert(all_records.end(), later_records.begin(), later_records.end());
+                CHECK(IsDeliveredOnce(storage, all_records));
+                CHECK_FALSE(fs::exists(spill.path));
+                CHECK_FALSE(fs::exists(spill.GetPendingPath()));
+            }
+        }
+    }
+}
+
+SCENARIO("Record writer flushes deferred writes by a deadline") {
+    FakeStorage storage;
+
+    GIVEN("a writer with a flush function") {
+        auto config = MakeConfig();
+        config.flush = [&storage] {
+            storage.Flush();
+        };
+        config.flush_interval = 10ms;
+        record_writer::RecordWriter writer{storage.MakeSaveFunc(), config};
+        writer.Start();
+
+        WHEN("one batch is saved and no more records come") {
+            writer.Enqueue(MakeRecords(2));
+
+            THEN("the batch is flushed once without waiting for more traffic") {
+                CHECK(WaitFor([&] {
+                    return storage.GetFlushes() == 1;
+                }));
+                std::this_thread::sleep_for(50ms);
+                CHECK(storage.GetFlushes() == 1);
+            }
+        }
+    }
+
+    GIVEN("a record log that defers fsync") {
+        TempSpillFile log_file;
+        record_log::LogConfig log_config;
+        log_config.path = log_file.path;
+        log_config.sync_interval = 1h;
+        record_log::RecordLog log{log_config, std::make_shared<leaderboard::Leaderboard>()};
+
+        auto config = MakeConfig();
+        config.flush = [&log] {
+            log.Sync();
+        };
+        config.flush_interval = 20ms;
+        record_writer::RecordWriter writer{[&log](const std::vector<domain::Record>& records) {
+            log.SaveRecords(records);
+        }, config};
+
+        WHEN("a batch arrives soon after the previous fsync") {
+            log.SaveRecords(MakeRecords(1));
+            log.Sync();
+            REQUIRE_FALSE(log.HasUnsynced());
+            writer.Start();
+            writer.Enqueue(MakeRecords(3));
+            REQUIRE(WaitFor([&] {
+                return log.GetRecords(0, 10).size() == 4;
+            }));
+
+            THEN("it is synced by the deadline, not at shutdown") {
+                CHECK(WaitFor([&] {
+                    return !log.HasUnsynced();
+                }));
+                writer.Stop();
+            }
+        }
+    }
+}
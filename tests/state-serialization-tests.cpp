@@ -1,13 +1,19 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 
 #include "../src/model.h"
 #include "../src/model_serialization.h"
+#include "../src/snapshot_file.h"
+#include "../src/snapshot_shards.h"
+#include "test_world.h"
 
 using namespace model;
 using namespace std::literals;
+namespace fs = std::filesystem;
 namespace {
 
 using InputArchive = boost::archive::text_iarchive;
@@ -18,31 +24,92 @@ struct Fixture {
     OutputArchive output_archive{strm};
 };
 
-}  // namespace
+Game MakeGame() {
+    Game game;
+    game.AddMap(Map{Map::Id{"map1"s}, "Map 1"s, 1.0, 3});
+    game.AddMap(Map{Map::Id{"map2"s}, "Map 2"s, 1.0, 3});
+    game.SetRandomGenerate(false);
+    return game;
+}
 
-SCENARIO_METHOD(Fixture, "Point serialization") {
-    GIVEN("A point") {
-        const geom::Point2D p{10, 20};
-        WHEN("point is serialized") {
-            output_archive << p;
+extra_data::PossibleLootOnMapsToGenerate MakePossibleLoot() {
+    return test_world::MakePossibleLoot(5s, {{"map1"s, 2}, {"map2"s, 1}});
+}
 
-            THEN("it is equal to point after serialization") {
-                InputArchive input_archive{strm};
-                geom::Point2D restored_point;
-                input_archive >> restored_point;
-                CHECK(p == restored_point);
-            }
-        }
+// Состояние с двумя игроками на map1 и трофеями на обеих картах
+struct World {
+    World() {
+        auto* session = game.AddGameSession("map1"s);
+        rex = *players.AddPlayer("Rex"s, session);
+        const int buddy_id = players.AddPlayer("Buddy"s, session)->GetId();
+
+        auto& dog = *session->FindDogById(rex.GetId());
+        dog.SetCoords({4.5, 1.25});
+        dog.SetSpeed({0, -1});
+        dog.SetDir(DirectionGeo::NORTH);
+        dog.AddScore(30);
+        dog.AddCollectedItemToBag({7u, 1u});
+        dog.AddPlayTime(1200);
+        session->FindDogById(buddy_id)->AddAfkTime(500);
+
+        lost_objects.SetLostObjectsOnMaps({{"map1"s, {extra_data::LostObject{8u, 0u, {1, 2}}}},
+                                           {"map2"s, {extra_data::LostObject{9u, 0u, {3, 4}}}}});
+        possible_loot.SetNextId(10);
+        game.SetRandomSeed(17);
+        game.NextTickSeed();
     }
+
+    Game game = MakeGame();
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = MakePossibleLoot();
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+    players::Player rex;
+};
+
+// Пустой мир с теми же картами, куда восстанавливается снимок
+struct RestoredWorld {
+    explicit RestoredWorld(const snapshot_file::SnapshotView& view) {
+        snapshot_file::RestoreState(view, game, players, lost_objects);
+    }
+
+    Game game = MakeGame();
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = MakePossibleLoot();
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+};
+
+void CheckRestored(const World& world, const RestoredWorld& restored) {
+    auto* session = restored.game.FindGameSessionFromMapId(Map::Id{"map1"s});
+    REQUIRE(session != nullptr);
+    REQUIRE(session->GetDogs().size() == 2);
+
+    auto* player = const_cast<players::Players&>(restored.players).FindByToken(world.rex.GetToken());
+    REQUIRE(player != nullptr);
+    CHECK(player->GetId() == world.rex.GetId());
+
+    const auto& dog = *session->FindDogById(world.rex.GetId());
+    CHECK(dog.GetName() == "Rex"s);
+    CHECK(dog.GetCoords() == Coordinates{4.5, 1.25});
+    CHECK(dog.GetSpeed() == Speed{0, -1});
+    CHECK(dog.GetScore() == 30);
+    REQUIRE(dog.GetBag().size() == 1);
+    CHECK(dog.GetBag()[0].id == 7u);
+
+    CHECK(restored.players.GetNextId() == 2);
+    CHECK(restored.lost_objects.GetLostObjects("map1"s).size() == 1);
+    CHECK(restored.lost_objects.GetLostObjects("map2"s)[0].id == 9u);
+    CHECK(restored.possible_loot.GetNextId() == 10u);
 }
 
+}  // namespace
+
 SCENARIO_METHOD(Fixture, "Dog Serialization") {
     GIVEN("a dog") {
         const auto dog = [] {
-            Dog dog{Dog::Id{42}, "Pluto"s, {42.2, 12.5}, 3};
+            Dog dog{42, "Pluto"s, {42.2, 12.5}};
             dog.AddScore(42);
-            CHECK(dog.PutToBag({FoundObject::Id{10}, 2u}));
-            dog.SetDirection(Direction::EAST);
+            dog.AddCollectedItemToBag({10u, 2u});
+            dog.SetDir(DirectionGeo::EAST);
             dog.SetSpeed({2.3, -1.2});
             return dog;
         }();
@@ -61,11 +128,210 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
 
                 CHECK(dog.GetId() == restored.GetId());
                 CHECK(dog.GetName() == restored.GetName());
-                CHECK(dog.GetPosition() == restored.GetPosition());
+                CHECK(dog.GetCoords() == restored.GetCoords());
                 CHECK(dog.GetSpeed() == restored.GetSpeed());
-                CHECK(dog.GetBagCapacity() == restored.GetBagCapacity());
-                CHECK(dog.GetBagContent() == restored.GetBagContent());
+                CHECK(dog.GetDir() == restored.GetDir());
+                CHECK(dog.GetScore() == restored.GetScore());
+                REQUIRE(restored.GetBag().size() == 1);
+                CHECK(restored.GetBag()[0].id == 10u);
+            }
+        }
+    }
+}
+
+SCENARIO("Flat state snapshot") {
+    World world;
+    auto snapshot = serialization::CaptureState(world.game, world.players, world.lost_objects);
+    snapshot.journal_segment = 5;
+    auto data = snapshot_file::EncodeSnapshot(snapshot);
+
+    GIVEN("an encoded snapshot") {
+        auto view = snapshot_file::SnapshotView::Parse(data.data(), data.size());
+
+        THEN("dogs and loot of a map are contiguous") {
+            CHECK(view.GetHeader().version == snapshot_file::VERSION);
+            CHECK(view.GetHeader().journal_segment == 5);
+            REQUIRE(view.GetMaps().size() == 2);
+            CHECK(view.GetMaps()[0].has_session == 1);
+            CHECK(view.GetMaps()[0].dogs_count == 2);
+            CHECK(view.GetMaps()[1].has_session == 0);
+            CHECK(view.GetMaps()[1].loot_count == 1);
+        }
+
+        THEN("the whole state is restored") {
+            RestoredWorld restored{view};
+            CheckRestored(world, restored);
+
+            auto* session = restored.game.FindGameSessionFromMapId(Map::Id{"map1"s});
+            CHECK(session->FindDogById(world.rex.GetId())->GetPlayTime() == 1200);
+            // следующие тики получат те же seed'ы, что и без перезапуска
+            CHECK(restored.game.GetRandomState() == world.game.GetRandomState());
+            CHECK(restored.game.NextTickSeed() == world.game.NextTickSeed());
+        }
+    }
+
+    GIVEN("a snapshot with a damaged byte") {
+        data.back() ^= 0x1;
+        THEN("it is rejected") {
+            CHECK_THROWS_AS(snapshot_file::SnapshotView::Parse(data.data(), data.size()), std::runtime_error);
+        }
+    }
+
+    GIVEN("a snapshot of another version") {
+        auto header = reinterpret_cast<snapshot_file::FileHeader*>(data.data());
+        header->version = snapshot_file::VERSION + 1;
+        THEN("it is rejected") {
+            CHECK_THROWS_AS(snapshot_file::SnapshotView::Parse(data.data(), data.size()), std::runtime_error);
+        }
+    }
+
+    GIVEN("a snapshot file") {
+        auto path = fs::temp_directory_path() / ("state-snapshot-test-"s + domain::RecordId::New().ToString());
+        {
+            std::ofstream file(path, std::ios::binary);
+            snapshot_file::WriteSnapshot(file, snapshot);
+        }
+
+        THEN("it is restored through the memory mapping") {
+            REQUIRE(snapshot_file::IsSnapshotFile(path));
+            {
+                snapshot_file::MappedSnapshot mapped{path};
+                RestoredWorld restored{mapped.GetView()};
+                CheckRestored(world, restored);
+            }
+            fs::remove(path);
+        }
+    }
+}
+
+SCENARIO("Compressed state snapshot") {
+    World world;
+    auto snapshot = serialization::CaptureState(world.game, world.players, world.lost_objects);
+    auto path = fs::temp_directory_path() / ("state-snapshot-test-"s + domain::RecordId::New().ToString());
+
+    GIVEN("a snapshot written with gzip") {
+        size_t raw_size = 0;
+        {
+            std::ofstream file(path, std::ios::binary);
+            raw_size = snapshot_file::WriteSnapshot(file, snapshot, 6);
+        }
+
+        THEN("it is detected and restored after decompression") {
+            CHECK(raw_size == snapshot_file::EncodeSnapshot(snapshot).size());
+            CHECK_FALSE(snapshot_file::IsSnapshotFile(path));
+            REQUIRE(snapshot_file::IsCompressedFile(path));
+
+            auto data = snapshot_file::ReadCompressedSnapshot(path);
+            CHECK(data.size() == raw_size);
+            RestoredWorld restored{snapshot_file::SnapshotView::Parse(data.data(), data.size())};
+            CheckRestored(world, restored);
+        }
+        fs::remove(path);
+    }
+}
+
+SCENARIO("Legacy snapshot conversion") {
+    World world;
+    std::stringstream legacy;
+    serialization::MakeModelSerialize(legacy, world.game, world.players, world.lost_objects);
+
+    WHEN("an old archive is converted") {
+        auto data = snapshot_file::ConvertLegacySnapshot(legacy);
+        auto view = snapshot_file::SnapshotView::Parse(data.data(), data.size());
+
+        THEN("it restores the same state") {
+            RestoredWorld restored{view};
+            CheckRestored(world, restored);
+        }
+    }
+}
+
+SCENARIO("Sharded state snapshot") {
+    World world;
+    auto snapshot = serialization::CaptureState(world.game, world.players, world.lost_objects);
+    snapshot.journal_segment = 3;
+    auto dir = fs::temp_directory_path() / ("state-shards-test-"s + domain::RecordId::New().ToString());
+    fs::create_directories(dir);
+    auto manifest_path = dir / "state";
+
+    GIVEN("a snapshot split by maps") {
+        auto shards = snapshot_shards::SplitByMap(snapshot);
+
+        THEN("each map gets its own shard") {
+            REQUIRE(shards.size() == 2);
+            CHECK(shards[0].dogs.size() == 2);
+            CHECK(shards[0].players.size() == 2);
+            CHECK(shards[1].dogs.empty());
+            REQUIRE(shards[1].lost_objects.size() == 1);
+            CHECK(shards[1].lost_objects[0].map_id == "map2"s);
+        }
+    }
+
+    GIVEN("a sharded snapshot on disk") {
+        auto result = snapshot_shards::WriteShardedSnapshot(manifest_path, snapshot, 0);
+        REQUIRE(result.shards == 2);
+        REQUIRE(snapshot_shards::IsManifestFile(manifest_path));
+
+        THEN("it is restored from all shards") {
+            Game game = MakeGame();
+            auto possible_loot = MakePossibleLoot();
+            extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+            players::Players players;
+            auto manifest = snapshot_shards::RestoreShardedSnapshot(manifest_path, game, players, lost_objects);
+
+            CHECK(manifest.generation == 1);
+            CHECK(manifest.journal_segment == 3);
+            auto* session = game.FindGameSessionFromMapId(Map::Id{"map1"s});
+            REQUIRE(session != nullptr);
+            CHECK(session->FindDogById(world.rex.GetId())->GetBag()[0].id == 7u);
+            CHECK(players.FindByToken(world.rex.GetToken()) != nullptr);
+            CHECK(players.GetNextId() == 2);
+            CHECK(lost_objects.GetLostObjects("map2"s)[0].id == 9u);
+            CHECK(possible_loot.GetNextId() == 10u);
+            CHECK(game.GetRandomState() == world.game.GetRandomState());
+        }
+
+        WHEN("the next generation is written compressed") {
+            snapshot_shards::WriteShardedSnapshot(manifest_path, snapshot, 6);
+
+            THEN("shards of the previous generation are removed") {
+                auto manifest = snapshot_shards::ReadManifest(manifest_path);
+                CHECK(manifest.generation == 2);
+                CHECK(std::distance(fs::directory_iterator(dir), fs::directory_iterator{}) == 3);
+                CHECK(snapshot_file::IsCompressedFile(dir / manifest.shards[0].file_name));
+            }
+        }
+
+        WHEN("a shard is replaced by a shard of another snapshot") {
+            auto manifest = snapshot_shards::ReadManifest(manifest_path);
+            auto other = snapshot;
+            other.dogs[0].score += 1;
+            {
+                std::ofstream file(dir / manifest.shards[0].file_name, std::ios::binary | std::ios::trunc);
+                snapshot_file::WriteSnapshot(file, snapshot_shards::SplitByMap(other)[0]);
+            }
+
+            THEN("the shard set is rejected as inconsistent") {
+                Game game = MakeGame();
+                auto possible_loot = MakePossibleLoot();
+                extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+                players::Players players;
+                CHECK_THROWS_AS(snapshot_shards::RestoreShardedSnapshot(manifest_path, game, players, lost_objects), std::runtime_error);
+            }
+        }
+
+        WHEN("the manifest is damaged") {
+            std::fstream file(manifest_path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekg(-1, std::ios::end);
+            char last = static_cast<char>(file.get());
+            file.seekp(-1, std::ios::end);
+            file.put(static_cast<char>(last ^ 0x1));
+            file.close();
+
+            THEN("it is rejected") {
+                CHECK_THROWS_AS(snapshot_shards::ReadManifest(manifest_path), std::runtime_error);
             }
         }
     }
+    fs::remove_all(dir);
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+// Общие заготовки мира для тестов и бенчмарков
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/extra_data.h"
+#include "../src/model.h"
+
+namespace test_world {
+
+using namespace std::literals;
+
+// единственный вид трофея во всех тестах
+inline extra_data::LootObject MakeKey() {
+    return extra_data::LootObject{"key"s, "assets/key.obj"s, "obj"s, std::nullopt, std::nullopt, 0.03, 10};
+}
+
+// на каждой карте столько видов трофеев (все - ключи), сколько указано
+inline extra_data::PossibleLootOnMapsToGenerate MakePossibleLoot(std::chrono::milliseconds period,
+                                                                 const std::vector<std::pair<std::string, size_t>>& loot_types_on_maps) {
+    extra_data::PossibleLootOnMapsToGenerate possible_loot{period, 0.5};
+    for (const auto& [map_id, loot_types] : loot_types_on_maps) {
+        possible_loot.AddPossibleLootToMap(map_id, std::vector<extra_data::LootObject>(loot_types, MakeKey()));
+    }
+    return possible_loot;
+}
+
+// map1: одна горизонтальная дорога из начала координат с офисом посередине
+inline model::Game MakeRoadGame(int road_length, bool is_random_generate) {
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s, 4.0, 3};
+    map.AddRoad(model::Road{model::Road::HORIZONTAL, model::Point{0, 0}, road_length});
+    map.AddOffice(model::Office{model::Office::Id{"o1"s}, model::Point{road_length / 2, 0}, model::Offset{5, 0}});
+
+    model::Game game;
+    game.AddMap(std::move(map));
+    game.SetRandomGenerate(is_random_generate);
+    return game;
+}
+
+}  // namespace test_world
@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "../src/game_tick.h"
+#include "test_world.h"
+
+using namespace model;
+using namespace std::literals;
+
+/*
+ * Глобальный operator new со счетчиком. Он заменяет стандартный во всей программе,
+ * поэтому эти тесты собираются отдельной целью и не смешиваются с остальными.
+ */
+namespace {
+
+std::atomic<bool> is_counting{false};
+std::atomic<size_t> allocations_count{0};
+
+// считает выделения памяти, сделанные за время жизни объекта
+class AllocationCounter {
+public:
+    AllocationCounter() {
+        allocations_count = 0;
+        is_counting = true;
+    }
+
+    ~AllocationCounter() {
+        is_counting = false;
+    }
+
+    size_t Stop() {
+        is_counting = false;
+        return allocations_count;
+    }
+};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (is_counting.load(std::memory_order_relaxed)) {
+        allocations_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+constexpr int TICK_DELTA = 100;
+constexpr int RETIRED_TIME = 1'000'000'000;
+
+// Собаки ходят от края до края дороги через офис, как игроки, нажимающие клавиши между тиками
+void Steer(GameSession& session, int tick) {
+    for (auto& dog : session.GetDogs()) {
+        bool is_forward = (tick + dog.GetId() * 7) / 30 % 2 == 0;
+        dog.SetSpeed(Speed{is_forward ? 10.0 : -10.0, 0});
+        dog.SetDir(is_forward ? DirectionGeo::EAST : DirectionGeo::WEST);
+    }
+}
+
+int TotalScore(const GameSession& session) {
+    int score = 0;
+    for (const auto& dog : session.GetDogs()) {
+        score += dog.GetScore();
+    }
+    return score;
+}
+
+}  // namespace
+
+SCENARIO("Steady-state tick allocations") {
+    Game game = test_world::MakeRoadGame(20, false);
+    game.SetRandomSeed(42);
+    extra_data::PossibleLootOnMapsToGenerate possible_loot = test_world::MakePossibleLoot(1s, {{"map1"s, 2}});
+    extra_data::LostObjectsOnMaps lost_objects{possible_loot};
+    players::Players players;
+    objects_collector::CollectorBuffers buffers;
+
+    auto* session = game.AddGameSession("map1"s);
+    for (const auto& name : {"Rex"s, "Buddy"s, "Max"s, "Bella"s}) {
+        players.AddPlayer(name, session);
+    }
+
+    GIVEN("a session after warm-up ticks") {
+        // первые тики после входа раскладывают память под буферы
+        for (int tick = 0; tick < 10; ++tick) {
+            Steer(*session, tick);
+            game.NextTickSeed();
+            game_tick::Simulate(game, players, lost_objects, buffers, TICK_DELTA, RETIRED_TIME);
+        }
+
+        WHEN("more ticks run without joins and retirements") {
+            size_t retired_count = 0;
+            int score_before = TotalScore(*session);
+            AllocationCounter counter;
+            for (int tick = 10; tick < 600; ++tick) {
+                Steer(*session, tick);
+                // seed тика, как в ApiRequestHandler::Tick
+                game.NextTickSeed();
+                retired_count += game_tick::Simulate(game, players, lost_objects, buffers, TICK_DELTA, RETIRED_TIME).size();
+            }
+            size_t allocations = counter.Stop();
+
+            THEN("they do not touch the heap") {
+                // предметы собирались и сдавались, то есть весь путь тика пройден
+                CHECK(TotalScore(*session) > score_before);
+                CHECK(retired_count == 0);
+                CHECK(allocations == 0);
+                CHECK(session->GetDogsCount() == 4);
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+
+#include "../src/ticker.h"
+
+using namespace std::literals;
+namespace {
+
+// Фиктивные часы: время двигается только вручную
+struct MockClock {
+    using duration = std::chrono::microseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<MockClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept {
+        return current;
+    }
+
+    static void Advance(duration d) {
+        current += d;
+    }
+
+    inline static time_point current{};
+};
+
+using Scheduler = ticker::TickScheduler<MockClock>;
+
+struct Fixture {
+    Fixture() {
+        MockClock::current = MockClock::time_point{};
+    }
+};
+
+}  // namespace
+
+SCENARIO_METHOD(Fixture, "Tick deadlines are absolute") {
+    GIVEN("a scheduler with 50ms period") {
+        Scheduler scheduler{50ms, ticker::CatchUpPolicy::MULTI_STEP, 5};
+        scheduler.Start(MockClock::now());
+        CHECK(scheduler.GetDeadline() == MockClock::time_point{50ms});
+
+        WHEN("timer fires a bit late every time") {
+            for (int i = 0; i < 10; ++i) {
+                MockClock::current = scheduler.GetDeadline() + 7ms;
+                auto steps = scheduler.OnTimer(MockClock::now());
+                CHECK(steps.count == 1);
+                CHECK(steps.delta == 50ms);
+            }
+
+            THEN("the lateness does not accumulate") {
+                CHECK(scheduler.GetDeadline() == MockClock::time_point{550ms});
+                CHECK(scheduler.GetStats().ticks == 10);
+                CHECK(scheduler.GetStats().skipped_ticks == 0);
+                CHECK(scheduler.GetStats().last_lag == 7ms);
+                CHECK(scheduler.GetStats().jitter_us == 0);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Catch-up policies") {
+    GIVEN("a timer wake-up 3.5 periods after the deadline") {
+        auto fire = [](Scheduler& scheduler) {
+            scheduler.Start(MockClock::now());
+            MockClock::Advance(50ms + 175ms);
+            return scheduler.OnTimer(MockClock::now());
+        };
+
+        WHEN("policy is multi-step") {
+            Scheduler scheduler{50ms, ticker::CatchUpPolicy::MULTI_STEP, 5};
+            auto steps = fire(scheduler);
+
+            THEN("all missed periods are simulated one by one") {
+                CHECK(steps.count == 4);
+                CHECK(steps.delta == 50ms);
+                CHECK(scheduler.GetStats().skipped_ticks == 0);
+                CHECK(scheduler.GetDeadline() == MockClock::time_point{250ms});
+            }
+        }
+
+        WHEN("policy is multi-step with a small step bound") {
+            Scheduler scheduler{50ms, ticker::CatchUpPolicy::MULTI_STEP, 2};
+            auto steps = fire(scheduler);
+
+            THEN("the rest of the periods are dropped") {
+                CHECK(steps.count == 2);
+                CHECK(steps.delta == 50ms);
+                CHECK(scheduler.GetStats().skipped_ticks == 2);
+                CHECK(scheduler.GetDeadline() == MockClock::time_point{250ms});
+            }
+        }
+
+        WHEN("policy is clamp") {
+            Scheduler scheduler{50ms, ticker::CatchUpPolicy::CLAMP, 3};
+            auto steps = fire(scheduler);
+
+            THEN("one step with clamped delta is made") {
+                CHECK(steps.count == 1);
+                CHECK(steps.delta == 150ms);
+                CHECK(scheduler.GetStats().skipped_ticks == 1);
+            }
+        }
+
+        WHEN("policy is skip") {
+            Scheduler scheduler{50ms, ticker::CatchUpPolicy::SKIP, 5};
+            auto steps = fire(scheduler);
+
+            THEN("one regular step is made") {
+                CHECK(steps.count == 1);
+                CHECK(steps.delta == 50ms);
+                CHECK(scheduler.GetStats().skipped_ticks == 3);
+                CHECK(scheduler.GetStats().max_lag == 175ms);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Jitter statistics") {
+    GIVEN("a scheduler") {
+        Scheduler scheduler{10ms, ticker::CatchUpPolicy::MULTI_STEP, 5};
+        scheduler.Start(MockClock::now());
+
+        WHEN("lateness alternates") {
+            for (int i = 0; i < 32; ++i) {
+                MockClock::current = scheduler.GetDeadline() + (i % 2 == 0 ? 1ms : 3ms);
+                scheduler.OnTimer(MockClock::now());
+            }
+
+            THEN("jitter grows towards the lateness difference") {
+                CHECK(scheduler.GetStats().jitter_us > 1000.);
+                CHECK(scheduler.GetStats().jitter_us < 2000.);
+                CHECK(scheduler.GetStats().max_lag == 3ms);
+            }
+        }
+    }
+}
+
+SCENARIO("Catch-up policy parsing") {
+    CHECK(ticker::ParseCatchUpPolicy("multi-step") == ticker::CatchUpPolicy::MULTI_STEP);
+    CHECK(ticker::ParseCatchUpPolicy("clamp") == ticker::CatchUpPolicy::CLAMP);
+    CHECK(ticker::ParseCatchUpPolicy("skip") == ticker::CatchUpPolicy::SKIP);
+    CHECK_FALSE(ticker::ParseCatchUpPolicy("fast").has_value());
+}
@@ -0,0 +1,38 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/token.h"
+
+using namespace std::literals;
+
+SCENARIO("Player token") {
+    GIVEN("a token") {
+        const players::Token token{0x0123456789abcdefull, 0x00ff10a0b0c0d0e0ull};
+
+        THEN("it is printed as 32 lowercase hex digits") {
+            CHECK(token.ToString() == "0123456789abcdef00ff10a0b0c0d0e0"s);
+        }
+
+        THEN("the printed form is parsed back") {
+            CHECK(players::Token::Parse(token.ToString()) == token);
+            CHECK(players::Token::Parse("0123456789ABCDEF00FF10A0B0C0D0E0"sv) == token);
+        }
+    }
+
+    GIVEN("malformed strings") {
+        THEN("they are not tokens") {
+            CHECK_FALSE(players::Token::Parse(""sv).has_value());
+            CHECK_FALSE(players::Token::Parse("0123456789abcdef00ff10a0b0c0d0e"sv).has_value());
+            CHECK_FALSE(players::Token::Parse("0123456789abcdef00ff10a0b0c0d0e00"sv).has_value());
+            CHECK_FALSE(players::Token::Parse("0123456789abcdef00ff10a0b0c0d0eg"sv).has_value());
+            CHECK_FALSE(players::Token::Parse("0123456789abcdef 0ff10a0b0c0d0e0"sv).has_value());
+        }
+    }
+
+    GIVEN("tokens differing in one half") {
+        const players::Token a{1, 2};
+        const players::Token b{2, 1};
+        THEN("they hash differently") {
+            CHECK(players::TokenHasher{}(a) != players::TokenHasher{}(b));
+        }
+    }
+}
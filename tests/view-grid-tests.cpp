@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "../src/view_grid.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+std::vector<size_t> FindVisibleDogs(const view_grid::ViewGrid& grid, Coordinates center) {
+    view_grid::Visible visible;
+    grid.FindVisible(center, visible);
+    return visible.dogs;
+}
+
+}  // namespace
+
+SCENARIO("View grid") {
+    Map map{Map::Id{"map1"s}, "Map 1"s, 1.0, 3};
+    GameSession session{&map, false};
+    extra_data::Loot loot;
+    view_grid::ViewGrid grid{10.0};
+
+    GIVEN("dogs and loot around the origin") {
+        const std::vector<Coordinates> dog_coords = {{0, 0}, {5, 0}, {0, 9.9}, {20, 0}, {7.5, 7.5}};
+        for (size_t i = 0; i < dog_coords.size(); ++i) {
+            session.FindDog(session.AddDog("dog"s + std::to_string(i), static_cast<int>(i)))->SetCoords(dog_coords[i]);
+        }
+        loot.Insert(extra_data::LostObject{0u, 0u, {3, 3}});
+        loot.Insert(extra_data::LostObject{1u, 0u, {15, 0}});
+        loot.Insert(extra_data::LostObject{2u, 0u, {-9, 0}});
+        grid.Rebuild(session.GetDogs(), loot);
+
+        WHEN("a player at the origin looks around") {
+            view_grid::Visible visible;
+            grid.FindVisible({0, 0}, visible);
+
+            THEN("only entities inside the view circle are visible") {
+                // (7.5, 7.5) попадает в ячейки вокруг игрока, но лежит дальше радиуса
+                CHECK(visible.dogs == std::vector<size_t>{0, 1, 2});
+                CHECK(visible.loot == std::vector<size_t>{0, 2});
+            }
+        }
+
+        WHEN("a far dog comes closer and the grid is rebuilt") {
+            session.GetDogs()[3].SetCoords({2, 0});
+            grid.Rebuild(session.GetDogs(), loot);
+
+            THEN("it becomes visible") {
+                CHECK(FindVisibleDogs(grid, {0, 0}) == std::vector<size_t>{0, 1, 2, 3});
+            }
+        }
+    }
+
+    GIVEN("a crowded session") {
+        random_gen::Pcg32 random{3};
+        for (int i = 0; i < 2000; ++i) {
+            auto* dog = session.FindDog(session.AddDog("dog"s + std::to_string(i), i));
+            dog->SetCoords({random.UniformDouble() * 200 - 100, random.UniformDouble() * 200 - 100});
+        }
+        grid.Rebuild(session.GetDogs(), loot);
+
+        THEN("the grid finds the same dogs as a full scan") {
+            int mismatches = 0;
+            for (int query = 0; query < 50; ++query) {
+                const Coordinates center{random.UniformDouble() * 200 - 100, random.UniformDouble() * 200 - 100};
+                std::vector<size_t> expected;
+                for (size_t position = 0; position < session.GetDogs().size(); ++position) {
+                    const Coordinates coords = session.GetDogs()[position].GetCoords();
+                    const double dx = coords.x - center.x;
+                    const double dy = coords.y - center.y;
+                    if (dx * dx + dy * dy <= 100.0) {
+                        expected.push_back(position);
+                    }
+                }
+                if (FindVisibleDogs(grid, center) != expected) {
+                    ++mismatches;
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+}